@@ -0,0 +1,348 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cbor.h"
+
+#define CBOR_MAX_DEPTH 256
+
+enum cbor_major_type {
+	CBOR_UNSIGNED = 0,
+	CBOR_NEGATIVE = 1,
+	CBOR_BYTES = 2,
+	CBOR_TEXT = 3,
+	CBOR_ARRAY = 4,
+	CBOR_MAP = 5,
+	CBOR_TAG = 6,
+	CBOR_SIMPLE = 7,
+};
+
+enum cbor_simple_value {
+	CBOR_FALSE = 20,
+	CBOR_TRUE = 21,
+	CBOR_NULL = 22,
+	CBOR_UNDEFINED = 23,
+	CBOR_FLOAT16 = 25,
+	CBOR_FLOAT32 = 26,
+	CBOR_FLOAT64 = 27,
+};
+
+struct cbor_buffer {
+	uint8_t *data;
+	size_t len, capacity;
+	bool failed;
+};
+
+static void buffer_append(struct cbor_buffer *buf, const void *data,
+		size_t len) {
+	if (buf->failed) {
+		return;
+	}
+	if (buf->len + len > buf->capacity) {
+		size_t capacity = buf->capacity ? buf->capacity : 256;
+		while (capacity < buf->len + len) {
+			capacity *= 2;
+		}
+		uint8_t *new_data = realloc(buf->data, capacity);
+		if (!new_data) {
+			buf->failed = true;
+			return;
+		}
+		buf->data = new_data;
+		buf->capacity = capacity;
+	}
+	memcpy(buf->data + buf->len, data, len);
+	buf->len += len;
+}
+
+static void append_head(struct cbor_buffer *buf, enum cbor_major_type major,
+		uint64_t value) {
+	uint8_t head[9];
+	size_t size;
+	if (value < 24) {
+		head[0] = major << 5 | value;
+		size = 1;
+	} else if (value <= UINT8_MAX) {
+		head[0] = major << 5 | 24;
+		size = 2;
+	} else if (value <= UINT16_MAX) {
+		head[0] = major << 5 | 25;
+		size = 3;
+	} else if (value <= UINT32_MAX) {
+		head[0] = major << 5 | 26;
+		size = 5;
+	} else {
+		head[0] = major << 5 | 27;
+		size = 9;
+	}
+	// Arguments are stored in network byte order
+	for (size_t i = size - 1; i > 0; --i) {
+		head[i] = value & 0xff;
+		value >>= 8;
+	}
+	buffer_append(buf, head, size);
+}
+
+static void append_simple(struct cbor_buffer *buf,
+		enum cbor_simple_value value) {
+	uint8_t byte = CBOR_SIMPLE << 5 | value;
+	buffer_append(buf, &byte, 1);
+}
+
+static void append_text(struct cbor_buffer *buf, const char *text,
+		size_t len) {
+	append_head(buf, CBOR_TEXT, len);
+	buffer_append(buf, text, len);
+}
+
+static void encode_value(struct cbor_buffer *buf, json_object *obj) {
+	switch (json_object_get_type(obj)) {
+	case json_type_null:
+		append_simple(buf, CBOR_NULL);
+		break;
+	case json_type_boolean:
+		append_simple(buf, json_object_get_boolean(obj) ?
+				CBOR_TRUE : CBOR_FALSE);
+		break;
+	case json_type_int: {
+		int64_t integer = json_object_get_int64(obj);
+		if (integer >= 0) {
+			append_head(buf, CBOR_UNSIGNED, integer);
+		} else {
+			append_head(buf, CBOR_NEGATIVE, -(integer + 1));
+		}
+		break;
+	}
+	case json_type_double: {
+		double number = json_object_get_double(obj);
+		uint64_t bits;
+		memcpy(&bits, &number, sizeof(bits));
+		append_simple(buf, CBOR_FLOAT64);
+		uint8_t bytes[8];
+		for (int i = 7; i >= 0; --i) {
+			bytes[i] = bits & 0xff;
+			bits >>= 8;
+		}
+		buffer_append(buf, bytes, sizeof(bytes));
+		break;
+	}
+	case json_type_string:
+		append_text(buf, json_object_get_string(obj),
+				json_object_get_string_len(obj));
+		break;
+	case json_type_array: {
+		size_t length = json_object_array_length(obj);
+		append_head(buf, CBOR_ARRAY, length);
+		for (size_t i = 0; i < length; ++i) {
+			encode_value(buf, json_object_array_get_idx(obj, i));
+		}
+		break;
+	}
+	case json_type_object:
+		append_head(buf, CBOR_MAP, json_object_object_length(obj));
+		json_object_object_foreach(obj, key, value) {
+			append_text(buf, key, strlen(key));
+			encode_value(buf, value);
+		}
+		break;
+	}
+}
+
+char *cbor_encode_json(json_object *obj, size_t *len) {
+	struct cbor_buffer buf = {0};
+	encode_value(&buf, obj);
+	if (buf.failed) {
+		free(buf.data);
+		return NULL;
+	}
+	*len = buf.len;
+	return (char *)buf.data;
+}
+
+struct cbor_reader {
+	const uint8_t *data;
+	size_t len, pos;
+};
+
+static bool read_head(struct cbor_reader *reader, uint8_t *major,
+		uint8_t *info, uint64_t *value) {
+	if (reader->pos >= reader->len) {
+		return false;
+	}
+	uint8_t initial = reader->data[reader->pos++];
+	*major = initial >> 5;
+	*info = initial & 0x1f;
+	size_t size;
+	if (*info < 24) {
+		*value = *info;
+		return true;
+	} else if (*info <= 27) {
+		size = 1 << (*info - 24);
+	} else {
+		// Reserved values and indefinite lengths are not supported
+		return false;
+	}
+	if (reader->len - reader->pos < size) {
+		return false;
+	}
+	*value = 0;
+	for (size_t i = 0; i < size; ++i) {
+		*value = *value << 8 | reader->data[reader->pos++];
+	}
+	return true;
+}
+
+static double decode_half(uint16_t half) {
+	uint64_t sign = (uint64_t)(half >> 15) << 63;
+	uint64_t exponent = (half >> 10) & 0x1f;
+	uint64_t mantissa = half & 0x3ff;
+	double value;
+	if (exponent == 0) {
+		// Subnormal: mantissa * 2^-24, which is exact in a double
+		value = mantissa / 16777216.0;
+		return sign ? -value : value;
+	}
+	uint64_t bits = sign | mantissa << 42;
+	if (exponent == 0x1f) {
+		bits |= (uint64_t)0x7ff << 52;
+	} else {
+		bits |= (exponent - 15 + 1023) << 52;
+	}
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+static bool decode_simple(uint8_t info, uint64_t value, json_object **obj) {
+	switch (info) {
+	case CBOR_FALSE:
+	case CBOR_TRUE:
+		*obj = json_object_new_boolean(info == CBOR_TRUE);
+		return *obj != NULL;
+	case CBOR_NULL:
+	case CBOR_UNDEFINED:
+		*obj = NULL;
+		return true;
+	case CBOR_FLOAT16:
+		*obj = json_object_new_double(decode_half(value));
+		return *obj != NULL;
+	case CBOR_FLOAT32: {
+		uint32_t bits = value;
+		float single;
+		memcpy(&single, &bits, sizeof(single));
+		*obj = json_object_new_double(single);
+		return *obj != NULL;
+	}
+	case CBOR_FLOAT64: {
+		double number;
+		memcpy(&number, &value, sizeof(number));
+		*obj = json_object_new_double(number);
+		return *obj != NULL;
+	}
+	}
+	return false;
+}
+
+static bool decode_value(struct cbor_reader *reader, json_object **obj,
+		int depth) {
+	uint8_t major, info;
+	uint64_t value;
+	if (depth > CBOR_MAX_DEPTH || !read_head(reader, &major, &info, &value)) {
+		return false;
+	}
+	size_t remaining = reader->len - reader->pos;
+
+	switch (major) {
+	case CBOR_UNSIGNED:
+		if (value > INT64_MAX) {
+			return false;
+		}
+		*obj = json_object_new_int64(value);
+		return *obj != NULL;
+	case CBOR_NEGATIVE:
+		if (value > INT64_MAX) {
+			return false;
+		}
+		*obj = json_object_new_int64(-(int64_t)value - 1);
+		return *obj != NULL;
+	case CBOR_TEXT:
+		if (value > remaining) {
+			return false;
+		}
+		*obj = json_object_new_string_len(
+				(const char *)reader->data + reader->pos, value);
+		reader->pos += value;
+		return *obj != NULL;
+	case CBOR_ARRAY:
+		// Every item takes at least one byte
+		if (value > remaining) {
+			return false;
+		}
+		*obj = json_object_new_array();
+		if (!*obj) {
+			return false;
+		}
+		for (uint64_t i = 0; i < value; ++i) {
+			json_object *item;
+			if (!decode_value(reader, &item, depth + 1)) {
+				json_object_put(*obj);
+				return false;
+			}
+			json_object_array_add(*obj, item);
+		}
+		return true;
+	case CBOR_MAP:
+		if (value > remaining / 2) {
+			return false;
+		}
+		*obj = json_object_new_object();
+		if (!*obj) {
+			return false;
+		}
+		for (uint64_t i = 0; i < value; ++i) {
+			uint8_t key_major, key_info;
+			uint64_t key_len;
+			if (!read_head(reader, &key_major, &key_info, &key_len)
+					|| key_major != CBOR_TEXT
+					|| key_len > reader->len - reader->pos) {
+				json_object_put(*obj);
+				return false;
+			}
+			char *key = strndup((const char *)reader->data + reader->pos,
+					key_len);
+			reader->pos += key_len;
+			json_object *item;
+			if (!key || !decode_value(reader, &item, depth + 1)) {
+				free(key);
+				json_object_put(*obj);
+				return false;
+			}
+			json_object_object_add(*obj, key, item);
+			free(key);
+		}
+		return true;
+	case CBOR_TAG:
+		// Tags carry no meaning in JSON, decode the tagged item as is
+		return decode_value(reader, obj, depth + 1);
+	case CBOR_SIMPLE:
+		return decode_simple(info, value, obj);
+	}
+	// Byte strings have no JSON counterpart
+	return false;
+}
+
+bool cbor_decode_json(const char *data, size_t len, json_object **obj) {
+	struct cbor_reader reader = {
+		.data = (const uint8_t *)data,
+		.len = len,
+	};
+	json_object *value;
+	if (!decode_value(&reader, &value, 0)) {
+		return false;
+	}
+	if (reader.pos != reader.len) {
+		json_object_put(value);
+		return false;
+	}
+	*obj = value;
+	return true;
+}
@@ -0,0 +1,178 @@
+#define _POSIX_C_SOURCE 200809L
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "hash_table.h"
+
+#define HASH_TABLE_INITIAL_CAPACITY 16
+
+size_t hash_string(const char *str) {
+	// FNV-1a
+	size_t hash = (size_t)14695981039346656037ULL;
+	for (const unsigned char *c = (const unsigned char *)str; *c; ++c) {
+		hash ^= *c;
+		hash *= (size_t)1099511628211ULL;
+	}
+	return hash;
+}
+
+size_t hash_string_ignore_case(const char *str) {
+	size_t hash = (size_t)14695981039346656037ULL;
+	for (const unsigned char *c = (const unsigned char *)str; *c; ++c) {
+		hash ^= tolower(*c);
+		hash *= (size_t)1099511628211ULL;
+	}
+	return hash;
+}
+
+static size_t hash_key(hash_table_t *table, const char *key) {
+	return table->ignore_case ? hash_string_ignore_case(key) : hash_string(key);
+}
+
+hash_table_t *create_hash_table(void) {
+	hash_table_t *table = malloc(sizeof(hash_table_t));
+	if (!table) {
+		return NULL;
+	}
+	table->capacity = HASH_TABLE_INITIAL_CAPACITY;
+	table->length = 0;
+	table->ignore_case = false;
+	table->buckets = calloc(table->capacity, sizeof(struct hash_table_entry *));
+	if (!table->buckets) {
+		free(table);
+		return NULL;
+	}
+	return table;
+}
+
+hash_table_t *create_hash_table_ignore_case(void) {
+	hash_table_t *table = create_hash_table();
+	if (table) {
+		table->ignore_case = true;
+	}
+	return table;
+}
+
+void hash_table_clear(hash_table_t *table) {
+	for (size_t i = 0; i < table->capacity; ++i) {
+		struct hash_table_entry *entry = table->buckets[i];
+		while (entry) {
+			struct hash_table_entry *next = entry->next;
+			free(entry->key);
+			free(entry);
+			entry = next;
+		}
+		table->buckets[i] = NULL;
+	}
+	table->length = 0;
+}
+
+void hash_table_free(hash_table_t *table) {
+	if (table == NULL) {
+		return;
+	}
+	hash_table_clear(table);
+	free(table->buckets);
+	free(table);
+}
+
+static struct hash_table_entry **find_entry(hash_table_t *table,
+		const char *key, size_t hash) {
+	struct hash_table_entry **entry =
+		&table->buckets[hash & (table->capacity - 1)];
+	while (*entry) {
+		if ((*entry)->hash == hash && (table->ignore_case ?
+					strcasecmp((*entry)->key, key) :
+					strcmp((*entry)->key, key)) == 0) {
+			break;
+		}
+		entry = &(*entry)->next;
+	}
+	return entry;
+}
+
+void *hash_table_get(hash_table_t *table, const char *key) {
+	struct hash_table_entry *entry =
+		*find_entry(table, key, hash_key(table, key));
+	return entry ? entry->value : NULL;
+}
+
+static void hash_table_grow(hash_table_t *table) {
+	size_t capacity = table->capacity * 2;
+	struct hash_table_entry **buckets =
+		calloc(capacity, sizeof(struct hash_table_entry *));
+	if (!buckets) {
+		return; // keep the current, more loaded, buckets
+	}
+	for (size_t i = 0; i < table->capacity; ++i) {
+		struct hash_table_entry *entry = table->buckets[i];
+		while (entry) {
+			struct hash_table_entry *next = entry->next;
+			size_t index = entry->hash & (capacity - 1);
+			entry->next = buckets[index];
+			buckets[index] = entry;
+			entry = next;
+		}
+	}
+	free(table->buckets);
+	table->buckets = buckets;
+	table->capacity = capacity;
+}
+
+void *hash_table_set(hash_table_t *table, const char *key, void *value) {
+	size_t hash = hash_key(table, key);
+	struct hash_table_entry **slot = find_entry(table, key, hash);
+	if (*slot) {
+		void *old = (*slot)->value;
+		(*slot)->value = value;
+		return old;
+	}
+
+	struct hash_table_entry *entry = malloc(sizeof(struct hash_table_entry));
+	if (!entry) {
+		return NULL;
+	}
+	entry->key = strdup(key);
+	if (!entry->key) {
+		free(entry);
+		return NULL;
+	}
+	entry->value = value;
+	entry->hash = hash;
+	entry->next = NULL;
+	*slot = entry;
+
+	if (++table->length > table->capacity * 3 / 4) {
+		hash_table_grow(table);
+	}
+	return NULL;
+}
+
+void *hash_table_remove(hash_table_t *table, const char *key) {
+	struct hash_table_entry **slot =
+		find_entry(table, key, hash_key(table, key));
+	struct hash_table_entry *entry = *slot;
+	if (!entry) {
+		return NULL;
+	}
+	void *value = entry->value;
+	*slot = entry->next;
+	free(entry->key);
+	free(entry);
+	--table->length;
+	return value;
+}
+
+void hash_table_for_each(hash_table_t *table,
+		void (*f)(const char *key, void *value, void *data), void *data) {
+	for (size_t i = 0; i < table->capacity; ++i) {
+		struct hash_table_entry *entry = table->buckets[i];
+		while (entry) {
+			// Allow the callback to remove the current entry
+			struct hash_table_entry *next = entry->next;
+			f(entry->key, entry->value, data);
+			entry = next;
+		}
+	}
+}
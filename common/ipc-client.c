@@ -127,20 +127,25 @@ void free_ipc_response(struct ipc_response *response) {
 	free(response);
 }
 
-char *ipc_single_command(int socketfd, uint32_t type, const char *payload, uint32_t *len) {
+void ipc_send_command(int socketfd, uint32_t type, const char *payload,
+		uint32_t len) {
 	char data[IPC_HEADER_SIZE];
 	uint32_t *data32 = (uint32_t *)(data + sizeof(ipc_magic));
 	memcpy(data, ipc_magic, sizeof(ipc_magic));
-	memcpy(&data32[0], len, sizeof(*len));
+	memcpy(&data32[0], &len, sizeof(len));
 	memcpy(&data32[1], &type, sizeof(type));
 
 	if (write(socketfd, data, IPC_HEADER_SIZE) == -1) {
 		sway_abort("Unable to send IPC header");
 	}
 
-	if (write(socketfd, payload, *len) == -1) {
+	if (write(socketfd, payload, len) == -1) {
 		sway_abort("Unable to send IPC payload");
 	}
+}
+
+char *ipc_single_command(int socketfd, uint32_t type, const char *payload, uint32_t *len) {
+	ipc_send_command(socketfd, type, payload, *len);
 
 	struct ipc_response *resp = ipc_recv_response(socketfd);
 	char *response = resp->payload;
@@ -1,6 +1,7 @@
 # swaymsg(1) completion
 
 complete -f -c swaymsg
+complete -c swaymsg -s c -l cbor --description "Use the CBOR encoding to talk to sway."
 complete -c swaymsg -s h -l help --description "Show help message and quit."
 complete -c swaymsg -s m -l monitor --description "Monitor subscribed events until killed."
 complete -c swaymsg -s p -l pretty --description "Use pretty output even when not using a tty."
@@ -21,5 +22,7 @@ complete -c swaymsg -s t -l type -fra 'get_binding_modes' --description "Gets a
 complete -c swaymsg -s t -l type -fra 'get_binding_state' --description "Get JSON-encoded info about the current binding state."
 complete -c swaymsg -s t -l type -fra 'get_config' --description "Gets a JSON-encoded copy of the current configuration."
 complete -c swaymsg -s t -l type -fra 'get_seats' --description "Gets a JSON-encoded list of all seats, its properties and all assigned devices."
+complete -c swaymsg -s t -l type -fra 'get_frame_timings' --description "Gets JSON-encoded render timing statistics for each output."
+complete -c swaymsg -s t -l type -fra 'get_startup_profile' --description "Gets JSON-encoded durations of the phases of sway's startup."
 complete -c swaymsg -s t -l type -fra 'send_tick' --description "Sends a tick event to all subscribed clients."
 complete -c swaymsg -s t -l type -fra 'subscribe' --description "Subscribe to a list of event types."
@@ -0,0 +1,26 @@
+#ifndef _SWAY_CBOR_H
+#define _SWAY_CBOR_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <json.h>
+
+/**
+ * A minimal CBOR (RFC 8949) codec for the subset of data items that map onto
+ * JSON: integers, floats, text strings, arrays, maps with text keys, booleans
+ * and null. It is used as the compact IPC encoding.
+ */
+
+/**
+ * Encodes a json-c object as CBOR. Returns a newly allocated buffer and sets
+ * len to its size, or returns NULL if allocation failed.
+ */
+char *cbor_encode_json(json_object *obj, size_t *len);
+
+/**
+ * Decodes a single CBOR data item spanning the whole buffer. On success, *obj
+ * is set to the decoded value (which is NULL for a CBOR null) and true is
+ * returned. Returns false for malformed or unsupported input.
+ */
+bool cbor_decode_json(const char *data, size_t len, json_object **obj);
+
+#endif
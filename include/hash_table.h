@@ -0,0 +1,41 @@
+#ifndef _SWAY_HASH_TABLE_H
+#define _SWAY_HASH_TABLE_H
+#include <stdbool.h>
+#include <stddef.h>
+
+struct hash_table_entry {
+	char *key;
+	void *value;
+	size_t hash;
+	struct hash_table_entry *next;
+};
+
+/**
+ * A string-keyed hash table with separate chaining. Keys are copied, values
+ * are owned by the caller. Tables created with create_hash_table_ignore_case()
+ * compare keys like strcasecmp().
+ */
+typedef struct {
+	size_t capacity; // number of buckets, always a power of two
+	size_t length;
+	bool ignore_case;
+	struct hash_table_entry **buckets;
+} hash_table_t;
+
+hash_table_t *create_hash_table(void);
+hash_table_t *create_hash_table_ignore_case(void);
+// Frees the table and its keys, but not the values
+void hash_table_free(hash_table_t *table);
+void *hash_table_get(hash_table_t *table, const char *key);
+// Returns the value previously associated with the key, or NULL
+void *hash_table_set(hash_table_t *table, const char *key, void *value);
+// Returns the removed value, or NULL if the key was not present
+void *hash_table_remove(hash_table_t *table, const char *key);
+void hash_table_clear(hash_table_t *table);
+void hash_table_for_each(hash_table_t *table,
+		void (*f)(const char *key, void *value, void *data), void *data);
+
+size_t hash_string(const char *str);
+size_t hash_string_ignore_case(const char *str);
+
+#endif
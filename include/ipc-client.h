@@ -30,6 +30,12 @@ int ipc_open_socket(const char *socket_path);
  * the length of the buffer returned from sway.
  */
 char *ipc_single_command(int socketfd, uint32_t type, const char *payload, uint32_t *len);
+/**
+ * Sends an IPC command without waiting for the reply, which has to be received
+ * with ipc_recv_response.
+ */
+void ipc_send_command(int socketfd, uint32_t type, const char *payload,
+		uint32_t len);
 /**
  * Receives a single IPC response and returns an ipc_response.
  */
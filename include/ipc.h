@@ -22,6 +22,9 @@ enum ipc_command_type {
 	// sway-specific command types
 	IPC_GET_INPUTS = 100,
 	IPC_GET_SEATS = 101,
+	IPC_GET_FRAME_TIMINGS = 102,
+	IPC_SET_ENCODING = 103,
+	IPC_GET_STARTUP_PROFILE = 104,
 
 	// Events sent from sway to clients. Events have the highest bits set.
 	IPC_EVENT_WORKSPACE = ((1<<31) | 0),
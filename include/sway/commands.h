@@ -58,6 +58,30 @@ struct cmd_handler *find_handler(char *line, struct cmd_handler *cmd_handlers,
  */
 list_t *execute_command(char *command,  struct sway_seat *seat,
 		struct sway_container *con);
+
+/**
+ * A command string parsed ahead of time: split into its commands, with their
+ * criteria parsed, handlers resolved and arguments split and unquoted. Only
+ * variable replacement and criteria matching are left to execution.
+ */
+struct command_program;
+
+struct command_program *command_program_compile(const char *command);
+
+void command_program_destroy(struct command_program *program);
+
+/**
+ * Returns the program in the cache, compiling the command into it first if
+ * the cache is empty or was compiled while the config was in another state.
+ */
+struct command_program *command_program_cache(
+		struct command_program **cache, const char *command);
+
+/**
+ * Executes the program like execute_command() would execute its command.
+ */
+list_t *command_program_execute(struct command_program *program,
+		struct sway_seat *seat, struct sway_container *con);
 /**
  * Parse and handles a command during config file loading.
  *
@@ -137,6 +161,7 @@ sway_cmd cmd_hide_edge_borders;
 sway_cmd cmd_include;
 sway_cmd cmd_inhibit_idle;
 sway_cmd cmd_input;
+sway_cmd cmd_ipc_backlog;
 sway_cmd cmd_seat;
 sway_cmd cmd_ipc;
 sway_cmd cmd_kill;
@@ -288,6 +313,7 @@ sway_cmd seat_cmd_hide_cursor;
 sway_cmd seat_cmd_idle_inhibit;
 sway_cmd seat_cmd_idle_wake;
 sway_cmd seat_cmd_keyboard_grouping;
+sway_cmd seat_cmd_motion_batching;
 sway_cmd seat_cmd_pointer_constraint;
 sway_cmd seat_cmd_shortcuts_inhibitor;
 sway_cmd seat_cmd_xcursor_theme;
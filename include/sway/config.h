@@ -3,11 +3,13 @@
 #include <libinput.h>
 #include <stdint.h>
 #include <string.h>
+#include <sys/types.h>
 #include <time.h>
 #include <wlr/interfaces/wlr_switch.h>
 #include <wlr/types/wlr_box.h>
 #include <xkbcommon/xkbcommon.h>
 #include "../include/config.h"
+#include "hash_table.h"
 #include "list.h"
 #include "swaynag.h"
 #include "tree/container.h"
@@ -16,6 +18,9 @@
 
 // TODO: Refactor this shit
 
+struct command_program;
+struct criteria_index;
+
 /**
  * Describes a variable created via the `set` command.
  */
@@ -57,6 +62,8 @@ struct sway_binding {
 	uint32_t modifiers;
 	xkb_layout_index_t group;
 	char *command;
+	struct command_program *program; // compiled on first use
+	int position; // in its mode's binding list, set by the binding index
 };
 
 /**
@@ -75,6 +82,7 @@ struct sway_switch_binding {
 	enum wlr_switch_state state;
 	uint32_t flags;
 	char *command;
+	struct command_program *program; // compiled on first use
 };
 
 /**
@@ -97,6 +105,10 @@ struct sway_mode {
 	list_t *mouse_bindings;
 	list_t *switch_bindings;
 	bool pango;
+
+	// Key bindings grouped for lookup, see mode_get_binding_index
+	hash_table_t *keysym_index;
+	hash_table_t *keycode_index;
 };
 
 struct input_config_mapped_from_region {
@@ -184,6 +196,12 @@ enum seat_config_shortcuts_inhibit {
 	SHORTCUTS_INHIBIT_DISABLE,
 };
 
+enum seat_config_motion_batching {
+	MOTION_BATCHING_DEFAULT, // the default is currently disabled
+	MOTION_BATCHING_ENABLE,
+	MOTION_BATCHING_DISABLE,
+};
+
 enum seat_keyboard_grouping {
 	KEYBOARD_GROUP_DEFAULT, // the default is currently smart
 	KEYBOARD_GROUP_NONE,
@@ -210,6 +228,7 @@ struct seat_config {
 	enum seat_config_allow_constrain allow_constrain;
 	enum seat_config_shortcuts_inhibit shortcuts_inhibit;
 	enum seat_keyboard_grouping keyboard_grouping;
+	enum seat_config_motion_batching motion_batching;
 	uint32_t idle_inhibit_sources, idle_wake_sources;
 	struct {
 		char *name;
@@ -432,6 +451,40 @@ enum xwayland_mode {
 	XWAYLAND_MODE_IMMEDIATE,
 };
 
+enum ipc_backlog_policy {
+	IPC_BACKLOG_DISCONNECT,
+	IPC_BACKLOG_DROP, /**< drop events, but never replies */
+};
+
+/**
+ * A logical line of a config file, which is executed as a single command.
+ */
+struct config_line {
+	char *text; // without surrounding whitespace, continuations joined
+	int line_number; // of the last physical line it spans
+	bool brace; // an opening brace followed on its own line
+};
+
+/**
+ * A config file split into lines, cached by path across reloads.
+ */
+struct config_file {
+	char *path;
+	char *contents;
+	size_t size;
+	uint64_t hash;
+
+	// Used to skip reading the file if it hasn't been touched
+	ino_t ino;
+	dev_t dev;
+	struct timespec mtime, ctime;
+
+	struct config_line *lines;
+	int length, capacity;
+
+	uint64_t generation; // of the last load which used the file
+};
+
 /**
  * The configuration struct. The result of loading a config file.
  */
@@ -439,15 +492,21 @@ struct sway_config {
 	char *swaynag_command;
 	struct swaynag_instance swaynag_config_errors;
 	list_t *symbols;
+	hash_table_t *symbols_by_name; // name -> sway_variable
+	// Distinct lengths of the symbol names, longest first
+	int *symbol_lengths;
+	int symbol_lengths_count;
 	list_t *modes;
 	list_t *bars;
 	list_t *cmd_queue;
 	list_t *workspace_configs;
+	hash_table_t *workspace_configs_by_name; // name -> workspace_config
 	list_t *output_configs;
 	list_t *input_configs;
 	list_t *input_type_configs;
 	list_t *seat_configs;
 	list_t *criteria;
+	struct criteria_index *criteria_index; // built by criteria_for_view
 	list_t *no_focus;
 	list_t *active_bar_modifiers;
 	struct sway_mode *current_mode;
@@ -473,6 +532,8 @@ struct sway_config {
 	enum sway_fowa focus_on_window_activation;
 	enum sway_popup_during_fullscreen popup_during_fullscreen;
 	enum xwayland_mode xwayland;
+	size_t ipc_backlog_size; // bytes queued for a single IPC client
+	enum ipc_backlog_policy ipc_backlog_policy;
 
 	// swaybg
 	char *swaybg_command;
@@ -487,6 +548,9 @@ struct sway_config {
 	bool failed;
 	bool reloading;
 	bool reading;
+	// Set by a reload when the font or colors changed, in which case all title
+	// and marks textures need to be rebuilt
+	bool reload_textures;
 	bool validating;
 	bool auto_back_and_forth;
 	bool show_marks;
@@ -562,11 +626,28 @@ void load_include_configs(const char *path, struct sway_config *config,
 		struct swaynag_instance *swaynag);
 
 /**
- * Reads the config from the given FILE.
+ * Executes the lines of the given config file.
  */
-bool read_config(FILE *file, struct sway_config *config,
+bool read_config(struct config_file *file, struct sway_config *config,
 		struct swaynag_instance *swaynag);
 
+/**
+ * Returns the tokenized config file at the given real path, which is only
+ * read and tokenized again when it changed since it was last loaded. The
+ * returned file is owned by the cache.
+ */
+struct config_file *config_file_load(const char *path);
+
+/**
+ * Marks the start of loading a config. Files not loaded since then are
+ * dropped from the cache by config_file_cache_prune().
+ */
+void config_file_cache_begin(void);
+
+void config_file_cache_prune(void);
+
+void config_file_cache_finish(void);
+
 /**
  * Run the commands that were deferred when reading the config file.
  */
@@ -607,6 +688,8 @@ void input_config_fill_rule_names(struct input_config *ic,
 
 void free_input_config(struct input_config *ic);
 
+bool input_config_equal(struct input_config *a, struct input_config *b);
+
 int seat_name_cmp(const void *item, const void *data);
 
 struct seat_config *new_seat_config(const char* name);
@@ -617,6 +700,8 @@ struct seat_config *copy_seat_config(struct seat_config *seat);
 
 void free_seat_config(struct seat_config *ic);
 
+bool seat_config_equal(struct seat_config *a, struct seat_config *b);
+
 struct seat_attachment_config *seat_attachment_config_new(void);
 
 struct seat_attachment_config *seat_config_get_attachment(
@@ -645,12 +730,22 @@ struct output_config *find_output_config(struct sway_output *output);
 
 void apply_output_config_to_outputs(struct output_config *oc);
 
-void reset_outputs(void);
+/**
+ * Apply the output configs to the outputs whose configs differ between
+ * old_config and the current config.
+ */
+void reset_changed_outputs(struct sway_config *old_config);
 
 void free_output_config(struct output_config *oc);
 
 bool spawn_swaybg(void);
 
+/**
+ * Take over the swaybg client of old_config if it would be spawned with the
+ * same arguments. Returns false if swaybg needs to be spawned.
+ */
+bool adopt_swaybg(struct sway_config *old_config);
+
 int workspace_output_cmp_workspace(const void *a, const void *b);
 
 void free_sway_binding(struct sway_binding *sb);
@@ -663,6 +758,12 @@ void load_swaybar(struct bar_config *bar);
 
 void load_swaybars(void);
 
+/**
+ * Take over the swaybar clients of old_config for bars which can be updated
+ * with barconfig_update instead of being restarted.
+ */
+void adopt_swaybars(struct sway_config *old_config);
+
 struct bar_config *default_bar_config(void);
 
 void free_bar_config(struct bar_config *bar);
@@ -681,6 +782,12 @@ void free_workspace_config(struct workspace_config *wsc);
  */
 void config_update_font_height(bool recalculate);
 
+/**
+ * Whether title and marks textures rendered for one config would look
+ * different with the other.
+ */
+bool config_textures_changed(struct sway_config *a, struct sway_config *b);
+
 /**
  * Convert bindsym into bindcode using the first configured layout.
  * Return false in case the conversion is unsuccessful.
@@ -691,6 +798,27 @@ void translate_keysyms(struct input_config *input_config);
 
 void binding_add_translated(struct sway_binding *binding, list_t *bindings);
 
+/**
+ * Return the mode's keysym or keycode bindings grouped by device, modifiers,
+ * release flag and key set, building the index if needed. Each bucket is a
+ * list of bindings in the order of the mode's binding list.
+ */
+hash_table_t *mode_get_binding_index(struct sway_mode *mode,
+		enum binding_input_type type);
+
+/**
+ * Drop the mode's binding indexes. This must be called whenever its keysym or
+ * keycode bindings change.
+ */
+void mode_invalidate_binding_index(struct sway_mode *mode);
+
+/**
+ * Return the bucket of bindings for the given device, modifiers, release flag
+ * and sorted key set, or NULL if there is none.
+ */
+list_t *binding_index_lookup(hash_table_t *index, const char *input,
+		uint32_t modifiers, bool release, const uint32_t *keys, size_t nkeys);
+
 /* Global config singleton. */
 extern struct sway_config *config;
 
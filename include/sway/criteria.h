@@ -22,13 +22,17 @@ enum pattern_type {
 struct pattern {
 	enum pattern_type match_type;
 	pcre *regex;
+	pcre_extra *extra; // study data, JIT compiled when supported
+	char *prefix; // literal prefix of every match, for anchored patterns
 };
 
 struct criteria {
 	enum criteria_type type;
 	char *raw; // entire criteria string (for logging)
 	char *cmdlist;
+	struct command_program *program; // compiled from cmdlist on first use
 	char *target; // workspace or output name for `assign` criteria
+	int position; // index in config->criteria, set by the criteria index
 
 	struct pattern *title;
 	struct pattern *shell;
@@ -73,6 +77,8 @@ struct criteria *criteria_parse(char *raw, char **error);
  */
 list_t *criteria_for_view(struct sway_view *view, enum criteria_type types);
 
+void criteria_index_destroy(struct criteria_index *index);
+
 /**
  * Compile a list of containers matching the given criteria.
  */
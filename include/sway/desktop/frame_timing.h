@@ -0,0 +1,120 @@
+#ifndef _SWAY_FRAME_TIMING_H
+#define _SWAY_FRAME_TIMING_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * Per-output frame timing instrumentation.
+ *
+ * Every rendered frame is split into phases. The time spent between two marks
+ * is accumulated into the phase passed to frame_timing_mark(), so a phase can
+ * be entered several times per frame (e.g. the layer-shell layers drawn below
+ * and above the workspace). Finished frames are kept in a fixed-size ring
+ * buffer which is summarized on demand for IPC.
+ */
+
+enum sway_frame_phase {
+	FRAME_PHASE_DAMAGE,    // Collecting damage and attaching the renderer
+	FRAME_PHASE_LAYERS,    // Clearing, background/bottom/top layer surfaces
+	FRAME_PHASE_WORKSPACE, // Tiling containers or the fullscreen container
+	FRAME_PHASE_FLOATING,  // Floating containers and unmanaged surfaces
+	FRAME_PHASE_POPUPS,    // Seatops, layer popups and view popups
+	FRAME_PHASE_OVERLAY,   // Overlay layer and drag icons
+	FRAME_PHASE_COMMIT,    // Software cursors, renderer end and output commit
+	FRAME_PHASE_COUNT,
+};
+
+#define FRAME_TIMING_CAPACITY 256
+#define FRAME_TIMING_HISTOGRAM_BUCKETS 10
+
+struct sway_frame_timing {
+	int64_t phase_nsec[FRAME_PHASE_COUNT];
+	int64_t total_nsec;
+	// Predicted milliseconds until the next refresh, as computed when the
+	// frame was scheduled. Only valid if has_refresh_prediction is set.
+	int msec_until_refresh;
+	bool has_refresh_prediction;
+};
+
+struct sway_frame_timings {
+	struct sway_frame_timing frames[FRAME_TIMING_CAPACITY];
+	size_t head; // index of the next slot to be written
+	size_t count;
+
+	struct sway_frame_timing current;
+	struct timespec frame_start, last_mark;
+	bool in_frame;
+
+	// Set by the frame handler, consumed by the next frame_timing_begin()
+	int pending_msec_until_refresh;
+	bool pending_has_refresh_prediction;
+
+	// Microseconds from commit to apply of the last transactions which
+	// changed the output's layout
+	int64_t transaction_usec[FRAME_TIMING_CAPACITY];
+	size_t transaction_head;
+	size_t transaction_count;
+};
+
+struct sway_frame_timing_stats {
+	size_t samples;
+	int64_t min, max, mean;
+	int64_t p50, p90, p99;
+	size_t histogram[FRAME_TIMING_HISTOGRAM_BUCKETS];
+};
+
+/**
+ * Upper bounds (inclusive, in microseconds) of the histogram buckets. The
+ * last bucket has no upper bound and is represented by -1.
+ */
+extern const int64_t frame_timing_histogram_bounds_usec[
+	FRAME_TIMING_HISTOGRAM_BUCKETS];
+
+const char *frame_timing_phase_name(enum sway_frame_phase phase);
+
+/**
+ * Record the refresh prediction computed when the frame was scheduled.
+ */
+void frame_timing_predict(struct sway_frame_timings *timings,
+		bool has_prediction, int msec_until_refresh);
+
+void frame_timing_begin(struct sway_frame_timings *timings);
+
+/**
+ * Attribute the time elapsed since the previous mark to the given phase.
+ */
+void frame_timing_mark(struct sway_frame_timings *timings,
+		enum sway_frame_phase phase);
+
+/**
+ * Finish the current frame. If `commit` is false the frame was not presented
+ * and is discarded.
+ */
+void frame_timing_end(struct sway_frame_timings *timings, bool commit);
+
+/**
+ * Summarize the recorded frames for a phase, in microseconds. Passing
+ * FRAME_PHASE_COUNT summarizes the total frame duration.
+ */
+void frame_timing_get_phase_stats(struct sway_frame_timings *timings,
+		enum sway_frame_phase phase, struct sway_frame_timing_stats *stats);
+
+/**
+ * Summarize the predicted milliseconds until refresh of the recorded frames.
+ * The histogram is not filled in.
+ */
+void frame_timing_get_refresh_stats(struct sway_frame_timings *timings,
+		struct sway_frame_timing_stats *stats);
+
+void frame_timing_record_transaction(struct sway_frame_timings *timings,
+		int64_t usec);
+
+/**
+ * Summarize the latency of the recorded transactions, in microseconds.
+ */
+void frame_timing_get_transaction_stats(struct sway_frame_timings *timings,
+		struct sway_frame_timing_stats *stats);
+
+#endif
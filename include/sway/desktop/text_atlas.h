@@ -0,0 +1,67 @@
+#ifndef _SWAY_TEXT_ATLAS_H
+#define _SWAY_TEXT_ATLAS_H
+#include <stdbool.h>
+#include <wlr/render/wlr_renderer.h>
+#include <wlr/render/wlr_texture.h>
+#include <wlr/types/wlr_box.h>
+#include <wlr/types/wlr_output.h>
+#include "list.h"
+
+/**
+ * The text atlas caches rasterized text (titles and marks) in a few large
+ * shared textures.
+ *
+ * Entries are deduplicated by everything that affects their pixels: the text,
+ * the font, the scale, the height and the colors. Containers which share a
+ * title and color class share a single entry. Each entry is a sub-rectangle
+ * of an atlas page and must be rendered with its source box.
+ */
+
+struct sway_text_atlas_page;
+
+struct sway_text_atlas_entry {
+	char *key;
+	int refs;
+
+	struct sway_text_atlas_page *page;
+	struct wlr_box box; // position and size within the page's texture
+
+	// Allocation bookkeeping, private to the atlas
+	void *shelf, *slot;
+};
+
+struct sway_text_atlas_page {
+	struct wlr_renderer *renderer;
+	struct wlr_texture *texture;
+	int width, height;
+	bool dedicated; // holds a single entry too large for a shared page
+
+	list_t *shelves;
+	int used_height;
+	int nentries;
+};
+
+struct text_atlas_params {
+	const char *text;
+	const char *font;
+	bool markup;
+	double scale;
+	int height; // in buffer pixels
+	enum wl_output_subpixel subpixel;
+	const float *background; // rgba
+	const float *foreground; // rgba
+};
+
+/**
+ * Return the atlas entry for the given text, rasterizing it if it is not
+ * cached yet. The entry must be released with text_atlas_release().
+ */
+struct sway_text_atlas_entry *text_atlas_acquire(struct wlr_renderer *renderer,
+		const struct text_atlas_params *params);
+
+void text_atlas_release(struct sway_text_atlas_entry *entry);
+
+void text_atlas_entry_get_source_box(struct sway_text_atlas_entry *entry,
+		struct wlr_fbox *box);
+
+#endif
@@ -17,8 +17,16 @@
  * When we want to make adjustments to the layout, we change the pending state
  * in containers, mark them as dirty and call transaction_commit_dirty(). This
  * create and commits a transaction from the dirty containers.
+ *
+ * The dirty nodes are split into one transaction per output, unless a node
+ * moves between outputs, which joins their transactions. Several transactions
+ * can be committed at the same time, as long as they don't share any nodes,
+ * so a slow client only holds back the transactions which involve it. A transaction which shares nodes with a committed one is
+ * queued until that one is applied. Queued transactions which share nodes are
+ * merged into one.
  */
 
+struct sway_output;
 struct sway_transaction_instruction;
 struct sway_view;
 
@@ -28,6 +36,12 @@ struct sway_view;
  */
 void transaction_commit_dirty(void);
 
+/**
+ * Forget an output which is about to be freed, so that the transactions it
+ * was involved in don't attribute their timings to a reused address.
+ */
+void transaction_remove_output(struct sway_output *output);
+
 /**
  * Notify the transaction system that a view is ready for the new layout.
  *
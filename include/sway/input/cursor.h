@@ -69,6 +69,16 @@ struct sway_cursor {
 	struct wl_event_source *hide_source;
 	bool hidden;
 
+	// When enabled, pointer motion is accumulated and dispatched to the
+	// seatop once per output frame
+	bool motion_batching;
+	struct {
+		bool pending;
+		bool frame; // a pointer frame is held back until the flush
+		uint32_t time_msec;
+		double dx, dy;
+	} motion_batch;
+
 	size_t pressed_button_count;
 };
 
@@ -88,6 +98,20 @@ struct sway_cursor *sway_cursor_create(struct sway_seat *seat);
  */
 void cursor_rebase(struct sway_cursor *cursor);
 void cursor_rebase_all(void);
+
+/**
+ * Dispatch the pointer motion batched since the last output frame, if any.
+ * Returns true if there was pending motion.
+ */
+bool cursor_flush_motion(struct sway_cursor *cursor);
+void cursor_flush_motion_all(void);
+
+/**
+ * Schedule the frames which flush the batched motion again, e.g. because the
+ * output they were scheduled on was disabled. Motion which no output would
+ * flush is dispatched immediately.
+ */
+void cursor_reschedule_motion_all(void);
 void cursor_update_image(struct sway_cursor *cursor, struct sway_node *node);
 
 void cursor_handle_activity(struct sway_cursor *cursor,
@@ -40,6 +40,11 @@ bool input_manager_has_focus(struct sway_node *node);
 
 void input_manager_set_focus(struct sway_node *node);
 
+/**
+ * Tell every seat that the children of a workspace or container changed.
+ */
+void input_manager_invalidate_focus_index(struct sway_node *node);
+
 void input_manager_configure_xcursor(void);
 
 void input_manager_apply_input_config(struct input_config *input_config);
@@ -48,10 +53,19 @@ void input_manager_configure_all_inputs(void);
 
 void input_manager_reset_input(struct sway_input_device *input_device);
 
-void input_manager_reset_all_inputs(void);
-
 void input_manager_apply_seat_config(struct seat_config *seat_config);
 
+/**
+ * Reset and reconfigure only the devices whose input configs differ between
+ * old_config and the current config.
+ */
+void input_manager_apply_changed_input_configs(struct sway_config *old_config);
+
+/**
+ * Apply the seat configs which are new or differ from those in old_config.
+ */
+void input_manager_apply_changed_seat_configs(struct sway_config *old_config);
+
 struct sway_seat *input_manager_get_default_seat(void);
 
 struct sway_seat *input_manager_get_seat(const char *seat_name, bool create);
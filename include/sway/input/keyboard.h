@@ -80,14 +80,40 @@ struct sway_keyboard_group {
 	struct wl_list link; // sway_seat::keyboard_groups
 };
 
+/**
+ * Returns a new reference to the keymap for the input config, which is shared
+ * with other configs resulting in the same keymap. If compiling fails and
+ * error is not NULL, it is set to the error message.
+ */
 struct xkb_keymap *sway_keyboard_compile_keymap(struct input_config *ic,
 		char **error);
 
+struct xkb_keymap *sway_keyboard_compile_keymap_from_names(
+		const struct xkb_rule_names *rules);
+
+/**
+ * Starts compiling the keymap for the input config on the worker pool, so that
+ * it is ready by the time a keyboard uses it.
+ */
+void sway_keyboard_prepare_keymap(struct input_config *ic);
+
+/**
+ * Drops all cached keymaps, so that changes to the xkb data files on disk are
+ * picked up.
+ */
+void sway_keyboard_clear_keymap_cache(void);
+
 struct sway_keyboard *sway_keyboard_create(struct sway_seat *seat,
 		struct sway_seat_device *device);
 
 void sway_keyboard_configure(struct sway_keyboard *keyboard);
 
+/**
+ * Returns whether compiling the keyboard's keymap again gives a different
+ * keymap than the one in use, e.g. because the xkb files changed on disk.
+ */
+bool sway_keyboard_keymap_outdated(struct sway_keyboard *keyboard);
+
 void sway_keyboard_destroy(struct sway_keyboard *keyboard);
 
 void sway_keyboard_disarm_key_repeat(struct sway_keyboard *keyboard);
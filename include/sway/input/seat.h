@@ -42,11 +42,33 @@ struct sway_seat_device {
 	struct wl_list link; // sway_seat::devices
 };
 
+/**
+ * A node's entry in a seat's focus stack, and its focus index.
+ *
+ * The focus index summarizes the focus stack for the node's subtree so that
+ * focus-inactive lookups don't have to walk the stack. Sequence numbers give
+ * each entry's position in the stack, larger being more recent. Focusing a
+ * node updates the indexes of its ancestors as it goes; changing the children
+ * of a node marks it and its ancestors dirty, and their indexes are rebuilt
+ * from their children's the next time they are needed.
+ */
 struct sway_seat_node {
 	struct sway_seat *seat;
 	struct sway_node *node;
 
 	struct wl_list link; // sway_seat::focus_stack
+	struct wl_list node_link; // sway_node::seat_nodes
+
+	int64_t focus_seq;
+	int64_t subtree_seq; // most recent focus_seq in the subtree, including this
+	int64_t view_seq; // most recent focus_seq of a view in the subtree
+	// Children with the most recent focus_seq, subtree_seq and view_seq. For a
+	// workspace the first two only consider tiling children.
+	struct sway_node *active_child;
+	struct sway_node *inactive_child;
+	struct sway_node *inactive_floating; // workspaces only
+	struct sway_node *view_child;
+	bool index_dirty;
 
 	struct wl_listener destroy;
 };
@@ -70,6 +92,8 @@ struct sway_seat {
 
 	bool has_focus;
 	struct wl_list focus_stack; // list of containers in focus order
+	// Sequence numbers last handed out to the top and bottom of the stack
+	int64_t focus_seq_top, focus_seq_bottom;
 	struct sway_workspace *workspace;
 	char *prev_workspace_name; // for workspace back_and_forth
 
@@ -146,6 +170,13 @@ void seat_configure_xcursor(struct sway_seat *seat);
 
 void seat_set_focus(struct sway_seat *seat, struct sway_node *node);
 
+/**
+ * Mark the focus index of a workspace or container and of its ancestors as
+ * dirty. This must be called whenever the node's children change.
+ */
+void seat_invalidate_focus_index(struct sway_seat *seat,
+		struct sway_node *node);
+
 void seat_set_focus_container(struct sway_seat *seat,
 		struct sway_container *con);
 
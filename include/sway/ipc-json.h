@@ -1,6 +1,8 @@
 #ifndef _SWAY_IPC_JSON_H
 #define _SWAY_IPC_JSON_H
 #include <json.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include "sway/tree/container.h"
 #include "sway/input/input-manager.h"
 
@@ -9,8 +11,38 @@ json_object *ipc_json_get_version(void);
 json_object *ipc_json_get_binding_mode(void);
 
 json_object *ipc_json_describe_disabled_output(struct sway_output *o);
+json_object *ipc_json_describe_frame_timings(struct sway_output *o);
+json_object *ipc_json_get_startup_profile(void);
 json_object *ipc_json_describe_node(struct sway_node *node);
 json_object *ipc_json_describe_node_recursive(struct sway_node *node);
+
+#define IPC_JSON_ALL_FIELDS UINT64_MAX
+
+/**
+ * Add the bit of the node property with the given name to the mask, for use
+ * with ipc_json_describe_node_fields. Returns false for unknown properties.
+ */
+bool ipc_json_node_field_mask(const char *name, uint64_t *mask);
+
+/**
+ * Describe a node with only the selected properties, which are the only ones
+ * computed. Children are described if "nodes" or "floating_nodes" is selected,
+ * in which case both are included.
+ */
+json_object *ipc_json_describe_node_fields(struct sway_node *node,
+		uint64_t fields);
+
+/**
+ * Serialize the whole tree, reusing the cached descriptions of unchanged
+ * nodes. The caller must free the returned string.
+ */
+char *ipc_json_get_tree(void);
+
+/**
+ * Serialize the nodes which changed after the given generation, and the IDs
+ * of those which were removed. The caller must free the returned string.
+ */
+char *ipc_json_get_tree_changes(uint64_t since);
 json_object *ipc_json_describe_input(struct sway_input_device *device);
 json_object *ipc_json_describe_seat(struct sway_seat *seat);
 json_object *ipc_json_describe_bar_config(struct bar_config *bar);
@@ -6,6 +6,7 @@
 #include <wlr/types/wlr_box.h>
 #include <wlr/types/wlr_output.h>
 #include "config.h"
+#include "sway/desktop/frame_timing.h"
 #include "sway/tree/node.h"
 #include "sway/tree/view.h"
 
@@ -57,6 +58,8 @@ struct sway_output {
 	uint32_t refresh_nsec;
 	int max_render_time; // In milliseconds
 	struct wl_event_source *repaint_timer;
+
+	struct sway_frame_timings frame_timings;
 };
 
 struct sway_output *output_create(struct wlr_output *wlr_output);
@@ -106,6 +109,13 @@ bool output_has_opaque_overlay_layer_surface(struct sway_output *output);
 
 struct sway_workspace *output_get_active_workspace(struct sway_output *output);
 
+/**
+ * Rasterize the titlebar textures of the containers that the next frame will
+ * show. Must be called before the output's buffer is attached, because
+ * uploading textures makes a different EGL context current.
+ */
+void output_prepare_render(struct sway_output *output);
+
 void output_render(struct sway_output *output, struct timespec *when,
 	pixman_region32_t *damage);
 
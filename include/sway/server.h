@@ -94,6 +94,7 @@ struct sway_debug {
 	bool noatomic;         // Ignore atomic layout updates
 	bool txn_timings;      // Log verbose messages about transactions
 	bool txn_wait;         // Always wait for the timeout before applying
+	bool noocclusion;      // Render surfaces hidden behind opaque ones
 
 	enum {
 		DAMAGE_DEFAULT,    // Default behaviour
@@ -0,0 +1,43 @@
+#ifndef _SWAY_STARTUP_PROFILE_H
+#define _SWAY_STARTUP_PROFILE_H
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Startup timing breakdown. The phases run one after the other, each ending
+ * where the next one begins, from main() until the first frame is rendered.
+ */
+
+enum startup_phase {
+	STARTUP_PHASE_PREPARE,      // Privileged setup, dropping permissions
+	STARTUP_PHASE_SERVER_INIT,  // Display, renderer, protocols and the backend
+	STARTUP_PHASE_CONFIG,       // Loading the config
+	STARTUP_PHASE_SERVER_START, // Starting the backend, which adds devices
+	STARTUP_PHASE_CLIENTS,      // swaybar, deferred commands and bindings
+	STARTUP_PHASE_FIRST_FRAME,  // Until the first frame has been rendered
+	STARTUP_PHASE_COUNT,
+};
+
+/**
+ * Starts the profile. If print is set, the breakdown is printed to stderr
+ * once the last phase ended.
+ */
+void startup_profile_begin(bool print);
+
+/**
+ * Ends the phase, which must be the next one that didn't end yet. Does
+ * nothing otherwise, so the first frame can be reported by every frame.
+ */
+void startup_phase_end(enum startup_phase phase);
+
+bool startup_profile_complete(void);
+
+const char *startup_phase_name(enum startup_phase phase);
+
+/**
+ * Returns the duration of the phase in microseconds, or -1 if it didn't end
+ * yet.
+ */
+int64_t startup_phase_duration_usec(enum startup_phase phase);
+
+#endif
@@ -9,6 +9,8 @@
 
 struct sway_view;
 struct sway_seat;
+struct sway_text_atlas_entry;
+struct border_colors;
 
 enum sway_container_layout {
 	L_NONE,
@@ -64,6 +66,30 @@ struct sway_container_state {
 	double content_width, content_height;
 };
 
+/**
+ * Decoration geometry in output-buffer scale, as render_rect expects it. It is
+ * derived from the current state, so applying a transaction invalidates it.
+ * It's rebuilt when rendered at another scale or, for the titlebar, at another
+ * position.
+ */
+struct sway_container_decorations {
+	float scale;
+
+	bool borders_valid;
+	struct wlr_box border_left, border_right, border_bottom, border_top;
+
+	bool titlebar_valid;
+	int titlebar_x, titlebar_y, titlebar_width; // layout coordinates
+	double titlebar_output_x, titlebar_output_y;
+	// Titlebar config the geometry was computed with, as the titlebar commands
+	// only rearrange some workspaces
+	int titlebar_border_thickness, titlebar_h_padding, titlebar_v_padding;
+	int font_height;
+	struct wlr_box titlebar_edges[4]; // above, below, left and right
+	struct wlr_box titlebar_padding_left, titlebar_padding_right;
+	int ob_inner_x, ob_inner_width, ob_bg_height; // output-buffer local
+};
+
 struct sway_container {
 	struct sway_node node;
 	struct sway_view *view;
@@ -134,18 +160,25 @@ struct sway_container {
 
 	float alpha;
 
-	struct wlr_texture *title_focused;
-	struct wlr_texture *title_focused_inactive;
-	struct wlr_texture *title_unfocused;
-	struct wlr_texture *title_urgent;
+	// Title and marks textures are shared through the text atlas. They are
+	// only rasterized when a titlebar using their color class is about to be
+	// rendered; the dirty masks hold one bit per color class.
+	struct sway_text_atlas_entry *title_focused;
+	struct sway_text_atlas_entry *title_focused_inactive;
+	struct sway_text_atlas_entry *title_unfocused;
+	struct sway_text_atlas_entry *title_urgent;
 	size_t title_height;
 	size_t title_baseline;
 
 	list_t *marks; // char *
-	struct wlr_texture *marks_focused;
-	struct wlr_texture *marks_focused_inactive;
-	struct wlr_texture *marks_unfocused;
-	struct wlr_texture *marks_urgent;
+	struct sway_text_atlas_entry *marks_focused;
+	struct sway_text_atlas_entry *marks_focused_inactive;
+	struct sway_text_atlas_entry *marks_unfocused;
+	struct sway_text_atlas_entry *marks_urgent;
+	uint32_t title_textures_dirty;
+	uint32_t marks_textures_dirty;
+
+	struct sway_container_decorations decorations;
 
 	struct {
 		struct wl_signal destroy;
@@ -195,8 +228,33 @@ void container_reap_empty(struct sway_container *con);
 
 struct sway_container *container_flatten(struct sway_container *container);
 
+/**
+ * Invalidate the title textures. They will be rasterized again when needed.
+ */
 void container_update_title_textures(struct sway_container *container);
 
+/**
+ * Return the title or marks texture for the given color class, or NULL if it
+ * hasn't been rasterized yet.
+ */
+struct sway_text_atlas_entry *container_get_title_texture(
+		struct sway_container *container, struct border_colors *class);
+
+struct sway_text_atlas_entry *container_get_marks_texture(
+		struct sway_container *container, struct border_colors *class);
+
+/**
+ * Rasterize the invalidated title and marks textures of the given color
+ * class. This must not be called while rendering.
+ */
+void container_prepare_titlebar_textures(struct sway_container *container,
+		struct border_colors *class);
+
+/**
+ * Free all title and marks textures, e.g. when the container is hidden.
+ */
+void container_release_titlebar_textures(struct sway_container *container);
+
 /**
  * Calculate the container's title_height property.
  */
@@ -357,6 +415,9 @@ bool container_has_mark(struct sway_container *container, char *mark);
 
 void container_add_mark(struct sway_container *container, char *mark);
 
+/**
+ * Invalidate the marks textures. They will be rasterized again when needed.
+ */
 void container_update_marks_textures(struct sway_container *container);
 
 void container_raise_floating(struct sway_container *con);
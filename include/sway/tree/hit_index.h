@@ -0,0 +1,70 @@
+#ifndef _SWAY_HIT_INDEX_H
+#define _SWAY_HIT_INDEX_H
+#include <stdbool.h>
+#include <stdint.h>
+#include <wlr/types/wlr_box.h>
+#include "sway/tree/node.h"
+
+/**
+ * A hit index answers "which container is at this point" for the tiling tree
+ * of a workspace or for the floating containers of all visible workspaces,
+ * without walking every container on each pointer motion.
+ *
+ * The tree is flattened into an ordered list of entries: views, and tabbed or
+ * stacked containers, which are resolved with tiling_container_at() at query
+ * time because their visible child depends on focus. The entries are bucketed
+ * into a uniform grid, and a query only evaluates the entries of the grid
+ * cell containing the point, in order, which gives the same result as the
+ * recursive walk.
+ *
+ * All indexes are invalidated by hit_index_invalidate() whenever a node is
+ * marked dirty, and rebuilt lazily by the next query.
+ */
+
+struct sway_hit_entry {
+	struct sway_node *node;
+	struct wlr_box box; // bounds of the entry, inclusive on all edges
+	bool is_view;
+	// Whether the box's interior intersects that of an earlier entry, in
+	// which case the earlier entry takes precedence and the fast path can't
+	// be used. Edge points are left to the grid lookup.
+	bool overlaps_earlier;
+};
+
+struct sway_hit_index {
+	uint64_t generation;
+
+	struct sway_hit_entry *entries;
+	int length, capacity;
+
+	// The grid, with cell_start[i] to cell_start[i + 1] being the range of
+	// cell_entries holding the entries of cell i
+	int x, y, cell_size;
+	int cols, rows;
+	int *cell_start;
+	int cell_start_capacity;
+	int *cell_entries;
+	int cell_entries_capacity;
+
+	int last_hit; // entry of the previous hit, or -1
+};
+
+void hit_index_invalidate(void);
+
+void hit_index_destroy(struct sway_hit_index *index);
+
+/**
+ * Equivalent to tiling_container_at() for the workspace.
+ */
+struct sway_container *hit_index_tiling_at(struct sway_workspace *ws,
+		double lx, double ly,
+		struct wlr_surface **surface, double *sx, double *sy);
+
+/**
+ * Find the topmost floating container of all visible workspaces at the given
+ * layout coordinates.
+ */
+struct sway_container *hit_index_floating_at(double lx, double ly,
+		struct wlr_surface **surface, double *sx, double *sy);
+
+#endif
@@ -1,6 +1,8 @@
 #ifndef _SWAY_NODE_H
 #define _SWAY_NODE_H
 #include <stdbool.h>
+#include <stdint.h>
+#include <wayland-server-core.h>
 #include "list.h"
 
 #define MIN_SANE_W 100
@@ -37,12 +39,30 @@ struct sway_node {
 
 	struct sway_transaction_instruction *instruction;
 	size_t ntxnrefs;
+
+	// The instructions holding new state for this node in the committed and
+	// in the queued transaction, if any. A node is part of at most one of
+	// each. See transaction.c.
+	struct sway_transaction_instruction *committed_instruction;
+	struct sway_transaction_instruction *queued_instruction;
 	bool destroying;
 
 	// If true, indicates that the container has pending state that differs from
 	// the current.
 	bool dirty;
 
+	// Bumped whenever the node changes in a way that may show up in its IPC
+	// description. All nodes draw from the same counter, so generations can
+	// be compared across nodes.
+	uint64_t generation;
+
+	// The node's serialized IPC description without its children, valid as
+	// long as json_cache_generation matches generation. See ipc-json.c.
+	char *json_cache;
+	uint64_t json_cache_generation;
+
+	struct wl_list seat_nodes; // sway_seat_node::node_link
+
 	struct {
 		struct wl_signal destroy;
 	} events;
@@ -58,6 +78,31 @@ const char *node_type_to_str(enum sway_node_type type);
  */
 void node_set_dirty(struct sway_node *node);
 
+/**
+ * Mark a node as changed for IPC purposes without scheduling a transaction.
+ * This is implied by node_set_dirty.
+ */
+void node_bump_generation(struct sway_node *node);
+
+/**
+ * Return the most recent generation handed out to any node.
+ */
+uint64_t node_get_current_generation(void);
+
+/**
+ * Record that a node has been removed from the tree, so incremental GET_TREE
+ * requests can report it.
+ */
+void node_record_removal(struct sway_node *node);
+
+/**
+ * Call the iterator with the ID of every node removed after the given
+ * generation. Returns false if the removal log doesn't reach back that far,
+ * in which case the iterator is not called.
+ */
+bool node_for_each_removal_since(uint64_t generation,
+		void (*f)(size_t id, void *data), void *data);
+
 bool node_is_view(struct sway_node *node);
 
 char *node_get_name(struct sway_node *node);
@@ -7,10 +7,13 @@
 #include "sway/tree/container.h"
 #include "sway/tree/node.h"
 #include "config.h"
+#include "hash_table.h"
 #include "list.h"
 
 extern struct sway_root *root;
 
+struct sway_hit_index;
+
 struct sway_root {
 	struct sway_node node;
 	struct wlr_output_layout *output_layout;
@@ -35,6 +38,16 @@ struct sway_root {
 
 	struct sway_container *fullscreen_global;
 
+	// Floating containers of all visible workspaces
+	struct sway_hit_index *floating_hit_index;
+
+	// Lookup tables for workspace_by_name(), workspace_by_number(),
+	// output_by_name_or_id() and container_find_mark()
+	hash_table_t *workspaces_by_name; // name -> list_t of sway_workspace
+	hash_table_t *workspaces_by_number; // leading digits -> list_t
+	hash_table_t *outputs_by_name; // name or identifier -> sway_output
+	hash_table_t *marks; // mark -> sway_container
+
 	struct {
 		struct wl_signal new_node;
 	} events;
@@ -64,6 +64,23 @@ struct sway_saved_buffer {
 	struct wl_list link; // sway_view::saved_buffers
 };
 
+enum sway_view_criteria_cache_result {
+	CRITERIA_CACHE_UNKNOWN,
+	CRITERIA_CACHE_MATCH,
+	CRITERIA_CACHE_NO_MATCH,
+};
+
+/**
+ * Caches the outcome of the config's criteria regexes for a view's title,
+ * app_id and other strings, indexed by criteria position. It is reset when
+ * those strings change and discarded when the criteria change.
+ */
+struct sway_view_criteria_cache {
+	uint8_t *results; // enum sway_view_criteria_cache_result
+	int length;
+	uint64_t generation;
+};
+
 struct sway_view {
 	enum sway_view_type type;
 	const struct sway_view_impl *impl;
@@ -88,6 +105,13 @@ struct sway_view {
 
 	struct wl_list saved_buffers; // sway_saved_buffer::link
 
+	// Bumped whenever a surface of the view commits. Saved buffers taken at
+	// the current commit_seq are kept in snapshot_cache after a transaction,
+	// and reused by the next one instead of walking the surface tree again.
+	uint64_t commit_seq;
+	uint64_t snapshot_seq; // commit_seq when saved_buffers were taken
+	struct wl_list snapshot_cache; // sway_saved_buffer::link
+
 	// The geometry for whatever the client is committing, regardless of
 	// transaction state. Updated on every commit.
 	struct wlr_box geometry;
@@ -99,6 +123,7 @@ struct sway_view {
 	bool destroying;
 
 	list_t *executed_criteria; // struct criteria *
+	struct sway_view_criteria_cache criteria_cache;
 
 	union {
 		struct wlr_xdg_surface *wlr_xdg_surface;
@@ -335,6 +360,12 @@ void view_update_title(struct sway_view *view, bool force);
  */
 void view_execute_criteria(struct sway_view *view);
 
+/**
+ * Must be called when the view's title, app_id, class, instance or role
+ * changes.
+ */
+void view_invalidate_criteria_cache(struct sway_view *view);
+
 /**
  * Returns true if there's a possibility the view may be rendered on screen.
  * Intended for damage tracking.
@@ -347,8 +378,20 @@ bool view_is_urgent(struct sway_view *view);
 
 void view_remove_saved_buffer(struct sway_view *view);
 
+/**
+ * Stop rendering the view from its saved buffers. They are kept for reuse by
+ * view_save_buffer() as long as none of the view's surfaces commit.
+ */
+void view_release_saved_buffer(struct sway_view *view);
+
 void view_save_buffer(struct sway_view *view);
 
+/**
+ * Must be called when a surface of the view commits or the surface tree
+ * changes.
+ */
+void view_bump_commit_seq(struct sway_view *view);
+
 bool view_is_transient_for(struct sway_view *child, struct sway_view *ancestor);
 
 #endif
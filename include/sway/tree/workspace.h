@@ -6,6 +6,7 @@
 #include "sway/tree/node.h"
 
 struct sway_view;
+struct sway_hit_index;
 
 struct sway_workspace_state {
 	struct sway_container *fullscreen;
@@ -42,6 +43,8 @@ struct sway_workspace {
 	list_t *output_priority;
 	bool urgent;
 
+	struct sway_hit_index *hit_index; // for the tiling containers
+
 	struct sway_workspace_state current;
 };
 
@@ -63,6 +66,11 @@ char *workspace_next_name(const char *output_name);
 bool workspace_switch(struct sway_workspace *workspace,
 		bool no_auto_back_and_forth);
 
+/**
+ * Rename the workspace, taking ownership of the name.
+ */
+void workspace_set_name(struct sway_workspace *ws, char *name);
+
 struct sway_workspace *workspace_by_number(const char* name);
 
 struct sway_workspace *workspace_by_name(const char*);
@@ -0,0 +1,41 @@
+#ifndef _SWAY_WORKER_POOL_H
+#define _SWAY_WORKER_POOL_H
+#include <stdbool.h>
+#include <wayland-server-core.h>
+
+/**
+ * A small pool of threads for self-contained work which doesn't depend on
+ * compositor state, such as compiling keymaps.
+ *
+ * A job's run function is called on a worker thread and must not touch
+ * anything but its data. Once it returned, the done function is called on the
+ * main thread from the event loop, after which the job is freed.
+ */
+
+typedef void (*worker_job_func_t)(void *data);
+
+struct sway_worker_job;
+
+bool worker_pool_init(struct wl_event_loop *loop);
+
+/**
+ * Runs all queued jobs and stops the threads, then calls the done functions
+ * of the finished jobs.
+ */
+void worker_pool_finish(void);
+
+/**
+ * Queues a job. If the pool isn't running, the job is run immediately on the
+ * calling thread and NULL is returned.
+ */
+struct sway_worker_job *worker_pool_submit(worker_job_func_t run,
+		worker_job_func_t done, void *data);
+
+/**
+ * Blocks until the job has run and calls its done function. A job which
+ * wasn't picked up by a worker yet is run on the calling thread instead. The
+ * job must not be used afterwards.
+ */
+void worker_job_wait(struct sway_worker_job *job);
+
+#endif
@@ -74,6 +74,7 @@ static struct cmd_handler handlers[] = {
 	{ "hide_edge_borders", cmd_hide_edge_borders },
 	{ "include", cmd_include },
 	{ "input", cmd_input },
+	{ "ipc_backlog", cmd_ipc_backlog },
 	{ "mode", cmd_mode },
 	{ "mouse_warping", cmd_mouse_warping },
 	{ "new_float", cmd_new_float },
@@ -197,86 +198,207 @@ static void set_config_node(struct sway_node *node) {
 	}
 }
 
-list_t *execute_command(char *_exec, struct sway_seat *seat,
-		struct sway_container *con) {
-	char *cmd;
-	char matched_delim = ';';
-	list_t *containers = NULL;
+struct command_statement {
+	char *text; // the command as written, for logging
+	// Whether the statement starts a new command list, i.e. follows a ';'.
+	// Criteria are only valid for their command list.
+	bool new_list;
+	struct criteria *criteria;
+	// Set instead of criteria when they depend on the focus at parse time
+	char *criteria_raw;
+	char *error; // criteria parse error
+	struct cmd_handler *handler;
+	// Split and unquoted, but with variables not yet replaced. argc is 0 for
+	// an empty command.
+	int argc;
+	char **argv;
+};
 
-	if (seat == NULL) {
-		// passing a NULL seat means we just pick the default seat
-		seat = input_manager_get_default_seat();
-		if (!sway_assert(seat, "could not find a seat to run the command on")) {
-			return NULL;
-		}
+struct command_program {
+	list_t *statements; // struct command_statement
+	// The config state the handlers were resolved in
+	bool reading, active;
+	int running;
+	bool destroyed;
+};
+
+static void command_statement_destroy(struct command_statement *stmt) {
+	free(stmt->text);
+	if (stmt->criteria) {
+		criteria_destroy(stmt->criteria);
 	}
+	free(stmt->criteria_raw);
+	free(stmt->error);
+	free_argv(stmt->argc, stmt->argv);
+	free(stmt);
+}
 
-	char *exec = strdup(_exec);
-	char *head = exec;
-	list_t *res_list = create_list();
+void command_program_destroy(struct command_program *program) {
+	if (!program) {
+		return;
+	}
+	if (program->running) {
+		// Freed once the outermost execution returns
+		program->destroyed = true;
+		return;
+	}
+	for (int i = 0; i < program->statements->length; ++i) {
+		command_statement_destroy(program->statements->items[i]);
+	}
+	list_free(program->statements);
+	free(program);
+}
 
-	if (!res_list || !exec) {
+struct command_program *command_program_compile(const char *command) {
+	struct command_program *program = calloc(1, sizeof(struct command_program));
+	char *exec = strdup(command);
+	if (!program || !exec || !(program->statements = create_list())) {
+		free(program);
+		free(exec);
 		return NULL;
 	}
+	program->reading = config->reading;
+	program->active = config->active;
 
-	config->handler_context.seat = seat;
-
+	char *head = exec;
+	char matched_delim = ';';
 	do {
+		struct command_statement *stmt =
+			calloc(1, sizeof(struct command_statement));
+		if (!stmt) {
+			break;
+		}
+		list_add(program->statements, stmt);
+
 		for (; isspace(*head); ++head) {}
 		// Extract criteria (valid for this command list only).
 		if (matched_delim == ';') {
-			config->handler_context.using_criteria = false;
+			stmt->new_list = true;
 			if (*head == '[') {
-				char *error = NULL;
-				struct criteria *criteria = criteria_parse(head, &error);
+				struct criteria *criteria = criteria_parse(head, &stmt->error);
 				if (!criteria) {
-					list_add(res_list,
-							cmd_results_new(CMD_INVALID, "%s", error));
-					free(error);
-					goto cleanup;
+					break;
 				}
-				list_free(containers);
-				containers = criteria_get_containers(criteria);
 				head += strlen(criteria->raw);
-				criteria_destroy(criteria);
-				config->handler_context.using_criteria = true;
+				if (strstr(criteria->raw, "__focused__")) {
+					stmt->criteria_raw = strdup(criteria->raw);
+					criteria_destroy(criteria);
+				} else {
+					stmt->criteria = criteria;
+				}
 				// Skip leading whitespace
 				for (; isspace(*head); ++head) {}
 			}
 		}
 		// Split command list
-		cmd = argsep(&head, ";,", &matched_delim);
+		char *cmd = argsep(&head, ";,", &matched_delim);
 		for (; isspace(*cmd); ++cmd) {}
 
 		if (strcmp(cmd, "") == 0) {
-			sway_log(SWAY_INFO, "Ignoring empty command.");
 			continue;
 		}
-		sway_log(SWAY_INFO, "Handling command '%s'", cmd);
+		stmt->text = strdup(cmd);
 		//TODO better handling of argv
-		int argc;
-		char **argv = split_args(cmd, &argc);
+		stmt->argv = split_args(cmd, &stmt->argc);
+		char **argv = stmt->argv;
 		if (strcmp(argv[0], "exec") != 0 &&
 				strcmp(argv[0], "exec_always") != 0 &&
 				strcmp(argv[0], "mode") != 0) {
-			for (int i = 1; i < argc; ++i) {
+			for (int i = 1; i < stmt->argc; ++i) {
 				if (*argv[i] == '\"' || *argv[i] == '\'') {
 					strip_quotes(argv[i]);
 				}
 			}
 		}
-		struct cmd_handler *handler = find_core_handler(argv[0]);
-		if (!handler) {
-			list_add(res_list, cmd_results_new(CMD_INVALID,
-					"Unknown/invalid command '%s'", argv[0]));
-			free_argv(argc, argv);
-			goto cleanup;
+		stmt->handler = find_core_handler(argv[0]);
+		if (!stmt->handler) {
+			break;
 		}
+	} while(head);
+
+	free(exec);
+	return program;
+}
+
+struct command_program *command_program_cache(
+		struct command_program **cache, const char *command) {
+	if (*cache && ((*cache)->reading != config->reading ||
+				(*cache)->active != config->active)) {
+		command_program_destroy(*cache);
+		*cache = NULL;
+	}
+	if (!*cache) {
+		*cache = command_program_compile(command);
+	}
+	return *cache;
+}
 
-		// Var replacement, for all but first argument of set
-		for (int i = handler->handle == cmd_set ? 2 : 1; i < argc; ++i) {
+/**
+ * Copy the statement's arguments for a handler, which may modify them.
+ */
+static char **statement_argv(struct command_statement *stmt) {
+	char **argv = malloc((stmt->argc + 1) * sizeof(char *));
+	if (!argv) {
+		return NULL;
+	}
+	// Var replacement, for all but first argument of set
+	int first_var = stmt->handler->handle == cmd_set ? 2 : 1;
+	for (int i = 0; i < stmt->argc; ++i) {
+		argv[i] = strdup(stmt->argv[i]);
+		if (i >= first_var && strchr(argv[i], '$')) {
 			argv[i] = do_var_replacement(argv[i]);
 		}
+	}
+	argv[stmt->argc] = NULL;
+	return argv;
+}
+
+static void execute_program(struct command_program *program,
+		struct sway_seat *seat, struct sway_container *con, list_t *res_list) {
+	list_t *containers = NULL;
+	config->handler_context.seat = seat;
+
+	for (int s = 0; s < program->statements->length; ++s) {
+		struct command_statement *stmt = program->statements->items[s];
+		if (stmt->new_list) {
+			config->handler_context.using_criteria = false;
+			struct criteria *criteria = stmt->criteria;
+			char *error = NULL;
+			if (stmt->criteria_raw) {
+				criteria = criteria_parse(stmt->criteria_raw, &error);
+			}
+			if (stmt->error || error) {
+				list_add(res_list, cmd_results_new(CMD_INVALID, "%s",
+							stmt->error ? stmt->error : error));
+				free(error);
+				goto cleanup;
+			}
+			if (criteria) {
+				list_free(containers);
+				containers = criteria_get_containers(criteria);
+				if (criteria != stmt->criteria) {
+					criteria_destroy(criteria);
+				}
+				config->handler_context.using_criteria = true;
+			}
+		}
+
+		if (!stmt->argc) {
+			sway_log(SWAY_INFO, "Ignoring empty command.");
+			continue;
+		}
+		sway_log(SWAY_INFO, "Handling command '%s'", stmt->text);
+		if (!stmt->handler) {
+			list_add(res_list, cmd_results_new(CMD_INVALID,
+					"Unknown/invalid command '%s'", stmt->argv[0]));
+			goto cleanup;
+		}
+		struct cmd_handler *handler = stmt->handler;
+		int argc = stmt->argc;
+		char **argv = statement_argv(stmt);
+		if (!argv) {
+			goto cleanup;
+		}
 
 		if (!config->handler_context.using_criteria) {
 			// The container or workspace which this command will run on.
@@ -317,10 +439,44 @@ list_t *execute_command(char *_exec, struct sway_seat *seat,
 					fail_res ? fail_res : cmd_results_new(CMD_SUCCESS, NULL));
 		}
 		free_argv(argc, argv);
-	} while(head);
+	}
 cleanup:
-	free(exec);
 	list_free(containers);
+}
+
+list_t *command_program_execute(struct command_program *program,
+		struct sway_seat *seat, struct sway_container *con) {
+	if (seat == NULL) {
+		// passing a NULL seat means we just pick the default seat
+		seat = input_manager_get_default_seat();
+		if (!sway_assert(seat, "could not find a seat to run the command on")) {
+			return NULL;
+		}
+	}
+
+	list_t *res_list = create_list();
+	if (!res_list) {
+		return NULL;
+	}
+
+	// A command such as reload can destroy the program while it runs
+	++program->running;
+	execute_program(program, seat, con, res_list);
+	if (--program->running == 0 && program->destroyed) {
+		program->destroyed = false;
+		command_program_destroy(program);
+	}
+	return res_list;
+}
+
+list_t *execute_command(char *_exec, struct sway_seat *seat,
+		struct sway_container *con) {
+	struct command_program *program = command_program_compile(_exec);
+	if (!program) {
+		return NULL;
+	}
+	list_t *res_list = command_program_execute(program, seat, con);
+	command_program_destroy(program);
 	return res_list;
 }
 
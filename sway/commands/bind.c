@@ -27,6 +27,7 @@ void free_sway_binding(struct sway_binding *binding) {
 	list_free_items_and_destroy(binding->syms);
 	free(binding->input);
 	free(binding->command);
+	command_program_destroy(binding->program);
 	free(binding);
 }
 
@@ -35,6 +36,7 @@ void free_switch_binding(struct sway_switch_binding *binding) {
 		return;
 	}
 	free(binding->command);
+	command_program_destroy(binding->program);
 	free(binding);
 }
 
@@ -480,6 +482,9 @@ static struct cmd_results *cmd_bindsym_or_bindcode(int argc, char **argv,
 	} else {
 		mode_bindings = config->current_mode->mouse_bindings;
 	}
+	if (binding->type == BINDING_KEYCODE || binding->type == BINDING_KEYSYM) {
+		mode_invalidate_binding_index(config->current_mode);
+	}
 
 	if (unbind) {
 		return binding_remove(binding, mode_bindings, bindtype, argv[0]);
@@ -609,6 +614,7 @@ void seat_execute_command(struct sway_seat *seat, struct sway_binding *binding)
 		}
 		memcpy(deferred, binding, sizeof(struct sway_binding));
 		deferred->command = binding->command ? strdup(binding->command) : NULL;
+		deferred->program = NULL;
 		list_add(seat->deferred_bindings, deferred);
 		return;
 	}
@@ -627,7 +633,13 @@ void seat_execute_command(struct sway_seat *seat, struct sway_binding *binding)
 		}
 	}
 
-	list_t *res_list = execute_command(binding->command, seat, con);
+	struct command_program *program =
+		command_program_cache(&binding->program, binding->command);
+	list_t *res_list = program ?
+		command_program_execute(program, seat, con) : NULL;
+	if (!res_list) {
+		return;
+	}
 	bool success = true;
 	for (int i = 0; i < res_list->length; ++i) {
 		struct cmd_results *results = res_list->items[i];
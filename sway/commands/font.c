@@ -22,6 +22,10 @@ struct cmd_results *cmd_font(int argc, char **argv) {
 	}
 
 	free(font);
-	config_update_font_height(true);
+	// When reading the config, the font height is calculated once after the
+	// whole config has been loaded
+	if (!config->reading) {
+		config_update_font_height(true);
+	}
 	return cmd_results_new(CMD_SUCCESS, NULL);
 }
@@ -0,0 +1,36 @@
+#include <stdlib.h>
+#include <strings.h>
+#include "sway/commands.h"
+#include "sway/config.h"
+
+struct cmd_results *cmd_ipc_backlog(int argc, char **argv) {
+	struct cmd_results *error = NULL;
+	if ((error = checkarg(argc, "ipc_backlog", EXPECTED_AT_LEAST, 1))) {
+		return error;
+	}
+	if ((error = checkarg(argc, "ipc_backlog", EXPECTED_AT_MOST, 2))) {
+		return error;
+	}
+
+	const char usage[] = "Expected 'ipc_backlog <kilobytes> [drop|disconnect]'";
+
+	char *end;
+	long kilobytes = strtol(argv[0], &end, 10);
+	if (*end || kilobytes <= 0) {
+		return cmd_results_new(CMD_INVALID, usage);
+	}
+
+	enum ipc_backlog_policy policy = IPC_BACKLOG_DISCONNECT;
+	if (argc > 1) {
+		if (strcasecmp(argv[1], "drop") == 0) {
+			policy = IPC_BACKLOG_DROP;
+		} else if (strcasecmp(argv[1], "disconnect") != 0) {
+			return cmd_results_new(CMD_INVALID, usage);
+		}
+	}
+
+	config->ipc_backlog_size = (size_t)kilobytes * 1024;
+	config->ipc_backlog_policy = policy;
+
+	return cmd_results_new(CMD_SUCCESS, NULL);
+}
@@ -27,6 +27,7 @@ struct cmd_results *cmd_max_render_time(int argc, char **argv) {
 
 	struct sway_view *view = container->view;
 	view->max_render_time = max_render_time;
+	node_bump_generation(&container->node);
 
 	return cmd_results_new(CMD_SUCCESS, NULL);
 }
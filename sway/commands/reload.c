@@ -2,6 +2,7 @@
 #include <string.h>
 #include "sway/commands.h"
 #include "sway/config.h"
+#include "sway/input/keyboard.h"
 #include "sway/ipc-server.h"
 #include "sway/server.h"
 #include "sway/tree/arrange.h"
@@ -43,8 +44,10 @@ static void do_reload(void *data) {
 	}
 	list_free_items_and_destroy(bar_ids);
 
-	config_update_font_height(true);
-	root_for_each_container(rebuild_textures_iterator, NULL);
+	if (config->reload_textures) {
+		config_update_font_height(true);
+		root_for_each_container(rebuild_textures_iterator, NULL);
+	}
 
 	arrange_root();
 }
@@ -55,6 +58,11 @@ struct cmd_results *cmd_reload(int argc, char **argv) {
 		return error;
 	}
 
+	// Keymaps are compiled again in case the xkb files changed, the reload
+	// itself reuses the keymaps compiled by the validation. Keyboards whose
+	// keymap differs are reconfigured even if their config didn't change.
+	sway_keyboard_clear_keymap_cache();
+
 	if (!load_main_config(config->current_config_path, true, true)) {
 		return cmd_results_new(CMD_FAILURE, "Error(s) reloading config.");
 	}
@@ -93,8 +93,7 @@ struct cmd_results *cmd_rename(int argc, char **argv) {
 
 	root_rename_pid_workspaces(workspace->name, new_name);
 
-	free(workspace->name);
-	workspace->name = new_name;
+	workspace_set_name(workspace, new_name);
 
 	output_sort_workspaces(workspace->output);
 	ipc_event_workspace(NULL, workspace, "rename");
@@ -0,0 +1,25 @@
+#include <string.h>
+#include "sway/commands.h"
+#include "sway/config.h"
+
+// motion_batching enable|disable
+struct cmd_results *seat_cmd_motion_batching(int argc, char **argv) {
+	struct cmd_results *error = NULL;
+	if ((error = checkarg(argc, "motion_batching", EXPECTED_EQUAL_TO, 1))) {
+		return error;
+	}
+	if (!config->handler_context.seat_config) {
+		return cmd_results_new(CMD_FAILURE, "No seat defined");
+	}
+
+	struct seat_config *seat_config = config->handler_context.seat_config;
+	if (strcmp(argv[0], "enable") == 0) {
+		seat_config->motion_batching = MOTION_BATCHING_ENABLE;
+	} else if (strcmp(argv[0], "disable") == 0) {
+		seat_config->motion_batching = MOTION_BATCHING_DISABLE;
+	} else {
+		return cmd_results_new(CMD_INVALID,
+				"Expected 'motion_batching enable|disable'");
+	}
+	return cmd_results_new(CMD_SUCCESS, NULL);
+}
@@ -8,11 +8,25 @@
 #include "log.h"
 #include "stringop.h"
 
-// sort in order of longest->shortest
-static int compare_set_qsort(const void *_l, const void *_r) {
-	struct sway_variable const *l = *(void **)_l;
-	struct sway_variable const *r = *(void **)_r;
-	return strlen(r->name) - strlen(l->name);
+static bool add_symbol_length(int len) {
+	int i = 0;
+	while (i < config->symbol_lengths_count && config->symbol_lengths[i] > len) {
+		++i;
+	}
+	if (i < config->symbol_lengths_count && config->symbol_lengths[i] == len) {
+		return true;
+	}
+	int *lengths = realloc(config->symbol_lengths,
+			(config->symbol_lengths_count + 1) * sizeof(int));
+	if (!lengths) {
+		return false;
+	}
+	memmove(&lengths[i + 1], &lengths[i],
+			(config->symbol_lengths_count - i) * sizeof(int));
+	lengths[i] = len;
+	config->symbol_lengths = lengths;
+	config->symbol_lengths_count++;
+	return true;
 }
 
 void free_sway_variable(struct sway_variable *var) {
@@ -34,26 +48,20 @@ struct cmd_results *cmd_set(int argc, char **argv) {
 		return cmd_results_new(CMD_INVALID, "variable '%s' must start with $", argv[0]);
 	}
 
-	struct sway_variable *var = NULL;
 	// Find old variable if it exists
-	int i;
-	for (i = 0; i < config->symbols->length; ++i) {
-		var = config->symbols->items[i];
-		if (strcmp(var->name, argv[0]) == 0) {
-			break;
-		}
-		var = NULL;
-	}
+	struct sway_variable *var =
+		hash_table_get(config->symbols_by_name, argv[0]);
 	if (var) {
 		free(var->value);
 	} else {
 		var = malloc(sizeof(struct sway_variable));
-		if (!var) {
+		if (!var || !add_symbol_length(strlen(argv[0]))) {
+			free(var);
 			return cmd_results_new(CMD_FAILURE, "Unable to allocate variable");
 		}
 		var->name = strdup(argv[0]);
 		list_add(config->symbols, var);
-		list_qsort(config->symbols, compare_set_qsort);
+		hash_table_set(config->symbols_by_name, var->name, var);
 	}
 	var->value = join_args(argv + 1, argc - 1);
 	return cmd_results_new(CMD_SUCCESS, NULL);
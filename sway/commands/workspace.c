@@ -28,6 +28,7 @@ static struct workspace_config *workspace_config_find_or_create(char *ws_name) {
 	wsc->gaps_outer.bottom = INT_MIN;
 	wsc->gaps_outer.left = INT_MIN;
 	list_add(config->workspace_configs, wsc);
+	hash_table_set(config->workspace_configs_by_name, wsc->workspace, wsc);
 	return wsc;
 }
 
@@ -16,6 +16,7 @@
 #include <linux/input-event-codes.h>
 #include <wlr/types/wlr_output.h>
 #include "sway/input/input-manager.h"
+#include "sway/input/keyboard.h"
 #include "sway/input/seat.h"
 #include "sway/input/switch.h"
 #include "sway/commands.h"
@@ -37,13 +38,8 @@ struct sway_config *config = NULL;
 
 static struct xkb_state *keysym_translation_state_create(
 		struct xkb_rule_names rules) {
-	struct xkb_context *context = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
-	struct xkb_keymap *xkb_keymap = xkb_keymap_new_from_names(
-		context,
-		&rules,
-		XKB_KEYMAP_COMPILE_NO_FLAGS);
-
-	xkb_context_unref(context);
+	struct xkb_keymap *xkb_keymap =
+		sway_keyboard_compile_keymap_from_names(&rules);
 	return xkb_state_new(xkb_keymap);
 }
 
@@ -58,6 +54,7 @@ static void free_mode(struct sway_mode *mode) {
 		return;
 	}
 	free(mode->name);
+	mode_invalidate_binding_index(mode);
 	if (mode->keysym_bindings) {
 		for (int i = 0; i < mode->keysym_bindings->length; i++) {
 			free_sway_binding(mode->keysym_bindings->items[i]);
@@ -99,6 +96,8 @@ void free_config(struct sway_config *config) {
 		}
 		list_free(config->symbols);
 	}
+	hash_table_free(config->symbols_by_name);
+	free(config->symbol_lengths);
 	if (config->modes) {
 		for (int i = 0; i < config->modes->length; ++i) {
 			free_mode(config->modes->items[i]);
@@ -118,6 +117,7 @@ void free_config(struct sway_config *config) {
 		}
 		list_free(config->workspace_configs);
 	}
+	hash_table_free(config->workspace_configs_by_name);
 	if (config->output_configs) {
 		for (int i = 0; i < config->output_configs->length; i++) {
 			free_output_config(config->output_configs->items[i]);
@@ -151,6 +151,7 @@ void free_config(struct sway_config *config) {
 		}
 		list_free(config->criteria);
 	}
+	criteria_index_destroy(config->criteria_index);
 	list_free(config->no_focus);
 	list_free(config->active_bar_modifiers);
 	list_free_items_and_destroy(config->config_chain);
@@ -201,9 +202,11 @@ static void config_defaults(struct sway_config *config) {
 	config->swaynag_config_errors.detailed = true;
 
 	if (!(config->symbols = create_list())) goto cleanup;
+	if (!(config->symbols_by_name = create_hash_table())) goto cleanup;
 	if (!(config->modes = create_list())) goto cleanup;
 	if (!(config->bars = create_list())) goto cleanup;
 	if (!(config->workspace_configs = create_list())) goto cleanup;
+	if (!(config->workspace_configs_by_name = create_hash_table())) goto cleanup;
 	if (!(config->criteria = create_list())) goto cleanup;
 	if (!(config->no_focus = create_list())) goto cleanup;
 	if (!(config->seat_configs = create_list())) goto cleanup;
@@ -214,7 +217,7 @@ static void config_defaults(struct sway_config *config) {
 
 	if (!(config->cmd_queue = create_list())) goto cleanup;
 
-	if (!(config->current_mode = malloc(sizeof(struct sway_mode))))
+	if (!(config->current_mode = calloc(1, sizeof(struct sway_mode))))
 		goto cleanup;
 	if (!(config->current_mode->name = malloc(sizeof("default")))) goto cleanup;
 	strcpy(config->current_mode->name, "default");
@@ -241,6 +244,8 @@ static void config_defaults(struct sway_config *config) {
 	config->focus_on_window_activation = FOWA_URGENT;
 	config->popup_during_fullscreen = POPUP_SMART;
 	config->xwayland = XWAYLAND_MODE_LAZY;
+	config->ipc_backlog_size = 4 * 1024 * 1024;
+	config->ipc_backlog_policy = IPC_BACKLOG_DISCONNECT;
 
 	config->titlebar_border_thickness = 1;
 	config->titlebar_h_padding = 5;
@@ -384,14 +389,12 @@ static bool load_config(const char *path, struct sway_config *config,
 		return false;
 	}
 
-	FILE *f = fopen(path, "r");
-	if (!f) {
-		sway_log(SWAY_ERROR, "Unable to open %s for reading", path);
+	struct config_file *file = config_file_load(path);
+	if (!file) {
 		return false;
 	}
 
-	bool config_load_success = read_config(f, config, swaynag);
-	fclose(f);
+	bool config_load_success = read_config(file, config, swaynag);
 
 	if (!config_load_success) {
 		sway_log(SWAY_ERROR, "Error(s) loading config!");
@@ -435,15 +438,9 @@ bool load_main_config(const char *file, bool is_active, bool validating) {
 		config->xwayland = old_config->xwayland;
 
 		if (!config->validating) {
-			if (old_config->swaybg_client != NULL) {
-				wl_client_destroy(old_config->swaybg_client);
-			}
-
 			if (old_config->swaynag_config_errors.client != NULL) {
 				wl_client_destroy(old_config->swaynag_config_errors.client);
 			}
-
-			input_manager_reset_all_inputs();
 		}
 	}
 
@@ -451,6 +448,7 @@ bool load_main_config(const char *file, bool is_active, bool validating) {
 	list_add(config->config_chain, real_path);
 
 	config->reading = true;
+	config_file_cache_begin();
 
 	// Read security configs
 	// TODO: Security
@@ -509,25 +507,38 @@ bool load_main_config(const char *file, bool is_active, bool validating) {
 		return success;
 	}
 
+	config_file_cache_prune();
+
+	// Keyboards compile these when they are configured, which at startup
+	// happens as the backend is started
+	for (int i = 0; i < config->input_configs->length; i++) {
+		sway_keyboard_prepare_keymap(config->input_configs->items[i]);
+	}
+	for (int i = 0; i < config->input_type_configs->length; i++) {
+		sway_keyboard_prepare_keymap(config->input_type_configs->items[i]);
+	}
+	sway_keyboard_prepare_keymap(NULL);
+
 	if (is_active && !validating) {
+		// Only the sections which differ from the previous config are
+		// applied, so that a reload doesn't reset devices or modeset outputs
+		// which it doesn't affect
 		input_manager_verify_fallback_seat();
+		input_manager_apply_changed_input_configs(old_config);
+		input_manager_apply_changed_seat_configs(old_config);
+		sway_switch_retrigger_bindings_for_all();
 
-		for (int i = 0; i < config->input_configs->length; i++) {
-			input_manager_apply_input_config(config->input_configs->items[i]);
-		}
-
-		for (int i = 0; i < config->input_type_configs->length; i++) {
-			input_manager_apply_input_config(
-					config->input_type_configs->items[i]);
+		reset_changed_outputs(old_config);
+		if (!adopt_swaybg(old_config)) {
+			spawn_swaybg();
 		}
+		adopt_swaybars(old_config);
 
-		for (int i = 0; i < config->seat_configs->length; i++) {
-			input_manager_apply_seat_config(config->seat_configs->items[i]);
+		config->reload_textures = config_textures_changed(old_config, config);
+		if (!config->reload_textures) {
+			config->font_height = old_config->font_height;
+			config->font_baseline = old_config->font_baseline;
 		}
-		sway_switch_retrigger_bindings_for_all();
-
-		reset_outputs();
-		spawn_swaybg();
 
 		config->reloading = false;
 		if (config->swaynag_config_errors.client != NULL) {
@@ -669,60 +680,6 @@ void run_deferred_bindings(void) {
 	}
 }
 
-// get line, with backslash continuation
-static ssize_t getline_with_cont(char **lineptr, size_t *line_size, FILE *file,
-		int *nlines) {
-	char *next_line = NULL;
-	size_t next_line_size = 0;
-	ssize_t nread = getline(lineptr, line_size, file);
-	*nlines = nread == -1 ? 0 : 1;
-	while (nread >= 2 && strcmp(&(*lineptr)[nread - 2], "\\\n") == 0 && (*lineptr)[0] != '#') {
-		ssize_t next_nread = getline(&next_line, &next_line_size, file);
-		if (next_nread == -1) {
-			break;
-		}
-		(*nlines)++;
-
-		nread += next_nread - 2;
-		if ((ssize_t) *line_size < nread + 1) {
-			*line_size = nread + 1;
-			char *old_ptr = *lineptr;
-			*lineptr = realloc(*lineptr, *line_size);
-			if (!*lineptr) {
-				free(old_ptr);
-				nread = -1;
-				break;
-			}
-		}
-		strcpy(&(*lineptr)[nread - next_nread], next_line);
-	}
-	free(next_line);
-	return nread;
-}
-
-static int detect_brace(FILE *file) {
-	int ret = 0;
-	int lines = 0;
-	long pos = ftell(file);
-	char *line = NULL;
-	size_t line_size = 0;
-	while ((getline(&line, &line_size, file)) != -1) {
-		lines++;
-		strip_whitespace(line);
-		if (*line) {
-			if (strcmp(line, "{") == 0) {
-				ret = lines;
-			}
-			break;
-		}
-	}
-	free(line);
-	if (ret == 0) {
-		fseek(file, pos, SEEK_SET);
-	}
-	return ret;
-}
-
 static char *expand_line(const char *block, const char *line, bool add_brace) {
 	int size = (block ? strlen(block) + 1 : 0) + strlen(line)
 		+ (add_brace ? 2 : 0) + 1;
@@ -736,71 +693,23 @@ static char *expand_line(const char *block, const char *line, bool add_brace) {
 	return expanded;
 }
 
-bool read_config(FILE *file, struct sway_config *config,
+bool read_config(struct config_file *file, struct sway_config *config,
 		struct swaynag_instance *swaynag) {
-	bool reading_main_config = false;
-	char *this_config = NULL;
-	size_t config_size = 0;
 	if (config->current_config == NULL) {
-		reading_main_config = true;
-
-		int ret_seek = fseek(file, 0, SEEK_END);
-		long ret_tell = ftell(file);
-		if (ret_seek == -1 || ret_tell == -1) {
-			sway_log(SWAY_ERROR, "Unable to get size of config file");
-			return false;
-		}
-		config_size = ret_tell;
-		rewind(file);
-
-		config->current_config = this_config = calloc(1, config_size + 1);
-		if (this_config == NULL) {
+		config->current_config = strdup(file->contents);
+		if (config->current_config == NULL) {
 			sway_log(SWAY_ERROR, "Unable to allocate buffer for config contents");
 			return false;
 		}
 	}
 
 	bool success = true;
-	int line_number = 0;
-	char *line = NULL;
-	size_t line_size = 0;
-	ssize_t nread;
 	list_t *stack = create_list();
-	size_t read = 0;
-	int nlines = 0;
-	while ((nread = getline_with_cont(&line, &line_size, file, &nlines)) != -1) {
-		if (reading_main_config) {
-			if (read + nread > config_size) {
-				sway_log(SWAY_ERROR, "Config file changed during reading");
-				success = false;
-				break;
-			}
-
-			strcpy(&this_config[read], line);
-			read += nread;
-		}
-
-		if (line[nread - 1] == '\n') {
-			line[nread - 1] = '\0';
-		}
-
-		line_number += nlines;
-		sway_log(SWAY_DEBUG, "Read line %d: %s", line_number, line);
-
-		strip_whitespace(line);
-		if (!*line || line[0] == '#') {
-			continue;
-		}
-		int brace_detected = 0;
-		if (line[strlen(line) - 1] != '{' && line[strlen(line) - 1] != '}') {
-			brace_detected = detect_brace(file);
-			if (brace_detected > 0) {
-				line_number += brace_detected;
-				sway_log(SWAY_DEBUG, "Detected open brace on line %d", line_number);
-			}
-		}
+	for (int i = 0; i < file->length; ++i) {
+		char *line = file->lines[i].text;
+		int line_number = file->lines[i].line_number;
 		char *block = stack->length ? stack->items[0] : NULL;
-		char *expanded = expand_line(block, line, brace_detected > 0);
+		char *expanded = expand_line(block, line, file->lines[i].brace);
 		if (!expanded) {
 			success = false;
 			break;
@@ -867,7 +776,6 @@ bool read_config(FILE *file, struct sway_config *config,
 		free(expanded);
 		free_cmd_results(res);
 	}
-	free(line);
 	list_free_items_and_destroy(stack);
 	config->current_config_line_number = 0;
 	config->current_config_line = NULL;
@@ -899,56 +807,101 @@ void config_add_swaynag_warning(char *fmt, ...) {
 	}
 }
 
-char *do_var_replacement(char *str) {
-	int i;
-	char *find = str;
-	while ((find = strchr(find, '$'))) {
-		// Skip if escaped.
-		if (find > str && find[-1] == '\\') {
-			if (find == str + 1 || !(find > str + 1 && find[-2] == '\\')) {
-				++find;
-				continue;
-			}
+struct expansion_buffer {
+	char *data;
+	size_t len, capacity;
+	bool failed;
+};
+
+static void expansion_append(struct expansion_buffer *buf, const char *data,
+		size_t len) {
+	if (buf->failed) {
+		return;
+	}
+	if (buf->len + len + 1 > buf->capacity) {
+		size_t capacity = buf->capacity ? buf->capacity : 64;
+		while (capacity < buf->len + len + 1) {
+			capacity *= 2;
+		}
+		char *new_data = realloc(buf->data, capacity);
+		if (!new_data) {
+			buf->failed = true;
+			return;
 		}
-		// Unescape double $ and move on
-		if (find[1] == '$') {
-			size_t length = strlen(find + 1);
-			memmove(find, find + 1, length);
-			find[length] = '\0';
-			++find;
+		buf->data = new_data;
+		buf->capacity = capacity;
+	}
+	memcpy(buf->data + buf->len, data, len);
+	buf->len += len;
+	buf->data[buf->len] = '\0';
+}
+
+/**
+ * Returns the longest variable whose name is a prefix of str, which must
+ * start with a '$'. str is temporarily terminated after each candidate name
+ * to look it up.
+ */
+static struct sway_variable *find_variable(char *str) {
+	size_t remaining = strlen(str);
+	for (int i = 0; i < config->symbol_lengths_count; ++i) {
+		size_t len = config->symbol_lengths[i];
+		if (len > remaining) {
 			continue;
 		}
-		// Find matching variable
-		for (i = 0; i < config->symbols->length; ++i) {
-			struct sway_variable *var = config->symbols->items[i];
-			int vnlen = strlen(var->name);
-			if (strncmp(find, var->name, vnlen) == 0) {
-				int vvlen = strlen(var->value);
-				char *newstr = malloc(strlen(str) - vnlen + vvlen + 1);
-				if (!newstr) {
-					sway_log(SWAY_ERROR,
-						"Unable to allocate replacement "
-						"during variable expansion");
-					break;
-				}
-				char *newptr = newstr;
-				int offset = find - str;
-				strncpy(newptr, str, offset);
-				newptr += offset;
-				strncpy(newptr, var->value, vvlen);
-				newptr += vvlen;
-				strcpy(newptr, find + vnlen);
-				free(str);
-				str = newstr;
-				find = str + offset + vvlen;
-				break;
-			}
+		char c = str[len];
+		str[len] = '\0';
+		struct sway_variable *var =
+			hash_table_get(config->symbols_by_name, str);
+		str[len] = c;
+		if (var) {
+			return var;
 		}
-		if (i == config->symbols->length) {
-			++find;
+	}
+	return NULL;
+}
+
+char *do_var_replacement(char *str) {
+	char *find = strchr(str, '$');
+	if (!find) {
+		return str;
+	}
+
+	// The result is written in a single pass. Escapes are checked against
+	// the output, since an expanded value can end with a backslash.
+	struct expansion_buffer buf = {0};
+	expansion_append(&buf, str, find - str);
+	while (find) {
+		bool escaped = buf.len >= 1 && buf.data[buf.len - 1] == '\\' &&
+			(buf.len == 1 || buf.data[buf.len - 2] != '\\');
+		char *next;
+		struct sway_variable *var;
+		if (escaped) {
+			// Skip if escaped.
+			expansion_append(&buf, "$", 1);
+			next = find + 1;
+		} else if (find[1] == '$') {
+			// Unescape double $ and move on
+			expansion_append(&buf, "$", 1);
+			next = find + 2;
+		} else if ((var = find_variable(find))) {
+			expansion_append(&buf, var->value, strlen(var->value));
+			next = find + strlen(var->name);
+		} else {
+			expansion_append(&buf, "$", 1);
+			next = find + 1;
 		}
+		find = strchr(next, '$');
+		expansion_append(&buf, next, find ? (size_t)(find - next) : strlen(next));
+	}
+
+	if (buf.failed) {
+		sway_log(SWAY_ERROR,
+			"Unable to allocate replacement during variable expansion");
+		free(buf.data);
+		return str;
 	}
-	return str;
+	free(str);
+	return buf.data;
 }
 
 // the naming is intentional (albeit long): a workspace_output_cmp function
@@ -977,6 +930,14 @@ static void find_baseline_iterator(struct sway_container *con, void *data) {
 	}
 }
 
+bool config_textures_changed(struct sway_config *a, struct sway_config *b) {
+	return lenient_strcmp(a->font, b->font) != 0 ||
+		a->pango_markup != b->pango_markup ||
+		a->show_marks != b->show_marks ||
+		memcmp(&a->border_colors, &b->border_colors,
+			sizeof(a->border_colors)) != 0;
+}
+
 void config_update_font_height(bool recalculate) {
 	size_t prev_max_height = config->font_height;
 	config->font_height = 0;
@@ -1012,6 +973,111 @@ static void translate_binding_list(list_t *bindings, list_t *bindsyms,
 	}
 }
 
+/**
+ * Write the index key of a binding bucket into buf if it fits, otherwise into
+ * a new allocation. Returns the key, which must be freed if it isn't buf.
+ */
+static char *binding_index_key(char *buf, size_t size, const char *input,
+		uint32_t modifiers, bool release, const uint32_t *keys, size_t nkeys) {
+	// Room for the input, the modifiers, the flag and each key in hex
+	size_t len = strlen(input) + 1 + 9 + 2 + nkeys * 9 + 1;
+	if (len > size) {
+		buf = malloc(len);
+		if (!buf) {
+			return NULL;
+		}
+	}
+	char *p = buf;
+	p += sprintf(p, "%s\n%x%c", input, modifiers, release ? 'r' : 'p');
+	for (size_t i = 0; i < nkeys; ++i) {
+		p += sprintf(p, " %x", keys[i]);
+	}
+	return buf;
+}
+
+list_t *binding_index_lookup(hash_table_t *index, const char *input,
+		uint32_t modifiers, bool release, const uint32_t *keys, size_t nkeys) {
+	char buf[256];
+	char *key = binding_index_key(buf, sizeof(buf), input, modifiers, release,
+			keys, nkeys);
+	if (!key) {
+		return NULL;
+	}
+	list_t *bucket = hash_table_get(index, key);
+	if (key != buf) {
+		free(key);
+	}
+	return bucket;
+}
+
+static hash_table_t *build_binding_index(list_t *bindings) {
+	hash_table_t *index = create_hash_table();
+	if (!index) {
+		return NULL;
+	}
+	uint32_t keys[SWAY_KEYBOARD_PRESSED_KEYS_CAP];
+	for (int i = 0; i < bindings->length; ++i) {
+		struct sway_binding *binding = bindings->items[i];
+		binding->position = i;
+		if (binding->keys->length > SWAY_KEYBOARD_PRESSED_KEYS_CAP) {
+			continue; // can never be pressed at once
+		}
+		for (int j = 0; j < binding->keys->length; ++j) {
+			keys[j] = *(uint32_t *)binding->keys->items[j];
+		}
+
+		char buf[256];
+		char *key = binding_index_key(buf, sizeof(buf), binding->input,
+				binding->modifiers, binding->flags & BINDING_RELEASE,
+				keys, binding->keys->length);
+		if (!key) {
+			continue;
+		}
+		list_t *bucket = hash_table_get(index, key);
+		if (!bucket) {
+			bucket = create_list();
+			hash_table_set(index, key, bucket);
+		}
+		list_add(bucket, binding);
+		if (key != buf) {
+			free(key);
+		}
+	}
+	return index;
+}
+
+static void free_binding_bucket(const char *key, void *bucket, void *data) {
+	list_free(bucket);
+}
+
+static void free_binding_index(hash_table_t *index) {
+	if (index) {
+		hash_table_for_each(index, free_binding_bucket, NULL);
+		hash_table_free(index);
+	}
+}
+
+hash_table_t *mode_get_binding_index(struct sway_mode *mode,
+		enum binding_input_type type) {
+	if (type == BINDING_KEYCODE) {
+		if (!mode->keycode_index) {
+			mode->keycode_index = build_binding_index(mode->keycode_bindings);
+		}
+		return mode->keycode_index;
+	}
+	if (!mode->keysym_index) {
+		mode->keysym_index = build_binding_index(mode->keysym_bindings);
+	}
+	return mode->keysym_index;
+}
+
+void mode_invalidate_binding_index(struct sway_mode *mode) {
+	free_binding_index(mode->keysym_index);
+	free_binding_index(mode->keycode_index);
+	mode->keysym_index = NULL;
+	mode->keycode_index = NULL;
+}
+
 void translate_keysyms(struct input_config *input_config) {
 	keysym_translation_state_destroy(config->keysym_translation_state);
 
@@ -1034,6 +1100,10 @@ void translate_keysyms(struct input_config *input_config) {
 
 		mode->keysym_bindings = bindsyms;
 		mode->keycode_bindings = bindcodes;
+
+		mode_invalidate_binding_index(mode);
+		mode_get_binding_index(mode, BINDING_KEYSYM);
+		mode_get_binding_index(mode, BINDING_KEYCODE);
 	}
 
 	sway_log(SWAY_DEBUG, "Translated keysyms using config for device '%s'",
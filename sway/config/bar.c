@@ -266,6 +266,76 @@ void load_swaybar(struct bar_config *bar) {
 void load_swaybars(void) {
 	for (int i = 0; i < config->bars->length; ++i) {
 		struct bar_config *bar = config->bars->items[i];
+		if (bar->client != NULL) {
+			// Kept across a reload, it will pick up barconfig_update
+			continue;
+		}
 		load_swaybar(bar);
 	}
 }
+
+static struct bar_config *find_bar(list_t *bars, const char *id) {
+	for (int i = 0; i < bars->length; ++i) {
+		struct bar_config *bar = bars->items[i];
+		if (strcmp(bar->id, id) == 0) {
+			return bar;
+		}
+	}
+	return NULL;
+}
+
+#if HAVE_TRAY
+static bool string_lists_equal(list_t *a, list_t *b) {
+	int a_length = a ? a->length : 0, b_length = b ? b->length : 0;
+	if (a_length != b_length) {
+		return false;
+	}
+	for (int i = 0; i < a_length; ++i) {
+		if (strcmp(a->items[i], b->items[i]) != 0) {
+			return false;
+		}
+	}
+	return true;
+}
+#endif
+
+/**
+ * Whether the running swaybar can take the new config through a
+ * barconfig_update event. swaybar subscribes to events depending on some
+ * settings, and only applies others when it creates its surfaces or tray.
+ */
+static bool swaybar_can_adopt(struct bar_config *old_bar,
+		struct bar_config *bar) {
+#if HAVE_TRAY
+	if (!string_lists_equal(old_bar->tray_outputs, bar->tray_outputs)) {
+		return false;
+	}
+#endif
+	return lenient_strcmp(old_bar->swaybar_command,
+				bar->swaybar_command) == 0 &&
+		old_bar->workspace_buttons == bar->workspace_buttons &&
+		old_bar->binding_mode_indicator == bar->binding_mode_indicator &&
+		lenient_strcmp(old_bar->position, bar->position) == 0 &&
+		old_bar->gaps.top == bar->gaps.top &&
+		old_bar->gaps.right == bar->gaps.right &&
+		old_bar->gaps.bottom == bar->gaps.bottom &&
+		old_bar->gaps.left == bar->gaps.left;
+}
+
+void adopt_swaybars(struct sway_config *old_config) {
+	for (int i = 0; i < config->bars->length; ++i) {
+		struct bar_config *bar = config->bars->items[i];
+		struct bar_config *old_bar = find_bar(old_config->bars, bar->id);
+		if (!old_bar || !old_bar->client ||
+				!swaybar_can_adopt(old_bar, bar)) {
+			continue;
+		}
+		sway_log(SWAY_DEBUG, "Keeping swaybar for bar id '%s'", bar->id);
+		bar->client = old_bar->client;
+		old_bar->client = NULL;
+		wl_list_remove(&old_bar->client_destroy.link);
+		wl_list_init(&old_bar->client_destroy.link);
+		bar->client_destroy.notify = handle_swaybar_client_destroy;
+		wl_client_add_destroy_listener(bar->client, &bar->client_destroy);
+	}
+}
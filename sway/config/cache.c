@@ -0,0 +1,306 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "sway/config.h"
+#include "hash_table.h"
+#include "list.h"
+#include "log.h"
+#include "stringop.h"
+
+// Tokenized config files by real path. They are kept across reloads, so that
+// files which didn't change don't have to be read and split again.
+static hash_table_t *config_files = NULL;
+static uint64_t cache_generation = 0;
+
+static void config_file_destroy(struct config_file *file) {
+	if (!file) {
+		return;
+	}
+	for (int i = 0; i < file->length; ++i) {
+		free(file->lines[i].text);
+	}
+	free(file->lines);
+	free(file->contents);
+	free(file->path);
+	free(file);
+}
+
+// get line, with backslash continuation
+static ssize_t getline_with_cont(char **lineptr, size_t *line_size, FILE *file,
+		int *nlines) {
+	char *next_line = NULL;
+	size_t next_line_size = 0;
+	ssize_t nread = getline(lineptr, line_size, file);
+	*nlines = nread == -1 ? 0 : 1;
+	while (nread >= 2 && strcmp(&(*lineptr)[nread - 2], "\\\n") == 0 && (*lineptr)[0] != '#') {
+		ssize_t next_nread = getline(&next_line, &next_line_size, file);
+		if (next_nread == -1) {
+			break;
+		}
+		(*nlines)++;
+
+		nread += next_nread - 2;
+		if ((ssize_t) *line_size < nread + 1) {
+			*line_size = nread + 1;
+			char *old_ptr = *lineptr;
+			*lineptr = realloc(*lineptr, *line_size);
+			if (!*lineptr) {
+				free(old_ptr);
+				nread = -1;
+				break;
+			}
+		}
+		strcpy(&(*lineptr)[nread - next_nread], next_line);
+	}
+	free(next_line);
+	return nread;
+}
+
+static int detect_brace(FILE *file) {
+	int ret = 0;
+	int lines = 0;
+	long pos = ftell(file);
+	char *line = NULL;
+	size_t line_size = 0;
+	while ((getline(&line, &line_size, file)) != -1) {
+		lines++;
+		strip_whitespace(line);
+		if (*line) {
+			if (strcmp(line, "{") == 0) {
+				ret = lines;
+			}
+			break;
+		}
+	}
+	free(line);
+	if (ret == 0) {
+		fseek(file, pos, SEEK_SET);
+	}
+	return ret;
+}
+
+static bool add_line(struct config_file *file, const char *text,
+		int line_number, bool brace) {
+	if (file->length == file->capacity) {
+		int capacity = file->capacity ? file->capacity * 2 : 64;
+		struct config_line *lines =
+			realloc(file->lines, capacity * sizeof(struct config_line));
+		if (!lines) {
+			return false;
+		}
+		file->lines = lines;
+		file->capacity = capacity;
+	}
+	struct config_line *line = &file->lines[file->length];
+	if (!(line->text = strdup(text))) {
+		return false;
+	}
+	line->line_number = line_number;
+	line->brace = brace;
+	file->length++;
+	return true;
+}
+
+/**
+ * Splits the contents into the logical lines executed by read_config(): line
+ * continuations are joined, blank lines and comments are dropped, and an
+ * opening brace on its own line is folded into the line before it.
+ */
+static bool tokenize(struct config_file *file) {
+	if (file->size == 0) {
+		return true;
+	}
+	FILE *f = fmemopen(file->contents, file->size, "r");
+	if (!f) {
+		sway_log_errno(SWAY_ERROR, "Unable to tokenize %s", file->path);
+		return false;
+	}
+
+	bool success = true;
+	int line_number = 0;
+	char *line = NULL;
+	size_t line_size = 0;
+	ssize_t nread;
+	int nlines = 0;
+	while ((nread = getline_with_cont(&line, &line_size, f, &nlines)) != -1) {
+		if (line[nread - 1] == '\n') {
+			line[nread - 1] = '\0';
+		}
+
+		line_number += nlines;
+		sway_log(SWAY_DEBUG, "Read line %d: %s", line_number, line);
+
+		strip_whitespace(line);
+		if (!*line || line[0] == '#') {
+			continue;
+		}
+		int brace_detected = 0;
+		if (line[strlen(line) - 1] != '{' && line[strlen(line) - 1] != '}') {
+			brace_detected = detect_brace(f);
+			if (brace_detected > 0) {
+				line_number += brace_detected;
+				sway_log(SWAY_DEBUG, "Detected open brace on line %d", line_number);
+			}
+		}
+		if (!add_line(file, line, line_number, brace_detected > 0)) {
+			sway_log(SWAY_ERROR, "Unable to allocate config line");
+			success = false;
+			break;
+		}
+	}
+	free(line);
+	fclose(f);
+	return success;
+}
+
+static char *read_contents(const char *path, size_t *size) {
+	FILE *f = fopen(path, "r");
+	if (!f) {
+		sway_log(SWAY_ERROR, "Unable to open %s for reading", path);
+		return NULL;
+	}
+	size_t capacity = 4096, len = 0;
+	char *contents = malloc(capacity);
+	while (contents) {
+		len += fread(contents + len, 1, capacity - len - 1, f);
+		if (len < capacity - 1) {
+			break;
+		}
+		capacity *= 2;
+		char *new_contents = realloc(contents, capacity);
+		if (!new_contents) {
+			free(contents);
+		}
+		contents = new_contents;
+	}
+	bool failed = ferror(f);
+	fclose(f);
+	if (!contents || failed) {
+		sway_log(SWAY_ERROR, "Unable to read %s", path);
+		free(contents);
+		return NULL;
+	}
+	contents[len] = '\0';
+	*size = len;
+	return contents;
+}
+
+// FNV-1a
+static uint64_t hash_contents(const char *data, size_t size) {
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= (unsigned char)data[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+static bool same_stat(struct config_file *file, struct stat *sb) {
+	return file->ino == sb->st_ino && file->dev == sb->st_dev &&
+		file->size == (size_t)sb->st_size &&
+		file->mtime.tv_sec == sb->st_mtim.tv_sec &&
+		file->mtime.tv_nsec == sb->st_mtim.tv_nsec &&
+		file->ctime.tv_sec == sb->st_ctim.tv_sec &&
+		file->ctime.tv_nsec == sb->st_ctim.tv_nsec;
+}
+
+static void store_stat(struct config_file *file, struct stat *sb) {
+	file->ino = sb->st_ino;
+	file->dev = sb->st_dev;
+	file->mtime = sb->st_mtim;
+	file->ctime = sb->st_ctim;
+}
+
+struct config_file *config_file_load(const char *path) {
+	struct stat sb;
+	if (stat(path, &sb) != 0) {
+		sway_log_errno(SWAY_ERROR, "Unable to stat %s", path);
+		return NULL;
+	}
+	if (!config_files && !(config_files = create_hash_table())) {
+		return NULL;
+	}
+
+	struct config_file *file = hash_table_get(config_files, path);
+	if (file && same_stat(file, &sb)) {
+		sway_log(SWAY_DEBUG, "Using cached %s", path);
+		file->generation = cache_generation;
+		return file;
+	}
+
+	size_t size;
+	char *contents = read_contents(path, &size);
+	if (!contents) {
+		return NULL;
+	}
+	uint64_t hash = hash_contents(contents, size);
+	if (file && file->hash == hash && file->size == size &&
+			memcmp(file->contents, contents, size) == 0) {
+		// Touched, but the contents are the same
+		sway_log(SWAY_DEBUG, "Using cached %s", path);
+		free(contents);
+		store_stat(file, &sb);
+		file->generation = cache_generation;
+		return file;
+	}
+
+	struct config_file *new_file = calloc(1, sizeof(struct config_file));
+	if (!new_file || !(new_file->path = strdup(path))) {
+		sway_log(SWAY_ERROR, "Unable to allocate config file");
+		free(new_file);
+		free(contents);
+		return NULL;
+	}
+	new_file->contents = contents;
+	new_file->size = size;
+	new_file->hash = hash;
+	store_stat(new_file, &sb);
+	new_file->generation = cache_generation;
+	if (!tokenize(new_file)) {
+		config_file_destroy(new_file);
+		return NULL;
+	}
+
+	config_file_destroy(hash_table_set(config_files, path, new_file));
+	return new_file;
+}
+
+void config_file_cache_begin(void) {
+	++cache_generation;
+}
+
+static void find_stale_file(const char *key, void *value, void *data) {
+	struct config_file *file = value;
+	list_t *stale = data;
+	if (file->generation != cache_generation) {
+		list_add(stale, file);
+	}
+}
+
+void config_file_cache_prune(void) {
+	if (!config_files) {
+		return;
+	}
+	list_t *stale = create_list();
+	hash_table_for_each(config_files, find_stale_file, stale);
+	for (int i = 0; i < stale->length; ++i) {
+		struct config_file *file = stale->items[i];
+		sway_log(SWAY_DEBUG, "Dropping %s from the config cache", file->path);
+		hash_table_remove(config_files, file->path);
+		config_file_destroy(file);
+	}
+	list_free(stale);
+}
+
+void config_file_cache_finish(void) {
+	if (!config_files) {
+		return;
+	}
+	++cache_generation;
+	config_file_cache_prune();
+	hash_table_free(config_files);
+	config_files = NULL;
+}
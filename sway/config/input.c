@@ -5,6 +5,7 @@
 #include "sway/config.h"
 #include "sway/input/keyboard.h"
 #include "log.h"
+#include "stringop.h"
 
 struct input_config *new_input_config(const char* identifier) {
 	struct input_config *input = calloc(1, sizeof(struct input_config));
@@ -155,6 +156,15 @@ void merge_input_config(struct input_config *dst, struct input_config *src) {
 	}
 }
 
+static void prepare_xkb_merge(struct input_config *dest,
+		struct input_config *src) {
+	struct input_config *temp = new_input_config("temp");
+	merge_input_config(temp, dest);
+	merge_input_config(temp, src);
+	sway_keyboard_prepare_keymap(temp);
+	free_input_config(temp);
+}
+
 static bool validate_xkb_merge(struct input_config *dest,
 		struct input_config *src, char **xkb_error) {
 	struct input_config *temp = new_input_config("temp");
@@ -175,6 +185,17 @@ static bool validate_xkb_merge(struct input_config *dest,
 
 static bool validate_wildcard_on_all(struct input_config *wildcard,
 		char **error) {
+	// Compile the merges concurrently, they are validated in order below
+	for (int i = 0; i < config->input_configs->length; i++) {
+		struct input_config *ic = config->input_configs->items[i];
+		if (strcmp(wildcard->identifier, ic->identifier) != 0) {
+			prepare_xkb_merge(ic, wildcard);
+		}
+	}
+	for (int i = 0; i < config->input_type_configs->length; i++) {
+		prepare_xkb_merge(config->input_type_configs->items[i], wildcard);
+	}
+
 	for (int i = 0; i < config->input_configs->length; i++) {
 		struct input_config *ic = config->input_configs->items[i];
 		if (strcmp(wildcard->identifier, ic->identifier) != 0) {
@@ -216,6 +237,14 @@ static void merge_wildcard_on_all(struct input_config *wildcard) {
 
 static bool validate_type_on_existing(struct input_config *type_wildcard,
 		char **error) {
+	for (int i = 0; i < config->input_configs->length; i++) {
+		struct input_config *ic = config->input_configs->items[i];
+		if (ic->input_type &&
+				strcmp(ic->input_type, type_wildcard->identifier + 5) == 0) {
+			prepare_xkb_merge(ic, type_wildcard);
+		}
+	}
+
 	for (int i = 0; i < config->input_configs->length; i++) {
 		struct input_config *ic = config->input_configs->items[i];
 		if (ic->input_type == NULL) {
@@ -366,3 +395,61 @@ int input_identifier_cmp(const void *item, const void *data) {
 	const char *identifier = data;
 	return strcmp(ic->identifier, identifier);
 }
+
+static bool boxes_equal(struct wlr_box *a, struct wlr_box *b) {
+	if (!a || !b) {
+		return a == b;
+	}
+	return a->x == b->x && a->y == b->y &&
+		a->width == b->width && a->height == b->height;
+}
+
+static bool mapped_from_regions_equal(
+		struct input_config_mapped_from_region *a,
+		struct input_config_mapped_from_region *b) {
+	if (!a || !b) {
+		return a == b;
+	}
+	return a->x1 == b->x1 && a->y1 == b->y1 &&
+		a->x2 == b->x2 && a->y2 == b->y2 && a->mm == b->mm;
+}
+
+bool input_config_equal(struct input_config *a, struct input_config *b) {
+	if (a->calibration_matrix.configured != b->calibration_matrix.configured ||
+			(a->calibration_matrix.configured &&
+			memcmp(a->calibration_matrix.matrix, b->calibration_matrix.matrix,
+				sizeof(a->calibration_matrix.matrix)) != 0)) {
+		return false;
+	}
+	return a->accel_profile == b->accel_profile &&
+		a->click_method == b->click_method &&
+		a->drag == b->drag &&
+		a->drag_lock == b->drag_lock &&
+		a->dwt == b->dwt &&
+		a->left_handed == b->left_handed &&
+		a->middle_emulation == b->middle_emulation &&
+		a->natural_scroll == b->natural_scroll &&
+		a->pointer_accel == b->pointer_accel &&
+		a->scroll_factor == b->scroll_factor &&
+		a->repeat_delay == b->repeat_delay &&
+		a->repeat_rate == b->repeat_rate &&
+		a->scroll_button == b->scroll_button &&
+		a->scroll_method == b->scroll_method &&
+		a->send_events == b->send_events &&
+		a->tap == b->tap &&
+		a->tap_button_map == b->tap_button_map &&
+		lenient_strcmp(a->xkb_layout, b->xkb_layout) == 0 &&
+		lenient_strcmp(a->xkb_model, b->xkb_model) == 0 &&
+		lenient_strcmp(a->xkb_options, b->xkb_options) == 0 &&
+		lenient_strcmp(a->xkb_rules, b->xkb_rules) == 0 &&
+		lenient_strcmp(a->xkb_variant, b->xkb_variant) == 0 &&
+		lenient_strcmp(a->xkb_file, b->xkb_file) == 0 &&
+		a->xkb_file_is_set == b->xkb_file_is_set &&
+		a->xkb_numlock == b->xkb_numlock &&
+		a->xkb_capslock == b->xkb_capslock &&
+		mapped_from_regions_equal(a->mapped_from_region,
+			b->mapped_from_region) &&
+		a->mapped_to == b->mapped_to &&
+		lenient_strcmp(a->mapped_to_output, b->mapped_to_output) == 0 &&
+		boxes_equal(a->mapped_to_region, b->mapped_to_region);
+}
@@ -643,15 +643,83 @@ void apply_output_config_to_outputs(struct output_config *oc) {
 	}
 }
 
-void reset_outputs(void) {
-	struct output_config *oc = NULL;
-	int i = list_seq_find(config->output_configs, output_name_cmp, "*");
+static bool output_config_equal(struct output_config *a,
+		struct output_config *b) {
+	// Backgrounds are handled by swaybg and don't require a modeset
+	return a->enabled == b->enabled &&
+		a->width == b->width && a->height == b->height &&
+		a->refresh_rate == b->refresh_rate &&
+		a->custom_mode == b->custom_mode &&
+		a->x == b->x && a->y == b->y &&
+		a->scale == b->scale &&
+		a->scale_filter == b->scale_filter &&
+		a->transform == b->transform &&
+		a->subpixel == b->subpixel &&
+		a->max_render_time == b->max_render_time &&
+		a->adaptive_sync == b->adaptive_sync &&
+		a->dpms_state == b->dpms_state;
+}
+
+static bool output_config_changed(struct sway_config *old_config,
+		const char *name) {
+	struct output_config *old_oc = NULL, *new_oc = NULL;
+	int i = list_seq_find(old_config->output_configs, output_name_cmp, name);
 	if (i >= 0) {
-		oc = config->output_configs->items[i];
-	} else {
-		oc = store_output_config(new_output_config("*"));
+		old_oc = old_config->output_configs->items[i];
+	}
+	i = list_seq_find(config->output_configs, output_name_cmp, name);
+	if (i >= 0) {
+		new_oc = config->output_configs->items[i];
+	}
+	if (!old_oc && !new_oc) {
+		return false;
+	}
+	// A missing config is the same as one which doesn't set anything
+	struct output_config *empty = NULL;
+	if (!old_oc || !new_oc) {
+		empty = new_output_config(name);
+		if (!empty) {
+			return true;
+		}
+	}
+	bool changed = !output_config_equal(old_oc ? old_oc : empty,
+			new_oc ? new_oc : empty);
+	free_output_config(empty);
+	return changed;
+}
+
+void reset_changed_outputs(struct sway_config *old_config) {
+	if (list_seq_find(config->output_configs, output_name_cmp, "*") < 0) {
+		store_output_config(new_output_config("*"));
+	}
+	bool wildcard_changed = output_config_changed(old_config, "*");
+
+	bool applied = false;
+	char id[128];
+	struct sway_output *sway_output, *tmp;
+	wl_list_for_each_safe(sway_output, tmp, &root->all_outputs, link) {
+		char *name = sway_output->wlr_output->name;
+		output_get_identifier(id, sizeof(id), sway_output);
+		if (!wildcard_changed && !output_config_changed(old_config, name) &&
+				!output_config_changed(old_config, id)) {
+			sway_log(SWAY_DEBUG, "Output config for %s is unchanged", name);
+			continue;
+		}
+		struct output_config *current = get_output_config(id, sway_output);
+		if (current) {
+			apply_output_config(current, sway_output);
+			free_output_config(current);
+			applied = true;
+		}
+	}
+
+	if (applied) {
+		struct sway_seat *seat;
+		wl_list_for_each(seat, &server.input->seats, link) {
+			wlr_seat_pointer_notify_clear_focus(seat->wlr_seat);
+			cursor_rebase(seat->cursor);
+		}
 	}
-	apply_output_config_to_outputs(oc);
 }
 
 void free_output_config(struct output_config *oc) {
@@ -734,14 +802,10 @@ static bool _spawn_swaybg(char **command) {
 	return true;
 }
 
-bool spawn_swaybg(void) {
-	if (!config->swaybg_command) {
-		return true;
-	}
-
+static char **swaybg_command(struct sway_config *sway_config) {
 	size_t length = 2;
-	for (int i = 0; i < config->output_configs->length; i++) {
-		struct output_config *oc = config->output_configs->items[i];
+	for (int i = 0; i < sway_config->output_configs->length; i++) {
+		struct output_config *oc = sway_config->output_configs->items[i];
 		if (!oc->background) {
 			continue;
 		}
@@ -757,13 +821,13 @@ bool spawn_swaybg(void) {
 	char **cmd = calloc(length, sizeof(char *));
 	if (!cmd) {
 		sway_log(SWAY_ERROR, "Failed to allocate spawn_swaybg command");
-		return false;
+		return NULL;
 	}
 
 	size_t i = 0;
-	cmd[i++] = config->swaybg_command;
-	for (int j = 0; j < config->output_configs->length; j++) {
-		struct output_config *oc = config->output_configs->items[j];
+	cmd[i++] = sway_config->swaybg_command;
+	for (int j = 0; j < sway_config->output_configs->length; j++) {
+		struct output_config *oc = sway_config->output_configs->items[j];
 		if (!oc->background) {
 			continue;
 		}
@@ -786,8 +850,20 @@ bool spawn_swaybg(void) {
 		}
 		assert(i <= length);
 	}
+	return cmd;
+}
 
-	for (size_t k = 0; k < i; k++) {
+bool spawn_swaybg(void) {
+	if (!config->swaybg_command) {
+		return true;
+	}
+
+	char **cmd = swaybg_command(config);
+	if (!cmd) {
+		return false;
+	}
+
+	for (size_t k = 0; cmd[k]; k++) {
 		sway_log(SWAY_DEBUG, "spawn_swaybg cmd[%zd] = %s", k, cmd[k]);
 	}
 
@@ -795,3 +871,31 @@ bool spawn_swaybg(void) {
 	free(cmd);
 	return result;
 }
+
+bool adopt_swaybg(struct sway_config *old_config) {
+	if (!old_config->swaybg_client || !old_config->swaybg_command ||
+			!config->swaybg_command) {
+		return false;
+	}
+	char **old_cmd = swaybg_command(old_config);
+	char **new_cmd = swaybg_command(config);
+	bool same = old_cmd && new_cmd;
+	for (size_t k = 0; same && (old_cmd[k] || new_cmd[k]); k++) {
+		same = old_cmd[k] && new_cmd[k] && strcmp(old_cmd[k], new_cmd[k]) == 0;
+	}
+	free(old_cmd);
+	free(new_cmd);
+	if (!same) {
+		return false;
+	}
+
+	sway_log(SWAY_DEBUG, "Backgrounds are unchanged, keeping swaybg");
+	config->swaybg_client = old_config->swaybg_client;
+	old_config->swaybg_client = NULL;
+	wl_list_remove(&old_config->swaybg_client_destroy.link);
+	wl_list_init(&old_config->swaybg_client_destroy.link);
+	config->swaybg_client_destroy.notify = handle_swaybg_client_destroy;
+	wl_client_add_destroy_listener(config->swaybg_client,
+		&config->swaybg_client_destroy);
+	return true;
+}
@@ -4,6 +4,7 @@
 #include <string.h>
 #include "sway/config.h"
 #include "log.h"
+#include "stringop.h"
 
 struct seat_config *new_seat_config(const char* name) {
 	struct seat_config *seat = calloc(1, sizeof(struct seat_config));
@@ -31,6 +32,7 @@ struct seat_config *new_seat_config(const char* name) {
 	seat->hide_cursor_timeout = -1;
 	seat->allow_constrain = CONSTRAIN_DEFAULT;
 	seat->shortcuts_inhibit = SHORTCUTS_INHIBIT_DEFAULT;
+	seat->motion_batching = MOTION_BATCHING_DEFAULT;
 	seat->keyboard_grouping = KEYBOARD_GROUP_DEFAULT;
 	seat->xcursor_theme.name = NULL;
 	seat->xcursor_theme.size = 24;
@@ -163,6 +165,10 @@ void merge_seat_config(struct seat_config *dest, struct seat_config *source) {
 		dest->keyboard_grouping = source->keyboard_grouping;
 	}
 
+	if (source->motion_batching != MOTION_BATCHING_DEFAULT) {
+		dest->motion_batching = source->motion_batching;
+	}
+
 	if (source->xcursor_theme.name != NULL) {
 		free(dest->xcursor_theme.name);
 		dest->xcursor_theme.name = strdup(source->xcursor_theme.name);
@@ -203,6 +209,29 @@ void free_seat_config(struct seat_config *seat) {
 	free(seat);
 }
 
+bool seat_config_equal(struct seat_config *a, struct seat_config *b) {
+	if (a->fallback != b->fallback ||
+			a->hide_cursor_timeout != b->hide_cursor_timeout ||
+			a->allow_constrain != b->allow_constrain ||
+			a->shortcuts_inhibit != b->shortcuts_inhibit ||
+			a->keyboard_grouping != b->keyboard_grouping ||
+			a->motion_batching != b->motion_batching ||
+			a->idle_inhibit_sources != b->idle_inhibit_sources ||
+			a->idle_wake_sources != b->idle_wake_sources ||
+			a->xcursor_theme.size != b->xcursor_theme.size ||
+			lenient_strcmp(a->xcursor_theme.name, b->xcursor_theme.name) != 0 ||
+			a->attachments->length != b->attachments->length) {
+		return false;
+	}
+	for (int i = 0; i < a->attachments->length; ++i) {
+		struct seat_attachment_config *attachment = a->attachments->items[i];
+		if (!seat_config_get_attachment(b, attachment->identifier)) {
+			return false;
+		}
+	}
+	return true;
+}
+
 int seat_name_cmp(const void *item, const void *data) {
 	const struct seat_config *sc = item;
 	const char *name = data;
@@ -2,14 +2,17 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <string.h>
 #include <strings.h>
 #include <pcre.h>
+#include "sway/commands.h"
 #include "sway/criteria.h"
 #include "sway/tree/container.h"
 #include "sway/config.h"
 #include "sway/tree/root.h"
 #include "sway/tree/view.h"
 #include "sway/tree/workspace.h"
+#include "hash_table.h"
 #include "stringop.h"
 #include "list.h"
 #include "log.h"
@@ -39,8 +42,15 @@ bool criteria_is_empty(struct criteria *criteria) {
 // as an argument in several places.
 char *error = NULL;
 
-// Returns error string on failure or NULL otherwise.
-static bool generate_regex(pcre **regex, char *value) {
+#ifdef PCRE_STUDY_JIT_COMPILE
+#define REGEX_STUDY_OPTIONS PCRE_STUDY_JIT_COMPILE
+#else
+#define REGEX_STUDY_OPTIONS 0
+#endif
+
+// Criteria are matched against every view that maps or changes its title, so
+// it pays off to study (and JIT compile, if available) each regex once.
+static bool generate_regex(pcre **regex, pcre_extra **extra, char *value) {
 	const char *reg_err;
 	int offset;
 
@@ -54,9 +64,48 @@ static bool generate_regex(pcre **regex, char *value) {
 		return false;
 	}
 
+	*extra = pcre_study(*regex, REGEX_STUDY_OPTIONS, &reg_err);
+	if (reg_err) {
+		// Not fatal, the regex still works without the study data
+		sway_log(SWAY_DEBUG, "Regex study for '%s' failed: %s", value, reg_err);
+	}
+
 	return true;
 }
 
+static bool is_regex_special(char c) {
+	return strchr("\\^$.[|()?*+{", c) != NULL;
+}
+
+/**
+ * Return the literal text that every match of an anchored regex starts with,
+ * eg. "firefox" for "^firefox$", or NULL if there is none. This is a simple
+ * scan, which gives up on anything it doesn't fully understand.
+ */
+static char *regex_literal_prefix(const char *value) {
+	if (value[0] != '^' || strchr(value, '|')) {
+		return NULL;
+	}
+	const char *start = value + 1;
+	const char *end = start;
+	while (*end && !is_regex_special(*end)) {
+		++end;
+	}
+	if (*end == '?' || *end == '*' || *end == '{') {
+		// The last character is optional, drop it (and all its UTF-8 bytes)
+		if (end > start) {
+			--end;
+		}
+		while (end > start && (*end & 0xC0) == 0x80) {
+			--end;
+		}
+	}
+	if (end == start) {
+		return NULL;
+	}
+	return strndup(start, end - start);
+}
+
 static bool pattern_create(struct pattern **pattern, char *value) {
 	*pattern = calloc(1, sizeof(struct pattern));
 	if (!*pattern) {
@@ -67,18 +116,27 @@ static bool pattern_create(struct pattern **pattern, char *value) {
 		(*pattern)->match_type = PATTERN_FOCUSED;
 	} else {
 		(*pattern)->match_type = PATTERN_PCRE;
-		if (!generate_regex(&(*pattern)->regex, value)) {
+		if (!generate_regex(&(*pattern)->regex, &(*pattern)->extra, value)) {
 			return false;
 		};
+		(*pattern)->prefix = regex_literal_prefix(value);
 	}
 	return true;
 }
 
 static void pattern_destroy(struct pattern *pattern) {
 	if (pattern) {
+		if (pattern->extra) {
+#ifdef PCRE_STUDY_JIT_COMPILE
+			pcre_free_study(pattern->extra);
+#else
+			pcre_free(pattern->extra);
+#endif
+		}
 		if (pattern->regex) {
 			pcre_free(pattern->regex);
 		}
+		free(pattern->prefix);
 		free(pattern);
 	}
 }
@@ -93,14 +151,16 @@ void criteria_destroy(struct criteria *criteria) {
 	pattern_destroy(criteria->window_role);
 #endif
 	pattern_destroy(criteria->con_mark);
-	free(criteria->workspace);
+	pattern_destroy(criteria->workspace);
 	free(criteria->cmdlist);
+	command_program_destroy(criteria->program);
 	free(criteria->raw);
 	free(criteria);
 }
 
-static int regex_cmp(const char *item, const pcre *regex) {
-	return pcre_exec(regex, NULL, item, strlen(item), 0, 0, NULL, 0);
+static int regex_cmp(const char *item, const struct pattern *pattern) {
+	return pcre_exec(pattern->regex, pattern->extra, item, strlen(item),
+			0, 0, NULL, 0);
 }
 
 #if HAVE_XWAYLAND
@@ -155,7 +215,7 @@ static bool criteria_matches_container(struct criteria *criteria,
 		bool exists = false;
 		struct sway_container *con = container;
 		for (int i = 0; i < con->marks->length; ++i) {
-			if (regex_cmp(con->marks->items[i], criteria->con_mark->regex) == 0) {
+			if (regex_cmp(con->marks->items[i], criteria->con_mark) == 0) {
 				exists = true;
 				break;
 			}
@@ -174,7 +234,34 @@ static bool criteria_matches_container(struct criteria *criteria,
 	return true;
 }
 
-static bool criteria_matches_view(struct criteria *criteria,
+static bool pattern_matches_string(struct pattern *pattern,
+		const char *value) {
+	if (!pattern || pattern->match_type != PATTERN_PCRE) {
+		return true;
+	}
+	return value && regex_cmp(value, pattern) == 0;
+}
+
+/**
+ * Match the regexes which only depend on the view's own strings. The result
+ * stays valid until the view's title, app_id or X11 class changes, so it is
+ * cached per view by criteria_for_view.
+ */
+static bool criteria_matches_view_strings(struct criteria *criteria,
+		struct sway_view *view) {
+	return pattern_matches_string(criteria->title, view_get_title(view))
+		&& pattern_matches_string(criteria->shell, view_get_shell(view))
+		&& pattern_matches_string(criteria->app_id, view_get_app_id(view))
+#if HAVE_XWAYLAND
+		&& pattern_matches_string(criteria->class, view_get_class(view))
+		&& pattern_matches_string(criteria->instance, view_get_instance(view))
+		&& pattern_matches_string(criteria->window_role,
+				view_get_window_role(view))
+#endif
+		;
+}
+
+static bool criteria_matches_view_state(struct criteria *criteria,
 		struct sway_view *view) {
 	struct sway_seat *seat = input_manager_current_seat();
 	struct sway_container *focus = seat_get_focused_container(seat);
@@ -193,10 +280,7 @@ static bool criteria_matches_view(struct criteria *criteria,
 			}
 			break;
 		case PATTERN_PCRE:
-			if (regex_cmp(title, criteria->title->regex) != 0) {
-				return false;
-			}
-			break;
+			break; // see criteria_matches_view_strings
 		}
 	}
 
@@ -213,10 +297,7 @@ static bool criteria_matches_view(struct criteria *criteria,
 			}
 			break;
 		case PATTERN_PCRE:
-			if (regex_cmp(shell, criteria->shell->regex) != 0) {
-				return false;
-			}
-			break;
+			break; // see criteria_matches_view_strings
 		}
 	}
 
@@ -233,10 +314,7 @@ static bool criteria_matches_view(struct criteria *criteria,
 			}
 			break;
 		case PATTERN_PCRE:
-			if (regex_cmp(app_id, criteria->app_id->regex) != 0) {
-				return false;
-			}
-			break;
+			break; // see criteria_matches_view_strings
 		}
 	}
 
@@ -265,10 +343,7 @@ static bool criteria_matches_view(struct criteria *criteria,
 			}
 			break;
 		case PATTERN_PCRE:
-			if (regex_cmp(class, criteria->class->regex) != 0) {
-				return false;
-			}
-			break;
+			break; // see criteria_matches_view_strings
 		}
 	}
 
@@ -285,10 +360,7 @@ static bool criteria_matches_view(struct criteria *criteria,
 			}
 			break;
 		case PATTERN_PCRE:
-			if (regex_cmp(instance, criteria->instance->regex) != 0) {
-				return false;
-			}
-			break;
+			break; // see criteria_matches_view_strings
 		}
 	}
 
@@ -305,10 +377,7 @@ static bool criteria_matches_view(struct criteria *criteria,
 			}
 			break;
 		case PATTERN_PCRE:
-			if (regex_cmp(window_role, criteria->window_role->regex) != 0) {
-				return false;
-			}
-			break;
+			break; // see criteria_matches_view_strings
 		}
 	}
 
@@ -364,7 +433,7 @@ static bool criteria_matches_view(struct criteria *criteria,
 			}
 			break;
 		case PATTERN_PCRE:
-			if (regex_cmp(ws->name, criteria->workspace->regex) != 0) {
+			if (regex_cmp(ws->name, criteria->workspace) != 0) {
 				return false;
 			}
 			break;
@@ -380,15 +449,200 @@ static bool criteria_matches_view(struct criteria *criteria,
 	return true;
 }
 
-list_t *criteria_for_view(struct sway_view *view, enum criteria_type types) {
-	list_t *criterias = config->criteria;
-	list_t *matches = create_list();
+static bool criteria_matches_view(struct criteria *criteria,
+		struct sway_view *view) {
+	return criteria_matches_view_strings(criteria, view)
+		&& criteria_matches_view_state(criteria, view);
+}
+
+// Prefixes are truncated to this many bytes, which bounds the number of
+// lookups needed for a view
+#define CRITERIA_PREFIX_MAX 16
+
+/**
+ * Buckets the config's criteria by the literal prefix of their app_id, class
+ * or shell regex, so that a view is only tested against the criteria which
+ * can possibly match it. Criteria without such a prefix are always tested.
+ */
+struct criteria_index {
+	list_t *criteria; // the list the index was built for
+	int length;
+	uint64_t generation;
+
+	hash_table_t *app_id; // prefix -> list_t of struct criteria *
+	hash_table_t *shell;
+#if HAVE_XWAYLAND
+	hash_table_t *class;
+#endif
+	list_t *unindexed; // struct criteria *
+};
+
+static uint64_t criteria_index_generation = 0;
+
+static void free_bucket(const char *key, void *value, void *data) {
+	list_free(value);
+}
+
+static void free_buckets(hash_table_t *table) {
+	if (table) {
+		hash_table_for_each(table, free_bucket, NULL);
+		hash_table_free(table);
+	}
+}
+
+void criteria_index_destroy(struct criteria_index *index) {
+	if (!index) {
+		return;
+	}
+	free_buckets(index->app_id);
+	free_buckets(index->shell);
+#if HAVE_XWAYLAND
+	free_buckets(index->class);
+#endif
+	list_free(index->unindexed);
+	free(index);
+}
+
+static bool index_add(hash_table_t *table, struct pattern *pattern,
+		struct criteria *criteria) {
+	if (!pattern || pattern->match_type != PATTERN_PCRE || !pattern->prefix) {
+		return false;
+	}
+	char key[CRITERIA_PREFIX_MAX + 1];
+	snprintf(key, sizeof(key), "%s", pattern->prefix);
+	list_t *bucket = hash_table_get(table, key);
+	if (!bucket) {
+		bucket = create_list();
+		hash_table_set(table, key, bucket);
+	}
+	list_add(bucket, criteria);
+	return true;
+}
+
+static struct criteria_index *criteria_index_create(list_t *criterias) {
+	struct criteria_index *index = calloc(1, sizeof(struct criteria_index));
+	if (!sway_assert(index, "Unable to allocate criteria index")) {
+		return NULL;
+	}
+	index->criteria = criterias;
+	index->length = criterias->length;
+	index->generation = ++criteria_index_generation;
+	index->app_id = create_hash_table();
+	index->shell = create_hash_table();
+#if HAVE_XWAYLAND
+	index->class = create_hash_table();
+#endif
+	index->unindexed = create_list();
+
 	for (int i = 0; i < criterias->length; ++i) {
 		struct criteria *criteria = criterias->items[i];
-		if ((criteria->type & types) && criteria_matches_view(criteria, view)) {
+		criteria->position = i;
+		// Each criteria goes into a single bucket, so lookups never yield
+		// duplicates
+		if (index_add(index->app_id, criteria->app_id, criteria)) {
+			continue;
+		}
+#if HAVE_XWAYLAND
+		if (index_add(index->class, criteria->class, criteria)) {
+			continue;
+		}
+#endif
+		if (index_add(index->shell, criteria->shell, criteria)) {
+			continue;
+		}
+		list_add(index->unindexed, criteria);
+	}
+	return index;
+}
+
+static struct criteria_index *get_criteria_index(void) {
+	struct criteria_index *index = config->criteria_index;
+	// Criteria are only ever appended to the config
+	if (index && index->criteria == config->criteria &&
+			index->length == config->criteria->length) {
+		return index;
+	}
+	criteria_index_destroy(index);
+	config->criteria_index = criteria_index_create(config->criteria);
+	return config->criteria_index;
+}
+
+static void index_lookup(hash_table_t *table, const char *value,
+		list_t *candidates) {
+	if (!value) {
+		return;
+	}
+	char key[CRITERIA_PREFIX_MAX + 1];
+	for (size_t len = 1; len <= CRITERIA_PREFIX_MAX && value[len - 1]; ++len) {
+		memcpy(key, value, len);
+		key[len] = '\0';
+		list_t *bucket = hash_table_get(table, key);
+		if (bucket) {
+			list_cat(candidates, bucket);
+		}
+	}
+}
+
+static int cmp_criteria_position(const void *_a, const void *_b) {
+	const struct criteria *a = *(void **)_a;
+	const struct criteria *b = *(void **)_b;
+	return a->position - b->position;
+}
+
+static bool criteria_matches_view_cached(struct criteria_index *index,
+		struct criteria *criteria, struct sway_view *view) {
+	struct sway_view_criteria_cache *cache = &view->criteria_cache;
+	if (cache->generation != index->generation) {
+		free(cache->results);
+		cache->results = calloc(index->length, sizeof(uint8_t));
+		cache->length = cache->results ? index->length : 0;
+		cache->generation = cache->results ? index->generation : 0;
+	}
+	if (criteria->position >= cache->length) {
+		return criteria_matches_view(criteria, view);
+	}
+	uint8_t *result = &cache->results[criteria->position];
+	if (*result == CRITERIA_CACHE_UNKNOWN) {
+		*result = criteria_matches_view_strings(criteria, view) ?
+			CRITERIA_CACHE_MATCH : CRITERIA_CACHE_NO_MATCH;
+	}
+	return *result == CRITERIA_CACHE_MATCH &&
+		criteria_matches_view_state(criteria, view);
+}
+
+list_t *criteria_for_view(struct sway_view *view, enum criteria_type types) {
+	list_t *matches = create_list();
+	struct criteria_index *index = get_criteria_index();
+	if (!index) {
+		list_t *criterias = config->criteria;
+		for (int i = 0; i < criterias->length; ++i) {
+			struct criteria *criteria = criterias->items[i];
+			if ((criteria->type & types) &&
+					criteria_matches_view(criteria, view)) {
+				list_add(matches, criteria);
+			}
+		}
+		return matches;
+	}
+
+	list_t *candidates = create_list();
+	list_cat(candidates, index->unindexed);
+	index_lookup(index->app_id, view_get_app_id(view), candidates);
+	index_lookup(index->shell, view_get_shell(view), candidates);
+#if HAVE_XWAYLAND
+	index_lookup(index->class, view_get_class(view), candidates);
+#endif
+	// Criteria are applied in config order
+	list_qsort(candidates, cmp_criteria_position);
+
+	for (int i = 0; i < candidates->length; ++i) {
+		struct criteria *criteria = candidates->items[i];
+		if ((criteria->type & types) &&
+				criteria_matches_view_cached(index, criteria, view)) {
 			list_add(matches, criteria);
 		}
 	}
+	list_free(candidates);
 	return matches;
 }
 
@@ -0,0 +1,169 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sway/desktop/frame_timing.h"
+
+const int64_t frame_timing_histogram_bounds_usec[
+		FRAME_TIMING_HISTOGRAM_BUCKETS] = {
+	250, 500, 1000, 2000, 4000, 8000, 16000, 33000, 66000, -1,
+};
+
+static const char *phase_names[FRAME_PHASE_COUNT] = {
+	[FRAME_PHASE_DAMAGE] = "damage",
+	[FRAME_PHASE_LAYERS] = "layers",
+	[FRAME_PHASE_WORKSPACE] = "workspace",
+	[FRAME_PHASE_FLOATING] = "floating",
+	[FRAME_PHASE_POPUPS] = "popups",
+	[FRAME_PHASE_OVERLAY] = "overlay",
+	[FRAME_PHASE_COMMIT] = "commit",
+};
+
+const char *frame_timing_phase_name(enum sway_frame_phase phase) {
+	if (phase >= FRAME_PHASE_COUNT) {
+		return "total";
+	}
+	return phase_names[phase];
+}
+
+static int64_t timespec_diff_nsec(const struct timespec *start,
+		const struct timespec *end) {
+	return (int64_t)(end->tv_sec - start->tv_sec) * 1000000000
+		+ (end->tv_nsec - start->tv_nsec);
+}
+
+void frame_timing_predict(struct sway_frame_timings *timings,
+		bool has_prediction, int msec_until_refresh) {
+	timings->pending_has_refresh_prediction = has_prediction;
+	timings->pending_msec_until_refresh = msec_until_refresh;
+}
+
+void frame_timing_begin(struct sway_frame_timings *timings) {
+	memset(&timings->current, 0, sizeof(timings->current));
+	timings->current.has_refresh_prediction =
+		timings->pending_has_refresh_prediction;
+	timings->current.msec_until_refresh =
+		timings->pending_msec_until_refresh;
+	timings->pending_has_refresh_prediction = false;
+	timings->pending_msec_until_refresh = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &timings->frame_start);
+	timings->last_mark = timings->frame_start;
+	timings->in_frame = true;
+}
+
+void frame_timing_mark(struct sway_frame_timings *timings,
+		enum sway_frame_phase phase) {
+	if (!timings->in_frame || phase >= FRAME_PHASE_COUNT) {
+		return;
+	}
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	timings->current.phase_nsec[phase] +=
+		timespec_diff_nsec(&timings->last_mark, &now);
+	timings->last_mark = now;
+}
+
+void frame_timing_end(struct sway_frame_timings *timings, bool commit) {
+	if (!timings->in_frame) {
+		return;
+	}
+	timings->in_frame = false;
+	if (!commit) {
+		return;
+	}
+
+	timings->current.total_nsec =
+		timespec_diff_nsec(&timings->frame_start, &timings->last_mark);
+	timings->frames[timings->head] = timings->current;
+	timings->head = (timings->head + 1) % FRAME_TIMING_CAPACITY;
+	if (timings->count < FRAME_TIMING_CAPACITY) {
+		++timings->count;
+	}
+}
+
+static int cmp_int64(const void *a, const void *b) {
+	int64_t x = *(const int64_t *)a;
+	int64_t y = *(const int64_t *)b;
+	return (x > y) - (x < y);
+}
+
+static int64_t percentile(const int64_t *sorted, size_t len, int pct) {
+	// Nearest-rank method
+	size_t rank = (pct * len + 99) / 100;
+	return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static void compute_stats(int64_t *values, size_t len,
+		struct sway_frame_timing_stats *stats, bool histogram) {
+	memset(stats, 0, sizeof(*stats));
+	stats->samples = len;
+	if (len == 0) {
+		return;
+	}
+
+	int64_t sum = 0;
+	for (size_t i = 0; i < len; ++i) {
+		sum += values[i];
+		if (!histogram) {
+			continue;
+		}
+		size_t bucket = 0;
+		while (bucket < FRAME_TIMING_HISTOGRAM_BUCKETS - 1 &&
+				values[i] > frame_timing_histogram_bounds_usec[bucket]) {
+			++bucket;
+		}
+		++stats->histogram[bucket];
+	}
+
+	qsort(values, len, sizeof(int64_t), cmp_int64);
+	stats->min = values[0];
+	stats->max = values[len - 1];
+	stats->mean = sum / (int64_t)len;
+	stats->p50 = percentile(values, len, 50);
+	stats->p90 = percentile(values, len, 90);
+	stats->p99 = percentile(values, len, 99);
+}
+
+void frame_timing_get_phase_stats(struct sway_frame_timings *timings,
+		enum sway_frame_phase phase, struct sway_frame_timing_stats *stats) {
+	int64_t values[FRAME_TIMING_CAPACITY];
+	for (size_t i = 0; i < timings->count; ++i) {
+		struct sway_frame_timing *frame = &timings->frames[i];
+		int64_t nsec = phase < FRAME_PHASE_COUNT ?
+			frame->phase_nsec[phase] : frame->total_nsec;
+		values[i] = nsec / 1000;
+	}
+	compute_stats(values, timings->count, stats, true);
+}
+
+void frame_timing_get_refresh_stats(struct sway_frame_timings *timings,
+		struct sway_frame_timing_stats *stats) {
+	int64_t values[FRAME_TIMING_CAPACITY];
+	size_t len = 0;
+	for (size_t i = 0; i < timings->count; ++i) {
+		struct sway_frame_timing *frame = &timings->frames[i];
+		if (frame->has_refresh_prediction) {
+			values[len++] = frame->msec_until_refresh;
+		}
+	}
+	compute_stats(values, len, stats, false);
+}
+
+void frame_timing_record_transaction(struct sway_frame_timings *timings,
+		int64_t usec) {
+	timings->transaction_usec[timings->transaction_head] = usec;
+	timings->transaction_head =
+		(timings->transaction_head + 1) % FRAME_TIMING_CAPACITY;
+	if (timings->transaction_count < FRAME_TIMING_CAPACITY) {
+		++timings->transaction_count;
+	}
+}
+
+void frame_timing_get_transaction_stats(struct sway_frame_timings *timings,
+		struct sway_frame_timing_stats *stats) {
+	int64_t values[FRAME_TIMING_CAPACITY];
+	memcpy(values, timings->transaction_usec,
+			timings->transaction_count * sizeof(int64_t));
+	compute_stats(values, timings->transaction_count, stats, true);
+}
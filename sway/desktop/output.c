@@ -18,11 +18,13 @@
 #include "log.h"
 #include "sway/config.h"
 #include "sway/desktop/transaction.h"
+#include "sway/input/cursor.h"
 #include "sway/input/input-manager.h"
 #include "sway/input/seat.h"
 #include "sway/layers.h"
 #include "sway/output.h"
 #include "sway/server.h"
+#include "sway/startup_profile.h"
 #include "sway/surface.h"
 #include "sway/tree/arrange.h"
 #include "sway/tree/container.h"
@@ -31,16 +33,7 @@
 #include "sway/tree/workspace.h"
 
 struct sway_output *output_by_name_or_id(const char *name_or_id) {
-	for (int i = 0; i < root->outputs->length; ++i) {
-		struct sway_output *output = root->outputs->items[i];
-		char identifier[128];
-		output_get_identifier(identifier, sizeof(identifier), output);
-		if (strcasecmp(identifier, name_or_id) == 0
-				|| strcasecmp(output->wlr_output->name, name_or_id) == 0) {
-			return output;
-		}
-	}
-	return NULL;
+	return hash_table_get(root->outputs_by_name, name_or_id);
 }
 
 struct sway_output *all_output_by_name_or_id(const char *name_or_id) {
@@ -600,21 +593,29 @@ static int output_repaint_timer_handler(void *data) {
 		}
 	}
 
+	frame_timing_begin(&output->frame_timings);
+	output_prepare_render(output);
+
 	bool needs_frame;
 	pixman_region32_t damage;
 	pixman_region32_init(&damage);
 	if (!wlr_output_damage_attach_render(output->damage,
 			&needs_frame, &damage)) {
+		frame_timing_end(&output->frame_timings, false);
 		return 0;
 	}
 
+	frame_timing_mark(&output->frame_timings, FRAME_PHASE_DAMAGE);
+
 	if (needs_frame) {
 		struct timespec now;
 		clock_gettime(CLOCK_MONOTONIC, &now);
 
 		output_render(output, &now, &damage);
+		startup_phase_end(STARTUP_PHASE_FIRST_FRAME);
 	} else {
 		wlr_output_rollback(output->wlr_output);
+		frame_timing_end(&output->frame_timings, false);
 	}
 
 	pixman_region32_fini(&damage);
@@ -625,6 +626,7 @@ static int output_repaint_timer_handler(void *data) {
 static void damage_handle_frame(struct wl_listener *listener, void *user_data) {
 	struct sway_output *output =
 		wl_container_of(listener, output, damage_frame);
+	cursor_flush_motion_all();
 	if (!output->enabled || !output->wlr_output->enabled) {
 		return;
 	}
@@ -669,6 +671,9 @@ static void damage_handle_frame(struct wl_listener *listener, void *user_data) {
 		}
 	}
 
+	frame_timing_predict(&output->frame_timings,
+		output->max_render_time != 0, msec_until_refresh);
+
 	int delay = msec_until_refresh - output->max_render_time;
 
 	// If the delay is less than 1 millisecond (which is the least we can wait)
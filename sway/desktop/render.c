@@ -18,6 +18,7 @@
 #include "log.h"
 #include "config.h"
 #include "sway/config.h"
+#include "sway/desktop/text_atlas.h"
 #include "sway/input/input-manager.h"
 #include "sway/input/seat.h"
 #include "sway/layers.h"
@@ -96,6 +97,53 @@ static void set_scale_filter(struct wlr_output *wlr_output,
 	}
 }
 
+/**
+ * Solid rectangles are queued by render_rect and drawn together, scissoring
+ * once per damage rectangle rather than once per rectangle and damage
+ * rectangle. The queue must be flushed before anything else is drawn, to keep
+ * the painter's order.
+ */
+struct queued_rect {
+	struct wlr_box box; // output-buffer-local
+	float color[4];
+};
+
+static struct wl_array rect_queue;
+static struct sway_output *rect_queue_output = NULL;
+static pixman_region32_t *rect_queue_damage = NULL;
+
+static void flush_rects(void) {
+	if (rect_queue.size == 0) {
+		return;
+	}
+	struct wlr_output *wlr_output = rect_queue_output->wlr_output;
+	struct wlr_renderer *renderer =
+		wlr_backend_get_renderer(wlr_output->backend);
+
+	int nrects;
+	pixman_box32_t *rects =
+		pixman_region32_rectangles(rect_queue_damage, &nrects);
+	for (int i = 0; i < nrects; ++i) {
+		pixman_box32_t *rect = &rects[i];
+		bool scissored = false;
+		struct queued_rect *queued;
+		wl_array_for_each(queued, &rect_queue) {
+			struct wlr_box *box = &queued->box;
+			if (box->x >= rect->x2 || box->x + box->width <= rect->x1 ||
+					box->y >= rect->y2 || box->y + box->height <= rect->y1) {
+				continue;
+			}
+			if (!scissored) {
+				scissor_output(wlr_output, rect);
+				scissored = true;
+			}
+			wlr_render_rect(renderer, box, queued->color,
+				wlr_output->transform_matrix);
+		}
+	}
+	rect_queue.size = 0;
+}
+
 static void render_texture(struct wlr_output *wlr_output,
 		pixman_region32_t *output_damage, struct wlr_texture *texture,
 		const struct wlr_fbox *src_box, const struct wlr_box *dst_box,
@@ -104,6 +152,8 @@ static void render_texture(struct wlr_output *wlr_output,
 		wlr_backend_get_renderer(wlr_output->backend);
 	struct sway_output *output = wlr_output->data;
 
+	flush_rects();
+
 	struct wlr_gles2_texture_attribs attribs;
 	wlr_gles2_texture_get_attribs(texture, &attribs);
 
@@ -213,34 +263,38 @@ void render_rect(struct sway_output *output,
 		pixman_region32_t *output_damage, const struct wlr_box *_box,
 		float color[static 4]) {
 	struct wlr_output *wlr_output = output->wlr_output;
-	struct wlr_renderer *renderer =
-		wlr_backend_get_renderer(wlr_output->backend);
 
 	struct wlr_box box;
 	memcpy(&box, _box, sizeof(struct wlr_box));
 	box.x -= output->lx * wlr_output->scale;
 	box.y -= output->ly * wlr_output->scale;
-
-	pixman_region32_t damage;
-	pixman_region32_init(&damage);
-	pixman_region32_union_rect(&damage, &damage, box.x, box.y,
-		box.width, box.height);
-	pixman_region32_intersect(&damage, &damage, output_damage);
-	bool damaged = pixman_region32_not_empty(&damage);
-	if (!damaged) {
-		goto damage_finish;
+	if (box.width <= 0 || box.height <= 0) {
+		return;
 	}
 
-	int nrects;
-	pixman_box32_t *rects = pixman_region32_rectangles(&damage, &nrects);
-	for (int i = 0; i < nrects; ++i) {
-		scissor_output(wlr_output, &rects[i]);
-		wlr_render_rect(renderer, &box, color,
-			wlr_output->transform_matrix);
+	pixman_box32_t rect = {
+		.x1 = box.x,
+		.y1 = box.y,
+		.x2 = box.x + box.width,
+		.y2 = box.y + box.height,
+	};
+	if (pixman_region32_contains_rectangle(output_damage, &rect) ==
+			PIXMAN_REGION_OUT) {
+		return;
 	}
 
-damage_finish:
-	pixman_region32_fini(&damage);
+	if (output != rect_queue_output || output_damage != rect_queue_damage) {
+		flush_rects();
+		rect_queue_output = output;
+		rect_queue_damage = output_damage;
+	}
+	struct queued_rect *queued = wl_array_add(&rect_queue, sizeof(*queued));
+	if (!queued) {
+		sway_log(SWAY_ERROR, "Unable to queue rect");
+		return;
+	}
+	queued->box = box;
+	memcpy(queued->color, color, sizeof(queued->color));
 }
 
 void premultiply_alpha(float color[4], float opacity) {
@@ -334,6 +388,52 @@ static void render_saved_view(struct sway_view *view,
 	// https://github.com/swaywm/sway/pull/4465#discussion_r321082059
 }
 
+/**
+ * Return the container's decoration cache for the given output, dropping it if
+ * it was built for another scale.
+ */
+static struct sway_container_decorations *get_decorations(
+		struct sway_container *con, struct sway_output *output) {
+	struct sway_container_decorations *deco = &con->decorations;
+	if (deco->scale != output->wlr_output->scale) {
+		deco->scale = output->wlr_output->scale;
+		deco->borders_valid = false;
+		deco->titlebar_valid = false;
+	}
+	return deco;
+}
+
+static void update_border_boxes(struct sway_container *con,
+		struct sway_container_decorations *deco) {
+	struct sway_container_state *state = &con->current;
+
+	deco->border_left.x = state->x;
+	deco->border_left.y = state->content_y;
+	deco->border_left.width = state->border_thickness;
+	deco->border_left.height = state->content_height;
+	scale_box(&deco->border_left, deco->scale);
+
+	deco->border_right.x = state->content_x + state->content_width;
+	deco->border_right.y = state->content_y;
+	deco->border_right.width = state->border_thickness;
+	deco->border_right.height = state->content_height;
+	scale_box(&deco->border_right, deco->scale);
+
+	deco->border_bottom.x = state->x;
+	deco->border_bottom.y = state->content_y + state->content_height;
+	deco->border_bottom.width = state->width;
+	deco->border_bottom.height = state->border_thickness;
+	scale_box(&deco->border_bottom, deco->scale);
+
+	deco->border_top.x = state->x;
+	deco->border_top.y = state->y;
+	deco->border_top.width = state->width;
+	deco->border_top.height = state->border_thickness;
+	scale_box(&deco->border_top, deco->scale);
+
+	deco->borders_valid = true;
+}
+
 /**
  * Render a view's surface and left/bottom/right borders.
  */
@@ -350,20 +450,17 @@ static void render_view(struct sway_output *output, pixman_region32_t *damage,
 		return;
 	}
 
-	struct wlr_box box;
-	float output_scale = output->wlr_output->scale;
 	float color[4];
 	struct sway_container_state *state = &con->current;
+	struct sway_container_decorations *deco = get_decorations(con, output);
+	if (!deco->borders_valid) {
+		update_border_boxes(con, deco);
+	}
 
 	if (state->border_left) {
 		memcpy(&color, colors->child_border, sizeof(float) * 4);
 		premultiply_alpha(color, con->alpha);
-		box.x = state->x;
-		box.y = state->content_y;
-		box.width = state->border_thickness;
-		box.height = state->content_height;
-		scale_box(&box, output_scale);
-		render_rect(output, damage, &box, color);
+		render_rect(output, damage, &deco->border_left, color);
 	}
 
 	list_t *siblings = container_get_current_siblings(con);
@@ -377,12 +474,7 @@ static void render_view(struct sway_output *output, pixman_region32_t *damage,
 			memcpy(&color, colors->child_border, sizeof(float) * 4);
 		}
 		premultiply_alpha(color, con->alpha);
-		box.x = state->content_x + state->content_width;
-		box.y = state->content_y;
-		box.width = state->border_thickness;
-		box.height = state->content_height;
-		scale_box(&box, output_scale);
-		render_rect(output, damage, &box, color);
+		render_rect(output, damage, &deco->border_right, color);
 	}
 
 	if (state->border_bottom) {
@@ -392,15 +484,90 @@ static void render_view(struct sway_output *output, pixman_region32_t *damage,
 			memcpy(&color, colors->child_border, sizeof(float) * 4);
 		}
 		premultiply_alpha(color, con->alpha);
-		box.x = state->x;
-		box.y = state->content_y + state->content_height;
-		box.width = state->width;
-		box.height = state->border_thickness;
-		scale_box(&box, output_scale);
-		render_rect(output, damage, &box, color);
+		render_rect(output, damage, &deco->border_bottom, color);
 	}
 }
 
+static void update_titlebar_boxes(struct sway_container_decorations *deco,
+		struct sway_output *output, int x, int y, int width) {
+	float output_scale = deco->scale;
+	int titlebar_border_thickness = config->titlebar_border_thickness;
+	int titlebar_h_padding = config->titlebar_h_padding;
+	int titlebar_v_padding = config->titlebar_v_padding;
+	int titlebar_height = container_titlebar_height();
+	struct wlr_box *box;
+
+	// Single pixel bar above title
+	box = &deco->titlebar_edges[0];
+	box->x = x;
+	box->y = y;
+	box->width = width;
+	box->height = titlebar_border_thickness;
+	scale_box(box, output_scale);
+
+	// Single pixel bar below title
+	box = &deco->titlebar_edges[1];
+	box->x = x;
+	box->y = y + titlebar_height - titlebar_border_thickness;
+	box->width = width;
+	box->height = titlebar_border_thickness;
+	scale_box(box, output_scale);
+
+	// Single pixel left edge
+	box = &deco->titlebar_edges[2];
+	box->x = x;
+	box->y = y + titlebar_border_thickness;
+	box->width = titlebar_border_thickness;
+	box->height = titlebar_height - titlebar_border_thickness * 2;
+	scale_box(box, output_scale);
+
+	// Single pixel right edge
+	box = &deco->titlebar_edges[3];
+	box->x = x + width - titlebar_border_thickness;
+	box->y = y + titlebar_border_thickness;
+	box->width = titlebar_border_thickness;
+	box->height = titlebar_height - titlebar_border_thickness * 2;
+	scale_box(box, output_scale);
+
+	int inner_x = x - output->lx + titlebar_h_padding;
+	int bg_y = y + titlebar_border_thickness;
+	size_t inner_width = width - titlebar_h_padding * 2;
+	deco->ob_inner_x = round(inner_x * output_scale);
+	deco->ob_inner_width = scale_length(inner_width, inner_x, output_scale);
+	deco->ob_bg_height = scale_length(
+			(titlebar_v_padding - titlebar_border_thickness) * 2 +
+			config->font_height, bg_y, output_scale);
+
+	// Padding on left side, before it is stretched up to the textures
+	box = &deco->titlebar_padding_left;
+	box->x = x + titlebar_border_thickness;
+	box->y = y + titlebar_border_thickness;
+	box->width = titlebar_h_padding - titlebar_border_thickness;
+	box->height = (titlebar_v_padding - titlebar_border_thickness) * 2 +
+		config->font_height;
+	scale_box(box, output_scale);
+
+	// Padding on right side
+	box = &deco->titlebar_padding_right;
+	box->x = x + width - titlebar_h_padding;
+	box->y = y + titlebar_border_thickness;
+	box->width = titlebar_h_padding - titlebar_border_thickness;
+	box->height = (titlebar_v_padding - titlebar_border_thickness) * 2 +
+		config->font_height;
+	scale_box(box, output_scale);
+
+	deco->titlebar_x = x;
+	deco->titlebar_y = y;
+	deco->titlebar_width = width;
+	deco->titlebar_output_x = output->lx;
+	deco->titlebar_output_y = output->ly;
+	deco->titlebar_border_thickness = titlebar_border_thickness;
+	deco->titlebar_h_padding = titlebar_h_padding;
+	deco->titlebar_v_padding = titlebar_v_padding;
+	deco->font_height = config->font_height;
+	deco->titlebar_valid = true;
+}
+
 /**
  * Render a titlebar.
  *
@@ -412,9 +579,11 @@ static void render_view(struct sway_output *output, pixman_region32_t *damage,
  */
 static void render_titlebar(struct sway_output *output,
 		pixman_region32_t *output_damage, struct sway_container *con,
-		int x, int y, int width,
-		struct border_colors *colors, struct wlr_texture *title_texture,
-		struct wlr_texture *marks_texture) {
+		int x, int y, int width, struct border_colors *colors) {
+	struct sway_text_atlas_entry *title_texture =
+		container_get_title_texture(con, colors);
+	struct sway_text_atlas_entry *marks_texture =
+		container_get_marks_texture(con, colors);
 	struct wlr_box box;
 	float color[4];
 	float output_scale = output->wlr_output->scale;
@@ -425,58 +594,39 @@ static void render_titlebar(struct sway_output *output,
 	int titlebar_v_padding = config->titlebar_v_padding;
 	enum alignment title_align = config->title_align;
 
-	// Single pixel bar above title
+	struct sway_container_decorations *deco = get_decorations(con, output);
+	if (!deco->titlebar_valid || deco->titlebar_x != x
+			|| deco->titlebar_y != y || deco->titlebar_width != width
+			|| deco->titlebar_output_x != output_x
+			|| deco->titlebar_output_y != output_y
+			|| deco->titlebar_border_thickness != titlebar_border_thickness
+			|| deco->titlebar_h_padding != titlebar_h_padding
+			|| deco->titlebar_v_padding != titlebar_v_padding
+			|| deco->font_height != config->font_height) {
+		update_titlebar_boxes(deco, output, x, y, width);
+	}
+
+	// Single pixel bars above and below the title, and left and right edges
 	memcpy(&color, colors->border, sizeof(float) * 4);
 	premultiply_alpha(color, con->alpha);
-	box.x = x;
-	box.y = y;
-	box.width = width;
-	box.height = titlebar_border_thickness;
-	scale_box(&box, output_scale);
-	render_rect(output, output_damage, &box, color);
-
-	// Single pixel bar below title
-	box.x = x;
-	box.y = y + container_titlebar_height() - titlebar_border_thickness;
-	box.width = width;
-	box.height = titlebar_border_thickness;
-	scale_box(&box, output_scale);
-	render_rect(output, output_damage, &box, color);
-
-	// Single pixel left edge
-	box.x = x;
-	box.y = y + titlebar_border_thickness;
-	box.width = titlebar_border_thickness;
-	box.height = container_titlebar_height() - titlebar_border_thickness * 2;
-	scale_box(&box, output_scale);
-	render_rect(output, output_damage, &box, color);
-
-	// Single pixel right edge
-	box.x = x + width - titlebar_border_thickness;
-	box.y = y + titlebar_border_thickness;
-	box.width = titlebar_border_thickness;
-	box.height = container_titlebar_height() - titlebar_border_thickness * 2;
-	scale_box(&box, output_scale);
-	render_rect(output, output_damage, &box, color);
+	for (size_t i = 0; i < 4; ++i) {
+		render_rect(output, output_damage, &deco->titlebar_edges[i], color);
+	}
 
-	int inner_x = x - output_x + titlebar_h_padding;
 	int bg_y = y + titlebar_border_thickness;
-	size_t inner_width = width - titlebar_h_padding * 2;
 
 	// output-buffer local
-	int ob_inner_x = round(inner_x * output_scale);
-	int ob_inner_width = scale_length(inner_width, inner_x, output_scale);
-	int ob_bg_height = scale_length(
-			(titlebar_v_padding - titlebar_border_thickness) * 2 +
-			config->font_height, bg_y, output_scale);
+	int ob_inner_x = deco->ob_inner_x;
+	int ob_inner_width = deco->ob_inner_width;
+	int ob_bg_height = deco->ob_bg_height;
 
 	// Marks
 	int ob_marks_x = 0; // output-buffer-local
 	int ob_marks_width = 0; // output-buffer-local
 	if (config->show_marks && marks_texture) {
-		struct wlr_box texture_box;
-		wlr_texture_get_size(marks_texture,
-			&texture_box.width, &texture_box.height);
+		struct wlr_box texture_box = marks_texture->box;
+		struct wlr_fbox src_box;
+		text_atlas_entry_get_source_box(marks_texture, &src_box);
 		ob_marks_width = texture_box.width;
 
 		// The marks texture might be shorter than the config->font_height, in
@@ -505,8 +655,9 @@ static void render_titlebar(struct sway_output *output,
 		if (ob_inner_width < texture_box.width) {
 			texture_box.width = ob_inner_width;
 		}
-		render_texture(output->wlr_output, output_damage, marks_texture,
-			NULL, &texture_box, matrix, con->alpha);
+		render_texture(output->wlr_output, output_damage,
+			marks_texture->page->texture, &src_box, &texture_box, matrix,
+			con->alpha);
 
 		// Padding above
 		memcpy(&color, colors->background, sizeof(float) * 4);
@@ -527,9 +678,9 @@ static void render_titlebar(struct sway_output *output,
 	int ob_title_x = 0;  // output-buffer-local
 	int ob_title_width = 0; // output-buffer-local
 	if (title_texture) {
-		struct wlr_box texture_box;
-		wlr_texture_get_size(title_texture,
-			&texture_box.width, &texture_box.height);
+		struct wlr_box texture_box = title_texture->box;
+		struct wlr_fbox src_box;
+		text_atlas_entry_get_source_box(title_texture, &src_box);
 		ob_title_width = texture_box.width;
 
 		// The title texture might be shorter than the config->font_height,
@@ -573,8 +724,9 @@ static void render_titlebar(struct sway_output *output,
 			texture_box.width = ob_inner_width - ob_marks_width;
 		}
 
-		render_texture(output->wlr_output, output_damage, title_texture,
-			NULL, &texture_box, matrix, con->alpha);
+		render_texture(output->wlr_output, output_damage,
+			title_texture->page->texture, &src_box, &texture_box, matrix,
+			con->alpha);
 
 		// Padding above
 		memcpy(&color, colors->background, sizeof(float) * 4);
@@ -626,12 +778,7 @@ static void render_titlebar(struct sway_output *output,
 	}
 
 	// Padding on left side
-	box.x = x + titlebar_border_thickness;
-	box.y = y + titlebar_border_thickness;
-	box.width = titlebar_h_padding - titlebar_border_thickness;
-	box.height = (titlebar_v_padding - titlebar_border_thickness) * 2 +
-		config->font_height;
-	scale_box(&box, output_scale);
+	box = deco->titlebar_padding_left;
 	int left_x = ob_left_x + round(output_x * output_scale);
 	if (box.x + box.width < left_x) {
 		box.width += left_x - box.x - box.width;
@@ -639,12 +786,7 @@ static void render_titlebar(struct sway_output *output,
 	render_rect(output, output_damage, &box, color);
 
 	// Padding on right side
-	box.x = x + width - titlebar_h_padding;
-	box.y = y + titlebar_border_thickness;
-	box.width = titlebar_h_padding - titlebar_border_thickness;
-	box.height = (titlebar_v_padding - titlebar_border_thickness) * 2 +
-		config->font_height;
-	scale_box(&box, output_scale);
+	box = deco->titlebar_padding_right;
 	int right_rx = ob_right_x + ob_right_width + round(output_x * output_scale);
 	if (right_rx < box.x) {
 		box.width += box.x - right_rx;
@@ -663,19 +805,16 @@ static void render_top_border(struct sway_output *output,
 	if (!state->border_top) {
 		return;
 	}
-	struct wlr_box box;
 	float color[4];
-	float output_scale = output->wlr_output->scale;
+	struct sway_container_decorations *deco = get_decorations(con, output);
+	if (!deco->borders_valid) {
+		update_border_boxes(con, deco);
+	}
 
 	// Child border - top edge
 	memcpy(&color, colors->child_border, sizeof(float) * 4);
 	premultiply_alpha(color, con->alpha);
-	box.x = state->x;
-	box.y = state->y;
-	box.width = state->width;
-	box.height = state->border_thickness;
-	scale_box(&box, output_scale);
-	render_rect(output, output_damage, &box, color);
+	render_rect(output, output_damage, &deco->border_top, color);
 }
 
 struct parent_data {
@@ -686,6 +825,24 @@ struct parent_data {
 	struct sway_container *active_child;
 };
 
+/**
+ * Return the color class of a container's titlebar and borders. The parent is
+ * NULL for floating containers.
+ */
+static struct border_colors *get_container_colors(struct sway_container *con,
+		struct parent_data *parent) {
+	bool urgent = con->view ?
+		view_is_urgent(con->view) : container_has_urgent_child(con);
+	if (urgent) {
+		return &config->border_colors.urgent;
+	} else if (con->current.focused || (parent && parent->focused)) {
+		return &config->border_colors.focused;
+	} else if (parent && con == parent->active_child) {
+		return &config->border_colors.focused_inactive;
+	}
+	return &config->border_colors.unfocused;
+}
+
 static void render_container(struct sway_output *output,
 	pixman_region32_t *damage, struct sway_container *con, bool parent_focused);
 
@@ -701,34 +858,12 @@ static void render_containers_linear(struct sway_output *output,
 		struct sway_container *child = parent->children->items[i];
 
 		if (child->view) {
-			struct sway_view *view = child->view;
-			struct border_colors *colors;
-			struct wlr_texture *title_texture;
-			struct wlr_texture *marks_texture;
+			struct border_colors *colors = get_container_colors(child, parent);
 			struct sway_container_state *state = &child->current;
 
-			if (view_is_urgent(view)) {
-				colors = &config->border_colors.urgent;
-				title_texture = child->title_urgent;
-				marks_texture = child->marks_urgent;
-			} else if (state->focused || parent->focused) {
-				colors = &config->border_colors.focused;
-				title_texture = child->title_focused;
-				marks_texture = child->marks_focused;
-			} else if (child == parent->active_child) {
-				colors = &config->border_colors.focused_inactive;
-				title_texture = child->title_focused_inactive;
-				marks_texture = child->marks_focused_inactive;
-			} else {
-				colors = &config->border_colors.unfocused;
-				title_texture = child->title_unfocused;
-				marks_texture = child->marks_unfocused;
-			}
-
 			if (state->border == B_NORMAL) {
 				render_titlebar(output, damage, child, state->x,
-						state->y, state->width, colors,
-						title_texture, marks_texture);
+						state->y, state->width, colors);
 			} else if (state->border == B_PIXEL) {
 				render_top_border(output, damage, child, colors);
 			}
@@ -755,31 +890,8 @@ static void render_containers_tabbed(struct sway_output *output,
 	// Render tabs
 	for (int i = 0; i < parent->children->length; ++i) {
 		struct sway_container *child = parent->children->items[i];
-		struct sway_view *view = child->view;
 		struct sway_container_state *cstate = &child->current;
-		struct border_colors *colors;
-		struct wlr_texture *title_texture;
-		struct wlr_texture *marks_texture;
-		bool urgent = view ?
-			view_is_urgent(view) : container_has_urgent_child(child);
-
-		if (urgent) {
-			colors = &config->border_colors.urgent;
-			title_texture = child->title_urgent;
-			marks_texture = child->marks_urgent;
-		} else if (cstate->focused || parent->focused) {
-			colors = &config->border_colors.focused;
-			title_texture = child->title_focused;
-			marks_texture = child->marks_focused;
-		} else if (child == parent->active_child) {
-			colors = &config->border_colors.focused_inactive;
-			title_texture = child->title_focused_inactive;
-			marks_texture = child->marks_focused_inactive;
-		} else {
-			colors = &config->border_colors.unfocused;
-			title_texture = child->title_unfocused;
-			marks_texture = child->marks_unfocused;
-		}
+		struct border_colors *colors = get_container_colors(child, parent);
 
 		int x = cstate->x + tab_width * i;
 
@@ -789,7 +901,7 @@ static void render_containers_tabbed(struct sway_output *output,
 		}
 
 		render_titlebar(output, damage, child, x, parent->box.y, tab_width,
-				colors, title_texture, marks_texture);
+				colors);
 
 		if (child == current) {
 			current_colors = colors;
@@ -820,35 +932,11 @@ static void render_containers_stacked(struct sway_output *output,
 	// Render titles
 	for (int i = 0; i < parent->children->length; ++i) {
 		struct sway_container *child = parent->children->items[i];
-		struct sway_view *view = child->view;
-		struct sway_container_state *cstate = &child->current;
-		struct border_colors *colors;
-		struct wlr_texture *title_texture;
-		struct wlr_texture *marks_texture;
-		bool urgent = view ?
-			view_is_urgent(view) : container_has_urgent_child(child);
-
-		if (urgent) {
-			colors = &config->border_colors.urgent;
-			title_texture = child->title_urgent;
-			marks_texture = child->marks_urgent;
-		} else if (cstate->focused || parent->focused) {
-			colors = &config->border_colors.focused;
-			title_texture = child->title_focused;
-			marks_texture = child->marks_focused;
-		} else if (child == parent->active_child) {
-			colors = &config->border_colors.focused_inactive;
-			title_texture = child->title_focused_inactive;
-			marks_texture = child->marks_focused_inactive;
-		} else {
-			colors = &config->border_colors.unfocused;
-			title_texture = child->title_unfocused;
-			marks_texture = child->marks_unfocused;
-		}
+		struct border_colors *colors = get_container_colors(child, parent);
 
 		int y = parent->box.y + titlebar_height * i;
 		render_titlebar(output, damage, child, parent->box.x, y,
-				parent->box.width, colors, title_texture, marks_texture);
+				parent->box.width, colors);
 
 		if (child == current) {
 			current_colors = colors;
@@ -926,29 +1014,11 @@ static void render_workspace(struct sway_output *output,
 static void render_floating_container(struct sway_output *soutput,
 		pixman_region32_t *damage, struct sway_container *con) {
 	if (con->view) {
-		struct sway_view *view = con->view;
-		struct border_colors *colors;
-		struct wlr_texture *title_texture;
-		struct wlr_texture *marks_texture;
-
-		if (view_is_urgent(view)) {
-			colors = &config->border_colors.urgent;
-			title_texture = con->title_urgent;
-			marks_texture = con->marks_urgent;
-		} else if (con->current.focused) {
-			colors = &config->border_colors.focused;
-			title_texture = con->title_focused;
-			marks_texture = con->marks_focused;
-		} else {
-			colors = &config->border_colors.unfocused;
-			title_texture = con->title_unfocused;
-			marks_texture = con->marks_unfocused;
-		}
+		struct border_colors *colors = get_container_colors(con, NULL);
 
 		if (con->current.border == B_NORMAL) {
 			render_titlebar(soutput, damage, con, con->current.x,
-					con->current.y, con->current.width, colors,
-					title_texture, marks_texture);
+					con->current.y, con->current.width, colors);
 		} else if (con->current.border == B_PIXEL) {
 			render_top_border(soutput, damage, con, colors);
 		}
@@ -986,19 +1056,275 @@ static void render_seatops(struct sway_output *output,
 	}
 }
 
+static void prepare_container(struct sway_container *con, bool focused);
+
+static void prepare_containers(struct parent_data *parent) {
+	bool lone_view = config->hide_lone_tab && parent->children->length == 1 &&
+		((struct sway_container *)parent->children->items[0])->view;
+	bool titled = !lone_view &&
+		(parent->layout == L_TABBED || parent->layout == L_STACKED);
+
+	for (int i = 0; i < parent->children->length; ++i) {
+		struct sway_container *child = parent->children->items[i];
+		if (titled || (child->view && child->current.border == B_NORMAL)) {
+			container_prepare_titlebar_textures(child,
+					get_container_colors(child, parent));
+		}
+		if (child->view) {
+			continue;
+		}
+		// Only the active child of a tabbed or stacked container is visible
+		if (!titled || child == parent->active_child) {
+			prepare_container(child, parent->focused || child->current.focused);
+		}
+	}
+}
+
+static void prepare_container(struct sway_container *con, bool focused) {
+	struct parent_data data = {
+		.layout = con->current.layout,
+		.children = con->current.children,
+		.focused = focused,
+		.active_child = con->current.focused_inactive_child,
+	};
+	prepare_containers(&data);
+}
+
+static void prepare_floating_container(struct sway_container *con) {
+	if (con->view) {
+		if (con->current.border == B_NORMAL) {
+			container_prepare_titlebar_textures(con,
+					get_container_colors(con, NULL));
+		}
+	} else {
+		prepare_container(con, con->current.focused);
+	}
+}
+
+void output_prepare_render(struct sway_output *output) {
+	struct sway_workspace *workspace = output->current.active_workspace;
+	if (workspace == NULL || output_has_opaque_overlay_layer_surface(output)) {
+		return;
+	}
+
+	struct sway_container *fullscreen_con = root->fullscreen_global;
+	if (!fullscreen_con) {
+		fullscreen_con = workspace->current.fullscreen;
+	}
+
+	if (fullscreen_con) {
+		if (!fullscreen_con->view) {
+			prepare_container(fullscreen_con, fullscreen_con->current.focused);
+		}
+		for (int i = 0; i < workspace->current.floating->length; ++i) {
+			struct sway_container *floater =
+				workspace->current.floating->items[i];
+			if (container_is_transient_for(floater, fullscreen_con)) {
+				prepare_floating_container(floater);
+			}
+		}
+		return;
+	}
+
+	struct parent_data data = {
+		.layout = workspace->current.layout,
+		.children = workspace->current.tiling,
+		.focused = workspace->current.focused,
+		.active_child = workspace->current.focused_inactive_child,
+	};
+	prepare_containers(&data);
+
+	for (int i = 0; i < root->outputs->length; ++i) {
+		struct sway_output *o = root->outputs->items[i];
+		for (int j = 0; j < o->current.workspaces->length; ++j) {
+			struct sway_workspace *ws = o->current.workspaces->items[j];
+			if (!workspace_is_visible(ws)) {
+				continue;
+			}
+			for (int k = 0; k < ws->current.floating->length; ++k) {
+				struct sway_container *floater = ws->current.floating->items[k];
+				if (floater->fullscreen_mode == FULLSCREEN_NONE) {
+					prepare_floating_container(floater);
+				}
+			}
+		}
+	}
+}
+
+/**
+ * Add the opaque region of a surface to the region passed as data, in
+ * output-buffer-local coordinates. The region is rounded inwards so that it
+ * never claims a pixel the surface only partially covers.
+ */
+static void opaque_surface_iterator(struct sway_output *output,
+		struct sway_view *view, struct wlr_surface *surface,
+		struct wlr_box *box, float rotation, void *data) {
+	pixman_region32_t *opaque = data;
+	if (rotation != 0 || !wlr_surface_get_texture(surface)) {
+		return;
+	}
+
+	float scale = output->wlr_output->scale;
+	// Texture filtering blends edge pixels with their neighbours at
+	// fractional scales
+	int inset = scale == floor(scale) ? 0 : 1;
+
+	int nrects;
+	pixman_box32_t *rects =
+		pixman_region32_rectangles(&surface->opaque_region, &nrects);
+	for (int i = 0; i < nrects; ++i) {
+		int x1 = ceil((box->x + rects[i].x1) * scale) + inset;
+		int y1 = ceil((box->y + rects[i].y1) * scale) + inset;
+		int x2 = floor((box->x + rects[i].x2) * scale) - inset;
+		int y2 = floor((box->y + rects[i].y2) * scale) - inset;
+		if (x2 > x1 && y2 > y1) {
+			pixman_region32_union_rect(opaque, opaque,
+				x1, y1, x2 - x1, y2 - y1);
+		}
+	}
+}
+
+static void collect_layer_opaque(struct sway_output *output,
+		pixman_region32_t *opaque, struct wl_list *layer_surfaces) {
+	output_layer_for_each_surface_toplevel(output, layer_surfaces,
+		opaque_surface_iterator, opaque);
+}
+
+static void collect_view_opaque(struct sway_output *output,
+		pixman_region32_t *opaque, struct sway_view *view) {
+	// Saved buffers don't carry the opaque region they were committed with
+	if (view->container->alpha < 1.0f || !view->surface ||
+			!wl_list_empty(&view->saved_buffers)) {
+		return;
+	}
+	double ox = view->container->surface_x -
+		output->lx - view->geometry.x;
+	double oy = view->container->surface_y -
+		output->ly - view->geometry.y;
+	output_surface_for_each_surface(output, view->surface, ox, oy,
+			opaque_surface_iterator, opaque);
+}
+
+static void collect_container_opaque(struct sway_output *output,
+		pixman_region32_t *opaque, struct sway_container *con);
+
+/**
+ * Collect the opaque regions of the views render_containers() draws for these
+ * children. Only the active child of a tabbed or stacked container is drawn.
+ */
+static void collect_children_opaque(struct sway_output *output,
+		pixman_region32_t *opaque, enum sway_container_layout layout,
+		list_t *children, struct sway_container *active_child) {
+	if (layout == L_TABBED || layout == L_STACKED) {
+		if (active_child) {
+			collect_container_opaque(output, opaque, active_child);
+		}
+		return;
+	}
+	for (int i = 0; i < children->length; ++i) {
+		collect_container_opaque(output, opaque, children->items[i]);
+	}
+}
+
+static void collect_container_opaque(struct sway_output *output,
+		pixman_region32_t *opaque, struct sway_container *con) {
+	if (con->view) {
+		collect_view_opaque(output, opaque, con->view);
+	} else {
+		collect_children_opaque(output, opaque, con->current.layout,
+			con->current.children, con->current.focused_inactive_child);
+	}
+}
+
+static void collect_floating_opaque(struct sway_output *soutput,
+		pixman_region32_t *opaque) {
+	for (int i = 0; i < root->outputs->length; ++i) {
+		struct sway_output *output = root->outputs->items[i];
+		for (int j = 0; j < output->current.workspaces->length; ++j) {
+			struct sway_workspace *ws = output->current.workspaces->items[j];
+			if (!workspace_is_visible(ws)) {
+				continue;
+			}
+			for (int k = 0; k < ws->current.floating->length; ++k) {
+				struct sway_container *floater = ws->current.floating->items[k];
+				if (floater->fullscreen_mode == FULLSCREEN_NONE) {
+					collect_container_opaque(soutput, opaque, floater);
+				}
+			}
+		}
+	}
+}
+
+/**
+ * The damage each stratum of the output is rendered with, from the bottom
+ * layers up to the top layer. Each one excludes the opaque regions of the
+ * strata drawn above it, so covered content isn't drawn at all.
+ */
+struct render_damage {
+	pixman_region32_t bottom, workspace, floating, top;
+};
+
+static void render_damage_init(struct render_damage *rdamage,
+		struct sway_output *output, struct sway_workspace *workspace,
+		pixman_region32_t *damage) {
+	pixman_region32_init(&rdamage->bottom);
+	pixman_region32_init(&rdamage->workspace);
+	pixman_region32_init(&rdamage->floating);
+	pixman_region32_init(&rdamage->top);
+
+	if (debug.noocclusion) {
+		pixman_region32_copy(&rdamage->bottom, damage);
+		pixman_region32_copy(&rdamage->workspace, damage);
+		pixman_region32_copy(&rdamage->floating, damage);
+		pixman_region32_copy(&rdamage->top, damage);
+		return;
+	}
+
+	// Walk front to back, accumulating what is hidden so far
+	pixman_region32_t opaque;
+	pixman_region32_init(&opaque);
+
+	collect_layer_opaque(output, &opaque,
+		&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_OVERLAY]);
+	pixman_region32_subtract(&rdamage->top, damage, &opaque);
+
+	collect_layer_opaque(output, &opaque,
+		&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_TOP]);
+	pixman_region32_subtract(&rdamage->floating, damage, &opaque);
+
+	collect_floating_opaque(output, &opaque);
+	pixman_region32_subtract(&rdamage->workspace, damage, &opaque);
+
+	collect_children_opaque(output, &opaque, workspace->current.layout,
+		workspace->current.tiling, workspace->current.focused_inactive_child);
+	pixman_region32_subtract(&rdamage->bottom, damage, &opaque);
+
+	pixman_region32_fini(&opaque);
+}
+
+static void render_damage_fini(struct render_damage *rdamage) {
+	pixman_region32_fini(&rdamage->bottom);
+	pixman_region32_fini(&rdamage->workspace);
+	pixman_region32_fini(&rdamage->floating);
+	pixman_region32_fini(&rdamage->top);
+}
+
 void output_render(struct sway_output *output, struct timespec *when,
 		pixman_region32_t *damage) {
 	struct wlr_output *wlr_output = output->wlr_output;
+	struct sway_frame_timings *timings = &output->frame_timings;
 
 	struct wlr_renderer *renderer =
 		wlr_backend_get_renderer(wlr_output->backend);
 	if (!sway_assert(renderer != NULL,
 			"expected the output backend to have a renderer")) {
+		frame_timing_end(timings, false);
 		return;
 	}
 
 	struct sway_workspace *workspace = output->current.active_workspace;
 	if (workspace == NULL) {
+		frame_timing_end(timings, false);
 		return;
 	}
 
@@ -1022,6 +1348,8 @@ void output_render(struct sway_output *output, struct timespec *when,
 		pixman_region32_union_rect(damage, damage, 0, 0, width, height);
 	}
 
+	frame_timing_mark(timings, FRAME_PHASE_LAYERS);
+
 	if (output_has_opaque_overlay_layer_surface(output)) {
 		goto render_overlay;
 	}
@@ -1029,12 +1357,22 @@ void output_render(struct sway_output *output, struct timespec *when,
 	if (fullscreen_con) {
 		float clear_color[] = {0.0f, 0.0f, 0.0f, 1.0f};
 
+		// Only clear what the fullscreen container doesn't cover
+		pixman_region32_t clear_damage;
+		pixman_region32_init(&clear_damage);
+		if (!debug.noocclusion) {
+			collect_container_opaque(output, &clear_damage, fullscreen_con);
+		}
+		pixman_region32_subtract(&clear_damage, damage, &clear_damage);
+
 		int nrects;
-		pixman_box32_t *rects = pixman_region32_rectangles(damage, &nrects);
+		pixman_box32_t *rects =
+			pixman_region32_rectangles(&clear_damage, &nrects);
 		for (int i = 0; i < nrects; ++i) {
 			scissor_output(wlr_output, &rects[i]);
 			wlr_renderer_clear(renderer, clear_color);
 		}
+		pixman_region32_fini(&clear_damage);
 
 		if (fullscreen_con->view) {
 			if (!wl_list_empty(&fullscreen_con->view->saved_buffers)) {
@@ -1047,6 +1385,7 @@ void output_render(struct sway_output *output, struct timespec *when,
 			render_container(output, damage, fullscreen_con,
 					fullscreen_con->current.focused);
 		}
+		frame_timing_mark(timings, FRAME_PHASE_WORKSPACE);
 
 		for (int i = 0; i < workspace->current.floating->length; ++i) {
 			struct sway_container *floater =
@@ -1058,28 +1397,42 @@ void output_render(struct sway_output *output, struct timespec *when,
 #if HAVE_XWAYLAND
 		render_unmanaged(output, damage, &root->xwayland_unmanaged);
 #endif
+		frame_timing_mark(timings, FRAME_PHASE_FLOATING);
 	} else {
 		float clear_color[] = {0.25f, 0.25f, 0.25f, 1.0f};
 
+		struct render_damage rdamage;
+		render_damage_init(&rdamage, output, workspace, damage);
+
 		int nrects;
-		pixman_box32_t *rects = pixman_region32_rectangles(damage, &nrects);
+		pixman_box32_t *rects =
+			pixman_region32_rectangles(&rdamage.bottom, &nrects);
 		for (int i = 0; i < nrects; ++i) {
 			scissor_output(wlr_output, &rects[i]);
 			wlr_renderer_clear(renderer, clear_color);
 		}
 
-		render_layer_toplevel(output, damage,
+		render_layer_toplevel(output, &rdamage.bottom,
 			&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_BACKGROUND]);
-		render_layer_toplevel(output, damage,
+		render_layer_toplevel(output, &rdamage.bottom,
 			&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_BOTTOM]);
+		frame_timing_mark(timings, FRAME_PHASE_LAYERS);
 
-		render_workspace(output, damage, workspace, workspace->current.focused);
-		render_floating(output, damage);
+		render_workspace(output, &rdamage.workspace, workspace,
+			workspace->current.focused);
+		frame_timing_mark(timings, FRAME_PHASE_WORKSPACE);
+
+		render_floating(output, &rdamage.floating);
 #if HAVE_XWAYLAND
-		render_unmanaged(output, damage, &root->xwayland_unmanaged);
+		render_unmanaged(output, &rdamage.floating, &root->xwayland_unmanaged);
 #endif
-		render_layer_toplevel(output, damage,
+		frame_timing_mark(timings, FRAME_PHASE_FLOATING);
+
+		render_layer_toplevel(output, &rdamage.top,
 			&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_TOP]);
+		flush_rects();
+		render_damage_fini(&rdamage);
+		frame_timing_mark(timings, FRAME_PHASE_LAYERS);
 
 		render_layer_popups(output, damage,
 			&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_BACKGROUND]);
@@ -1096,6 +1449,7 @@ void output_render(struct sway_output *output, struct timespec *when,
 	if (focus && focus->view) {
 		render_view_popups(focus->view, output, damage, focus->alpha);
 	}
+	frame_timing_mark(timings, FRAME_PHASE_POPUPS);
 
 render_overlay:
 	render_layer_toplevel(output, damage,
@@ -1103,8 +1457,10 @@ render_overlay:
 	render_layer_popups(output, damage,
 		&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_OVERLAY]);
 	render_drag_icons(output, damage, &root->drag_icons);
+	frame_timing_mark(timings, FRAME_PHASE_OVERLAY);
 
 renderer_end:
+	flush_rects();
 	wlr_renderer_scissor(renderer, NULL);
 	wlr_output_render_software_cursors(wlr_output, damage);
 	wlr_renderer_end(renderer);
@@ -1128,7 +1484,10 @@ renderer_end:
 	wlr_output_set_damage(wlr_output, &frame_damage);
 	pixman_region32_fini(&frame_damage);
 
-	if (!wlr_output_commit(wlr_output)) {
+	bool committed = wlr_output_commit(wlr_output);
+	frame_timing_mark(timings, FRAME_PHASE_COMMIT);
+	frame_timing_end(timings, committed);
+	if (!committed) {
 		return;
 	}
 	output->last_frame = *when;
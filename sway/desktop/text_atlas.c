@@ -0,0 +1,420 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wlr/render/wlr_renderer.h>
+#include <wlr/render/wlr_texture.h>
+#include "cairo.h"
+#include "hash_table.h"
+#include "list.h"
+#include "log.h"
+#include "pango.h"
+#include "sway/desktop/text_atlas.h"
+
+#define TEXT_ATLAS_PAGE_WIDTH 2048
+#define TEXT_ATLAS_PAGE_HEIGHT 1024
+// Transparent gap kept between entries so that filtering never samples a
+// neighbour
+#define TEXT_ATLAS_PADDING 1
+
+struct text_atlas_shelf {
+	int y, height;
+	list_t *slots; // struct text_atlas_slot, sorted by x
+};
+
+struct text_atlas_slot {
+	int x, width;
+	struct sway_text_atlas_entry *entry; // NULL if the slot is free
+};
+
+static list_t *pages = NULL; // struct sway_text_atlas_page
+static hash_table_t *entries = NULL; // key -> struct sway_text_atlas_entry
+
+static char *build_key(struct wlr_renderer *renderer,
+		const struct text_atlas_params *params) {
+	const float *bg = params->background;
+	const float *fg = params->foreground;
+	const char *fmt = "%p\x1f%s\x1f%s\x1f%d\x1f%.4f\x1f%d\x1f%d\x1f"
+		"%.4f,%.4f,%.4f,%.4f\x1f%.4f,%.4f,%.4f,%.4f";
+	int len = snprintf(NULL, 0, fmt, (void *)renderer, params->text,
+			params->font, params->markup, params->scale, params->height,
+			params->subpixel, bg[0], bg[1], bg[2], bg[3],
+			fg[0], fg[1], fg[2], fg[3]);
+	char *key = malloc(len + 1);
+	if (!key) {
+		return NULL;
+	}
+	snprintf(key, len + 1, fmt, (void *)renderer, params->text,
+			params->font, params->markup, params->scale, params->height,
+			params->subpixel, bg[0], bg[1], bg[2], bg[3],
+			fg[0], fg[1], fg[2], fg[3]);
+	return key;
+}
+
+static cairo_font_options_t *create_font_options(
+		enum wl_output_subpixel subpixel) {
+	cairo_font_options_t *fo = cairo_font_options_create();
+	cairo_font_options_set_hint_style(fo, CAIRO_HINT_STYLE_FULL);
+	if (subpixel == WL_OUTPUT_SUBPIXEL_NONE) {
+		cairo_font_options_set_antialias(fo, CAIRO_ANTIALIAS_GRAY);
+	} else {
+		cairo_font_options_set_antialias(fo, CAIRO_ANTIALIAS_SUBPIXEL);
+		cairo_font_options_set_subpixel_order(fo,
+			to_cairo_subpixel_order(subpixel));
+	}
+	return fo;
+}
+
+/**
+ * Rasterize the text into a new surface which is padded to the right and the
+ * bottom with transparent pixels. The unpadded size is returned in width and
+ * height.
+ */
+static cairo_surface_t *rasterize(const struct text_atlas_params *params,
+		int *width, int *height) {
+	cairo_font_options_t *fo = create_font_options(params->subpixel);
+
+	// We must use a non-nil cairo_t for cairo_set_font_options to work.
+	// Therefore, we cannot use cairo_create(NULL).
+	cairo_surface_t *dummy_surface = cairo_image_surface_create(
+			CAIRO_FORMAT_ARGB32, 0, 0);
+	cairo_t *c = cairo_create(dummy_surface);
+	cairo_set_antialias(c, CAIRO_ANTIALIAS_BEST);
+	cairo_set_font_options(c, fo);
+	*width = 0;
+	get_text_size(c, params->font, width, NULL, NULL, params->scale,
+			params->markup, "%s", params->text);
+	cairo_surface_destroy(dummy_surface);
+	cairo_destroy(c);
+
+	*height = params->height;
+	if (*width <= 0 || *height <= 0) {
+		cairo_font_options_destroy(fo);
+		return NULL;
+	}
+
+	cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
+			*width + TEXT_ATLAS_PADDING, *height + TEXT_ATLAS_PADDING);
+	cairo_t *cairo = cairo_create(surface);
+	cairo_set_antialias(cairo, CAIRO_ANTIALIAS_BEST);
+	cairo_set_font_options(cairo, fo);
+	cairo_font_options_destroy(fo);
+	cairo_set_source_rgba(cairo, params->background[0],
+			params->background[1], params->background[2],
+			params->background[3]);
+	cairo_rectangle(cairo, 0, 0, *width, *height);
+	cairo_fill(cairo);
+	cairo_rectangle(cairo, 0, 0, *width, *height);
+	cairo_clip(cairo);
+	cairo_set_source_rgba(cairo, params->foreground[0],
+			params->foreground[1], params->foreground[2],
+			params->foreground[3]);
+	cairo_move_to(cairo, 0, 0);
+
+	pango_printf(cairo, params->font, params->scale, params->markup,
+			"%s", params->text);
+
+	cairo_surface_flush(surface);
+	cairo_destroy(cairo);
+	return surface;
+}
+
+static void page_destroy(struct sway_text_atlas_page *page) {
+	for (int i = 0; i < page->shelves->length; ++i) {
+		struct text_atlas_shelf *shelf = page->shelves->items[i];
+		list_free_items_and_destroy(shelf->slots);
+		free(shelf);
+	}
+	list_free(page->shelves);
+	wlr_texture_destroy(page->texture);
+	int index = list_find(pages, page);
+	if (index != -1) {
+		list_del(pages, index);
+	}
+	free(page);
+}
+
+static struct sway_text_atlas_page *page_create(struct wlr_renderer *renderer,
+		int width, int height, bool dedicated, int stride,
+		const void *data) {
+	struct sway_text_atlas_page *page =
+		calloc(1, sizeof(struct sway_text_atlas_page));
+	if (!page) {
+		return NULL;
+	}
+	void *blank = NULL;
+	if (!data) {
+		blank = calloc((size_t)width * height, 4);
+		if (!blank) {
+			free(page);
+			return NULL;
+		}
+		stride = width * 4;
+		data = blank;
+	}
+	page->texture = wlr_texture_from_pixels(renderer,
+			WL_SHM_FORMAT_ARGB8888, stride, width, height, data);
+	free(blank);
+	if (!page->texture) {
+		sway_log(SWAY_ERROR, "Unable to create %dx%d text atlas texture",
+				width, height);
+		free(page);
+		return NULL;
+	}
+	page->renderer = renderer;
+	page->width = width;
+	page->height = height;
+	page->dedicated = dedicated;
+	page->shelves = create_list();
+	list_add(pages, page);
+	return page;
+}
+
+static bool shelf_allocate(struct text_atlas_shelf *shelf, int width,
+		struct sway_text_atlas_entry *entry) {
+	for (int i = 0; i < shelf->slots->length; ++i) {
+		struct text_atlas_slot *slot = shelf->slots->items[i];
+		if (slot->entry || slot->width < width) {
+			continue;
+		}
+		if (slot->width > width) {
+			struct text_atlas_slot *rest =
+				calloc(1, sizeof(struct text_atlas_slot));
+			if (!rest) {
+				return false;
+			}
+			rest->x = slot->x + width;
+			rest->width = slot->width - width;
+			list_insert(shelf->slots, i + 1, rest);
+			slot->width = width;
+		}
+		slot->entry = entry;
+		entry->shelf = shelf;
+		entry->slot = slot;
+		entry->box.x = slot->x;
+		entry->box.y = shelf->y;
+		return true;
+	}
+	return false;
+}
+
+static bool page_allocate(struct sway_text_atlas_page *page, int width,
+		int height, struct sway_text_atlas_entry *entry) {
+	for (int i = 0; i < page->shelves->length; ++i) {
+		struct text_atlas_shelf *shelf = page->shelves->items[i];
+		// Don't waste more than a quarter of a shelf's height
+		if (shelf->height < height || shelf->height > height + height / 4) {
+			continue;
+		}
+		if (shelf_allocate(shelf, width, entry)) {
+			return true;
+		}
+	}
+
+	if (page->used_height + height > page->height) {
+		return false;
+	}
+	struct text_atlas_shelf *shelf = calloc(1, sizeof(struct text_atlas_shelf));
+	struct text_atlas_slot *slot = calloc(1, sizeof(struct text_atlas_slot));
+	if (!shelf || !slot) {
+		free(shelf);
+		free(slot);
+		return false;
+	}
+	shelf->y = page->used_height;
+	shelf->height = height;
+	shelf->slots = create_list();
+	slot->width = page->width;
+	list_add(shelf->slots, slot);
+	list_add(page->shelves, shelf);
+	page->used_height += height;
+	return shelf_allocate(shelf, width, entry);
+}
+
+static bool shelf_is_empty(struct text_atlas_shelf *shelf) {
+	if (shelf->slots->length != 1) {
+		return false;
+	}
+	struct text_atlas_slot *slot = shelf->slots->items[0];
+	return slot->entry == NULL;
+}
+
+static void page_free_slot(struct sway_text_atlas_page *page,
+		struct text_atlas_shelf *shelf, struct text_atlas_slot *slot) {
+	slot->entry = NULL;
+	int index = list_find(shelf->slots, slot);
+	if (index + 1 < shelf->slots->length) {
+		struct text_atlas_slot *next = shelf->slots->items[index + 1];
+		if (!next->entry) {
+			slot->width += next->width;
+			list_del(shelf->slots, index + 1);
+			free(next);
+		}
+	}
+	if (index > 0) {
+		struct text_atlas_slot *prev = shelf->slots->items[index - 1];
+		if (!prev->entry) {
+			prev->width += slot->width;
+			list_del(shelf->slots, index);
+			free(slot);
+		}
+	}
+
+	// Give the space of trailing empty shelves back to the page
+	while (page->shelves->length) {
+		struct text_atlas_shelf *last =
+			page->shelves->items[page->shelves->length - 1];
+		if (!shelf_is_empty(last)) {
+			break;
+		}
+		page->used_height -= last->height;
+		list_del(page->shelves, page->shelves->length - 1);
+		list_free_items_and_destroy(last->slots);
+		free(last);
+	}
+}
+
+static int count_shared_pages(struct wlr_renderer *renderer) {
+	int count = 0;
+	for (int i = 0; i < pages->length; ++i) {
+		struct sway_text_atlas_page *page = pages->items[i];
+		if (page->renderer == renderer && !page->dedicated) {
+			++count;
+		}
+	}
+	return count;
+}
+
+static bool atlas_insert(struct wlr_renderer *renderer,
+		struct sway_text_atlas_entry *entry, cairo_surface_t *surface) {
+	int padded_width = entry->box.width + TEXT_ATLAS_PADDING;
+	int padded_height = entry->box.height + TEXT_ATLAS_PADDING;
+	unsigned char *data = cairo_image_surface_get_data(surface);
+	int stride = cairo_image_surface_get_stride(surface);
+
+	if (padded_width > TEXT_ATLAS_PAGE_WIDTH ||
+			padded_height > TEXT_ATLAS_PAGE_HEIGHT) {
+		struct sway_text_atlas_page *page = page_create(renderer,
+				entry->box.width, entry->box.height, true, stride, data);
+		if (!page) {
+			return false;
+		}
+		entry->page = page;
+		entry->box.x = entry->box.y = 0;
+		page->nentries = 1;
+		return true;
+	}
+
+	struct sway_text_atlas_page *page = NULL;
+	for (int i = 0; i < pages->length; ++i) {
+		struct sway_text_atlas_page *candidate = pages->items[i];
+		if (candidate->renderer == renderer && !candidate->dedicated &&
+				page_allocate(candidate, padded_width, padded_height,
+					entry)) {
+			page = candidate;
+			break;
+		}
+	}
+	if (!page) {
+		page = page_create(renderer, TEXT_ATLAS_PAGE_WIDTH,
+				TEXT_ATLAS_PAGE_HEIGHT, false, 0, NULL);
+		if (!page) {
+			return false;
+		}
+		if (!page_allocate(page, padded_width, padded_height, entry)) {
+			page_destroy(page);
+			return false;
+		}
+	}
+	entry->page = page;
+	++page->nentries;
+
+	if (!wlr_texture_write_pixels(page->texture, stride,
+			padded_width, padded_height, 0, 0,
+			entry->box.x, entry->box.y, data)) {
+		sway_log(SWAY_ERROR, "Unable to upload text to the atlas");
+		page_free_slot(page, entry->shelf, entry->slot);
+		if (--page->nentries == 0 && count_shared_pages(renderer) > 1) {
+			page_destroy(page);
+		}
+		return false;
+	}
+	return true;
+}
+
+struct sway_text_atlas_entry *text_atlas_acquire(struct wlr_renderer *renderer,
+		const struct text_atlas_params *params) {
+	if (!pages) {
+		pages = create_list();
+		entries = create_hash_table();
+	}
+
+	char *key = build_key(renderer, params);
+	if (!key) {
+		return NULL;
+	}
+	struct sway_text_atlas_entry *entry = hash_table_get(entries, key);
+	if (entry) {
+		free(key);
+		++entry->refs;
+		return entry;
+	}
+
+	int width, height;
+	cairo_surface_t *surface = rasterize(params, &width, &height);
+	if (!surface) {
+		free(key);
+		return NULL;
+	}
+
+	entry = calloc(1, sizeof(struct sway_text_atlas_entry));
+	if (!entry) {
+		cairo_surface_destroy(surface);
+		free(key);
+		return NULL;
+	}
+	entry->key = key;
+	entry->refs = 1;
+	entry->box.width = width;
+	entry->box.height = height;
+
+	bool inserted = atlas_insert(renderer, entry, surface);
+	cairo_surface_destroy(surface);
+	if (!inserted) {
+		free(entry->key);
+		free(entry);
+		return NULL;
+	}
+
+	hash_table_set(entries, key, entry);
+	return entry;
+}
+
+void text_atlas_release(struct sway_text_atlas_entry *entry) {
+	if (!entry || --entry->refs > 0) {
+		return;
+	}
+	hash_table_remove(entries, entry->key);
+
+	struct sway_text_atlas_page *page = entry->page;
+	if (!page->dedicated) {
+		page_free_slot(page, entry->shelf, entry->slot);
+	}
+	// Keep one shared page around to avoid reallocating it when the last
+	// title is replaced
+	if (--page->nentries == 0 && (page->dedicated ||
+			count_shared_pages(page->renderer) > 1)) {
+		page_destroy(page);
+	}
+
+	free(entry->key);
+	free(entry);
+}
+
+void text_atlas_entry_get_source_box(struct sway_text_atlas_entry *entry,
+		struct wlr_fbox *box) {
+	box->x = entry->box.x;
+	box->y = entry->box.y;
+	box->width = entry->box.width;
+	box->height = entry->box.height;
+}
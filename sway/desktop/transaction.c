@@ -13,6 +13,7 @@
 #include "sway/output.h"
 #include "sway/tree/container.h"
 #include "sway/tree/node.h"
+#include "sway/tree/root.h"
 #include "sway/tree/view.h"
 #include "sway/tree/workspace.h"
 #include "list.h"
@@ -21,8 +22,10 @@
 struct sway_transaction {
 	struct wl_event_source *timer;
 	list_t *instructions;   // struct sway_transaction_instruction *
+	list_t *outputs;        // struct sway_output *, see transaction_domain
 	size_t num_waiting;
 	size_t num_configures;
+	bool committed;
 	struct timespec commit_time;
 };
 
@@ -37,16 +40,111 @@ struct sway_transaction_instruction {
 	uint32_t serial;
 };
 
+/**
+ * Interactive resizing and moving commit a transaction per pointer motion.
+ * Instead of freeing them, destroyed transactions, instructions and the lists
+ * in their states are kept here for reuse, so that such a stream of similar
+ * transactions doesn't allocate.
+ */
+#define TRANSACTION_POOL_MAX 512
+
+static struct {
+	list_t *transactions; // struct sway_transaction *
+	list_t *instructions; // struct sway_transaction_instruction *
+	list_t *lists; // list_t *
+	list_t *domains; // struct transaction_domain *
+} pool;
+
+static void *pool_take(list_t *free_list) {
+	if (!free_list || !free_list->length) {
+		return NULL;
+	}
+	void *item = free_list->items[free_list->length - 1];
+	--free_list->length;
+	return item;
+}
+
+static bool pool_give(list_t **free_list, void *item) {
+	if (!*free_list && !(*free_list = create_list())) {
+		return false;
+	}
+	if ((*free_list)->length >= TRANSACTION_POOL_MAX) {
+		return false;
+	}
+	list_add(*free_list, item);
+	return true;
+}
+
+static list_t *list_pool_get(void) {
+	list_t *list = pool_take(pool.lists);
+	return list ? list : create_list();
+}
+
+static void list_pool_put(list_t *list) {
+	if (!list) {
+		return;
+	}
+	list->length = 0;
+	if (!pool_give(&pool.lists, list)) {
+		list_free(list);
+	}
+}
+
+static struct sway_transaction_instruction *instruction_alloc(void) {
+	struct sway_transaction_instruction *instruction =
+		pool_take(pool.instructions);
+	if (instruction) {
+		memset(instruction, 0, sizeof(*instruction));
+		return instruction;
+	}
+	return calloc(1, sizeof(struct sway_transaction_instruction));
+}
+
+static void instruction_free(struct sway_transaction_instruction *instruction) {
+	if (!pool_give(&pool.instructions, instruction)) {
+		free(instruction);
+	}
+}
+
 static struct sway_transaction *transaction_create(void) {
-	struct sway_transaction *transaction =
-		calloc(1, sizeof(struct sway_transaction));
+	struct sway_transaction *transaction = pool_take(pool.transactions);
+	if (transaction) {
+		// Keep the lists and the timer of the previous use
+		list_t *instructions = transaction->instructions;
+		list_t *outputs = transaction->outputs;
+		struct wl_event_source *timer = transaction->timer;
+		memset(transaction, 0, sizeof(*transaction));
+		transaction->instructions = instructions;
+		transaction->outputs = outputs;
+		transaction->timer = timer;
+		return transaction;
+	}
+	transaction = calloc(1, sizeof(struct sway_transaction));
 	if (!sway_assert(transaction, "Unable to allocate transaction")) {
 		return NULL;
 	}
 	transaction->instructions = create_list();
+	transaction->outputs = create_list();
 	return transaction;
 }
 
+static void transaction_free(struct sway_transaction *transaction) {
+	transaction->instructions->length = 0;
+	transaction->outputs->length = 0;
+	if (transaction->timer) {
+		wl_event_source_timer_update(transaction->timer, 0);
+	}
+	if (pool_give(&pool.transactions, transaction)) {
+		return;
+	}
+	list_free(transaction->instructions);
+	list_free(transaction->outputs);
+	if (transaction->timer) {
+		wl_event_source_remove(transaction->timer);
+	}
+	free(transaction);
+}
+
 static void transaction_destroy(struct sway_transaction *transaction) {
 	// Free instructions
 	for (int i = 0; i < transaction->instructions->length; ++i) {
@@ -57,6 +155,12 @@ static void transaction_destroy(struct sway_transaction *transaction) {
 		if (node->instruction == instruction) {
 			node->instruction = NULL;
 		}
+		if (node->committed_instruction == instruction) {
+			node->committed_instruction = NULL;
+		}
+		if (node->queued_instruction == instruction) {
+			node->queued_instruction = NULL;
+		}
 		if (node->destroying && node->ntxnrefs == 0) {
 			switch (node->type) {
 			case N_ROOT:
@@ -73,20 +177,42 @@ static void transaction_destroy(struct sway_transaction *transaction) {
 				break;
 			}
 		}
-		free(instruction);
+		instruction_free(instruction);
 	}
-	list_free(transaction->instructions);
+	transaction_free(transaction);
+}
 
-	if (transaction->timer) {
-		wl_event_source_remove(transaction->timer);
+/**
+ * Free an instruction which is superseded before it was applied. Unlike in
+ * transaction_destroy(), the lists in its state aren't owned by the node.
+ */
+static void instruction_destroy_unapplied(
+		struct sway_transaction_instruction *instruction) {
+	struct sway_node *node = instruction->node;
+	switch (node->type) {
+	case N_ROOT:
+		break;
+	case N_OUTPUT:
+		list_pool_put(instruction->output_state.workspaces);
+		break;
+	case N_WORKSPACE:
+		list_pool_put(instruction->workspace_state.floating);
+		list_pool_put(instruction->workspace_state.tiling);
+		break;
+	case N_CONTAINER:
+		list_pool_put(instruction->container_state.children);
+		break;
 	}
-	free(transaction);
+	// The newer instruction still references the node, so it can't be
+	// destroyed here
+	node->ntxnrefs--;
+	instruction_free(instruction);
 }
 
 static void copy_output_state(struct sway_output *output,
 		struct sway_transaction_instruction *instruction) {
 	struct sway_output_state *state = &instruction->output_state;
-	state->workspaces = create_list();
+	state->workspaces = list_pool_get();
 	list_cat(state->workspaces, output->workspaces);
 
 	state->active_workspace = output_get_active_workspace(output);
@@ -104,8 +230,8 @@ static void copy_workspace_state(struct sway_workspace *ws,
 	state->layout = ws->layout;
 
 	state->output = ws->output;
-	state->floating = create_list();
-	state->tiling = create_list();
+	state->floating = list_pool_get();
+	state->tiling = list_pool_get();
 	list_cat(state->floating, ws->floating);
 	list_cat(state->tiling, ws->tiling);
 
@@ -146,7 +272,7 @@ static void copy_container_state(struct sway_container *container,
 	state->content_height = container->content_height;
 
 	if (!container->view) {
-		state->children = create_list();
+		state->children = list_pool_get();
 		list_cat(state->children, container->children);
 	}
 
@@ -162,8 +288,7 @@ static void copy_container_state(struct sway_container *container,
 
 static void transaction_add_node(struct sway_transaction *transaction,
 		struct sway_node *node) {
-	struct sway_transaction_instruction *instruction =
-		calloc(1, sizeof(struct sway_transaction_instruction));
+	struct sway_transaction_instruction *instruction = instruction_alloc();
 	if (!sway_assert(instruction, "Unable to allocate instruction")) {
 		return;
 	}
@@ -188,19 +313,32 @@ static void transaction_add_node(struct sway_transaction *transaction,
 	node->ntxnrefs++;
 }
 
+static void release_titlebar_textures_iterator(struct sway_container *con,
+		void *data) {
+	container_release_titlebar_textures(con);
+}
+
 static void apply_output_state(struct sway_output *output,
 		struct sway_output_state *state) {
+	struct sway_workspace *old_ws = output->current.active_workspace;
 	output_damage_whole(output);
-	list_free(output->current.workspaces);
+	list_pool_put(output->current.workspaces);
 	memcpy(&output->current, state, sizeof(struct sway_output_state));
 	output_damage_whole(output);
+
+	// Titlebars of a hidden workspace are rasterized again when it is shown
+	if (old_ws && old_ws != output->current.active_workspace &&
+			!old_ws->node.destroying) {
+		workspace_for_each_container(old_ws,
+				release_titlebar_textures_iterator, NULL);
+	}
 }
 
 static void apply_workspace_state(struct sway_workspace *ws,
 		struct sway_workspace_state *state) {
 	output_damage_whole(ws->current.output);
-	list_free(ws->current.floating);
-	list_free(ws->current.tiling);
+	list_pool_put(ws->current.floating);
+	list_pool_put(ws->current.tiling);
 	memcpy(&ws->current, state, sizeof(struct sway_workspace_state));
 	output_damage_whole(ws->current.output);
 }
@@ -228,12 +366,16 @@ static void apply_container_state(struct sway_container *container,
 	// (ie. con->children). The list itself needs to be freed here.
 	// Any child containers which are being deleted will be cleaned up in
 	// transaction_destroy().
-	list_free(container->current.children);
+	list_pool_put(container->current.children);
 
 	memcpy(&container->current, state, sizeof(struct sway_container_state));
+	container->decorations.borders_valid = false;
+	container->decorations.titlebar_valid = false;
 
 	if (view && !wl_list_empty(&view->saved_buffers)) {
-		if (!container->node.destroying || container->node.ntxnrefs == 1) {
+		if (!container->node.destroying) {
+			view_release_saved_buffer(view);
+		} else if (container->node.ntxnrefs == 1) {
 			view_remove_saved_buffer(view);
 		}
 	}
@@ -279,14 +421,23 @@ static void apply_container_state(struct sway_container *container,
  */
 static void transaction_apply(struct sway_transaction *transaction) {
 	sway_log(SWAY_DEBUG, "Applying transaction %p", transaction);
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	struct timespec *commit = &transaction->commit_time;
+	int64_t usec = (int64_t)(now.tv_sec - commit->tv_sec) * 1000000 +
+		(now.tv_nsec - commit->tv_nsec) / 1000;
 	if (debug.txn_timings) {
-		struct timespec now;
-		clock_gettime(CLOCK_MONOTONIC, &now);
-		struct timespec *commit = &transaction->commit_time;
-		float ms = (now.tv_sec - commit->tv_sec) * 1000 +
-			(now.tv_nsec - commit->tv_nsec) / 1000000.0;
+		float ms = usec / 1000.0f;
 		sway_log(SWAY_DEBUG, "Transaction %p: %.1fms waiting "
-				"(%.1f frames if 60Hz)", transaction, ms, ms / (1000.0f / 60));
+				"(%.1f frames if 60Hz) on %d outputs", transaction, ms,
+				ms / (1000.0f / 60), transaction->outputs->length);
+	}
+	for (int i = 0; i < root->outputs->length; ++i) {
+		struct sway_output *output = root->outputs->items[i];
+		// Disabled outputs don't record frame timings
+		if (list_find(transaction->outputs, output) != -1) {
+			frame_timing_record_transaction(&output->frame_timings, usec);
+		}
 	}
 
 	// Apply the instruction state to the node's current state
@@ -319,59 +470,57 @@ static void transaction_apply(struct sway_transaction *transaction) {
 
 static void transaction_commit(struct sway_transaction *transaction);
 
-// Return true if both transactions operate on the same nodes
-static bool transaction_same_nodes(struct sway_transaction *a,
-		struct sway_transaction *b) {
-	if (a->instructions->length != b->instructions->length) {
-		return false;
-	}
-	for (int i = 0; i < a->instructions->length; ++i) {
-		struct sway_transaction_instruction *a_inst = a->instructions->items[i];
-		struct sway_transaction_instruction *b_inst = b->instructions->items[i];
-		if (a_inst->node != b_inst->node) {
-			return false;
+// Return true if any node of the transaction is still part of a committed one
+static bool transaction_is_blocked(struct sway_transaction *transaction) {
+	for (int i = 0; i < transaction->instructions->length; ++i) {
+		struct sway_transaction_instruction *instruction =
+			transaction->instructions->items[i];
+		if (instruction->node->committed_instruction) {
+			return true;
 		}
 	}
-	return true;
+	return false;
 }
 
+/**
+ * Committed transactions never share nodes, so each of them is applied as soon
+ * as its own views are ready. Queued transactions are committed once none of
+ * their nodes are part of a committed transaction anymore.
+ */
 static void transaction_progress_queue(void) {
-	if (!server.transactions->length) {
-		return;
-	}
-	// Only the first transaction in the queue is committed, so that's the one
-	// we try to process.
-	struct sway_transaction *transaction = server.transactions->items[0];
-	if (transaction->num_waiting) {
-		return;
-	}
-	transaction_apply(transaction);
-	transaction_destroy(transaction);
-	list_del(server.transactions, 0);
-
-	if (server.transactions->length == 0) {
-		// The transaction queue is empty, so we're done.
-		sway_idle_inhibit_v1_check_active(server.idle_inhibit_manager_v1);
-		return;
-	}
+	while (server.transactions->length) {
+		struct sway_transaction *transaction = NULL;
+		int index = -1;
+		for (int i = 0; i < server.transactions->length; ++i) {
+			struct sway_transaction *txn = server.transactions->items[i];
+			if (txn->committed && !txn->num_waiting) {
+				transaction = txn;
+				index = i;
+				break;
+			}
+		}
+		if (transaction) {
+			list_del(server.transactions, index);
+			transaction_apply(transaction);
+			transaction_destroy(transaction);
+			continue;
+		}
 
-	// If there's a bunch of consecutive transactions which all apply to the
-	// same views, skip all except the last one.
-	while (server.transactions->length >= 2) {
-		struct sway_transaction *a = server.transactions->items[0];
-		struct sway_transaction *b = server.transactions->items[1];
-		if (transaction_same_nodes(a, b)) {
-			list_del(server.transactions, 0);
-			transaction_destroy(a);
-		} else {
-			break;
+		for (int i = 0; i < server.transactions->length; ++i) {
+			struct sway_transaction *txn = server.transactions->items[i];
+			if (!txn->committed && !transaction_is_blocked(txn)) {
+				transaction = txn;
+				break;
+			}
+		}
+		if (!transaction) {
+			return;
 		}
+		transaction_commit(transaction);
 	}
 
-	// We again commit the first transaction in the queue to process it.
-	transaction = server.transactions->items[0];
-	transaction_commit(transaction);
-	transaction_progress_queue();
+	// The transaction queue is empty, so we're done.
+	sway_idle_inhibit_v1_check_active(server.idle_inhibit_manager_v1);
 }
 
 static int handle_timeout(void *data) {
@@ -413,11 +562,16 @@ static bool should_configure(struct sway_node *node,
 static void transaction_commit(struct sway_transaction *transaction) {
 	sway_log(SWAY_DEBUG, "Transaction %p committing with %i instructions",
 			transaction, transaction->instructions->length);
+	transaction->committed = true;
 	transaction->num_waiting = 0;
 	for (int i = 0; i < transaction->instructions->length; ++i) {
 		struct sway_transaction_instruction *instruction =
 			transaction->instructions->items[i];
 		struct sway_node *node = instruction->node;
+		if (node->queued_instruction == instruction) {
+			node->queued_instruction = NULL;
+		}
+		node->committed_instruction = instruction;
 		if (should_configure(node, instruction)) {
 			instruction->serial = view_configure(node->sway_container->view,
 					instruction->container_state.content_x,
@@ -444,9 +598,7 @@ static void transaction_commit(struct sway_transaction *transaction) {
 		node->instruction = instruction;
 	}
 	transaction->num_configures = transaction->num_waiting;
-	if (debug.txn_timings) {
-		clock_gettime(CLOCK_MONOTONIC, &transaction->commit_time);
-	}
+	clock_gettime(CLOCK_MONOTONIC, &transaction->commit_time);
 	if (debug.noatomic) {
 		transaction->num_waiting = 0;
 	} else if (debug.txn_wait) {
@@ -457,8 +609,10 @@ static void transaction_commit(struct sway_transaction *transaction) {
 
 	if (transaction->num_waiting) {
 		// Set up a timer which the views must respond within
-		transaction->timer = wl_event_loop_add_timer(server.wl_event_loop,
-				handle_timeout, transaction);
+		if (!transaction->timer) {
+			transaction->timer = wl_event_loop_add_timer(
+					server.wl_event_loop, handle_timeout, transaction);
+		}
 		if (transaction->timer) {
 			wl_event_source_timer_update(transaction->timer,
 					server.txn_timeout_ms);
@@ -516,28 +670,259 @@ void transaction_notify_view_ready_by_size(struct sway_view *view,
 	}
 }
 
+/**
+ * Move the instructions of an older queued transaction into a newer one, which
+ * is about to be queued. Where both hold state for a node, the newer state
+ * wins. Nodes aren't marked dirty without a change, so the merged state is
+ * the same as if the older transaction never existed.
+ */
+static void transaction_merge(struct sway_transaction *transaction,
+		struct sway_transaction *older) {
+	sway_log(SWAY_DEBUG, "Merging transaction %p into %p",
+			older, transaction);
+	for (int i = 0; i < older->instructions->length; ++i) {
+		struct sway_transaction_instruction *instruction =
+			older->instructions->items[i];
+		struct sway_node *node = instruction->node;
+		struct sway_transaction_instruction *queued = node->queued_instruction;
+		if (queued && queued->transaction == transaction) {
+			instruction_destroy_unapplied(instruction);
+			continue;
+		}
+		instruction->transaction = transaction;
+		list_add(transaction->instructions, instruction);
+	}
+	for (int i = 0; i < older->outputs->length; ++i) {
+		struct sway_output *output = older->outputs->items[i];
+		if (list_find(transaction->outputs, output) == -1) {
+			list_add(transaction->outputs, output);
+		}
+	}
+	transaction_free(older);
+}
+
+/**
+ * Merge the queued transactions which share nodes with the given one into it,
+ * and commit it unless a committed transaction is still busy with some of its
+ * nodes.
+ */
+static void transaction_queue(struct sway_transaction *transaction) {
+	// Find the queued transactions which share nodes with this one. Queued
+	// transactions never share nodes with each other, so once they are merged
+	// into this one it is independent of the remaining ones.
+	list_t *merge = list_pool_get();
+	for (int i = 0; i < transaction->instructions->length; ++i) {
+		struct sway_transaction_instruction *instruction =
+			transaction->instructions->items[i];
+		struct sway_node *node = instruction->node;
+		if (node->queued_instruction) {
+			struct sway_transaction *queued =
+				node->queued_instruction->transaction;
+			if (list_find(merge, queued) == -1) {
+				list_add(merge, queued);
+			}
+		}
+		node->queued_instruction = instruction;
+	}
+	for (int i = 0; i < merge->length; ++i) {
+		struct sway_transaction *queued = merge->items[i];
+		list_del(server.transactions, list_find(server.transactions, queued));
+		transaction_merge(transaction, queued);
+	}
+	list_pool_put(merge);
+	// The merged instructions now belong to this transaction
+	for (int i = 0; i < transaction->instructions->length; ++i) {
+		struct sway_transaction_instruction *instruction =
+			transaction->instructions->items[i];
+		instruction->node->queued_instruction = instruction;
+	}
+
+	list_add(server.transactions, transaction);
+
+	if (!transaction_is_blocked(transaction)) {
+		transaction_commit(transaction);
+	}
+}
+
+/**
+ * A set of dirty nodes which is committed as a single transaction. Nodes are
+ * grouped by the outputs they are on before and after the change, so that
+ * layout changes on different outputs don't wait for each other's clients.
+ * A node which moves between outputs joins their domains into a cross-output
+ * one. Nodes without any output share a domain with no outputs.
+ */
+struct transaction_domain {
+	list_t *outputs; // struct sway_output *
+	list_t *nodes; // struct sway_node *
+};
+
+static struct transaction_domain *domain_create(void) {
+	struct transaction_domain *domain = pool_take(pool.domains);
+	if (!domain) {
+		domain = calloc(1, sizeof(struct transaction_domain));
+	}
+	if (!sway_assert(domain, "Unable to allocate transaction domain")) {
+		return NULL;
+	}
+	domain->outputs = list_pool_get();
+	domain->nodes = list_pool_get();
+	return domain;
+}
+
+static void domain_destroy(struct transaction_domain *domain) {
+	list_pool_put(domain->outputs);
+	list_pool_put(domain->nodes);
+	if (!pool_give(&pool.domains, domain)) {
+		free(domain);
+	}
+}
+
+/**
+ * Find the outputs the node is on in its current and its pending state.
+ * Returns their number, or -1 if the node is on all outputs.
+ */
+static int node_get_outputs(struct sway_node *node,
+		struct sway_output *outputs[static 2]) {
+	struct sway_output *current = NULL, *pending = NULL;
+	switch (node->type) {
+	case N_ROOT:
+		break;
+	case N_OUTPUT:
+		current = pending = node->sway_output;
+		break;
+	case N_WORKSPACE:
+		current = node->sway_workspace->current.output;
+		pending = node->sway_workspace->output;
+		break;
+	case N_CONTAINER: {
+		struct sway_container *con = node->sway_container;
+		if (con->fullscreen_mode == FULLSCREEN_GLOBAL ||
+				con->current.fullscreen_mode == FULLSCREEN_GLOBAL) {
+			return -1;
+		}
+		if (con->current.workspace) {
+			current = con->current.workspace->current.output;
+		}
+		if (con->workspace) {
+			pending = con->workspace->output;
+		}
+		break;
+	}
+	}
+	int count = 0;
+	if (current) {
+		outputs[count++] = current;
+	}
+	if (pending && pending != current) {
+		outputs[count++] = pending;
+	}
+	return count;
+}
+
+static bool domain_has_outputs(struct transaction_domain *domain,
+		struct sway_output **outputs, int count) {
+	if (count == 0) {
+		return domain->outputs->length == 0;
+	}
+	for (int i = 0; i < count; ++i) {
+		if (list_find(domain->outputs, outputs[i]) != -1) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void partition_dirty_nodes(list_t *domains) {
+	for (int i = 0; i < server.dirty_nodes->length; ++i) {
+		struct sway_node *node = server.dirty_nodes->items[i];
+		struct sway_output *outputs[2];
+		int count = node_get_outputs(node, outputs);
+		if (count < 0) {
+			// Everything goes into a single transaction
+			while (domains->length) {
+				domain_destroy(domains->items[0]);
+				list_del(domains, 0);
+			}
+			struct transaction_domain *domain = domain_create();
+			if (!domain) {
+				return;
+			}
+			list_cat(domain->nodes, server.dirty_nodes);
+			for (int j = 0; j < root->outputs->length; ++j) {
+				list_add(domain->outputs, root->outputs->items[j]);
+			}
+			list_add(domains, domain);
+			return;
+		}
+
+		struct transaction_domain *domain = NULL;
+		for (int j = 0; j < domains->length; ++j) {
+			struct transaction_domain *other = domains->items[j];
+			if (!domain_has_outputs(other, outputs, count)) {
+				continue;
+			}
+			if (!domain) {
+				domain = other;
+				continue;
+			}
+			// The node connects both domains
+			list_cat(domain->outputs, other->outputs);
+			list_cat(domain->nodes, other->nodes);
+			domain_destroy(other);
+			list_del(domains, j--);
+		}
+		if (!domain) {
+			if (!(domain = domain_create())) {
+				continue;
+			}
+			list_add(domains, domain);
+		}
+		for (int j = 0; j < count; ++j) {
+			if (list_find(domain->outputs, outputs[j]) == -1) {
+				list_add(domain->outputs, outputs[j]);
+			}
+		}
+		list_add(domain->nodes, node);
+	}
+}
+
+void transaction_remove_output(struct sway_output *output) {
+	for (int i = 0; i < server.transactions->length; ++i) {
+		struct sway_transaction *transaction = server.transactions->items[i];
+		int index = list_find(transaction->outputs, output);
+		if (index != -1) {
+			list_del(transaction->outputs, index);
+		}
+	}
+}
+
 void transaction_commit_dirty(void) {
 	if (!server.dirty_nodes->length) {
 		return;
 	}
-	struct sway_transaction *transaction = transaction_create();
-	if (!transaction) {
-		return;
-	}
+	list_t *domains = list_pool_get();
+	partition_dirty_nodes(domains);
 	for (int i = 0; i < server.dirty_nodes->length; ++i) {
 		struct sway_node *node = server.dirty_nodes->items[i];
-		transaction_add_node(transaction, node);
 		node->dirty = false;
 	}
 	server.dirty_nodes->length = 0;
 
-	list_add(server.transactions, transaction);
-
-	// We only commit the first transaction added to the queue.
-	if (server.transactions->length == 1) {
-		transaction_commit(transaction);
-		// Attempting to progress the queue here is useful
-		// if the transaction has nothing to wait for.
-		transaction_progress_queue();
+	for (int i = 0; i < domains->length; ++i) {
+		struct transaction_domain *domain = domains->items[i];
+		struct sway_transaction *transaction = transaction_create();
+		if (transaction) {
+			list_cat(transaction->outputs, domain->outputs);
+			for (int j = 0; j < domain->nodes->length; ++j) {
+				transaction_add_node(transaction, domain->nodes->items[j]);
+			}
+			transaction_queue(transaction);
+		}
+		domain_destroy(domain);
 	}
+	list_pool_put(domains);
+
+	// Attempting to progress the queue here is useful
+	// if the transactions have nothing to wait for.
+	transaction_progress_queue();
 }
@@ -274,6 +274,7 @@ static void handle_commit(struct wl_listener *listener, void *data) {
 		wl_container_of(listener, xdg_shell_view, commit);
 	struct sway_view *view = &xdg_shell_view->view;
 	struct wlr_xdg_surface *xdg_surface = view->wlr_xdg_surface;
+	view_bump_commit_seq(view);
 
 	if (view->container->node.instruction) {
 		wlr_xdg_surface_get_geometry(xdg_surface, &view->geometry);
@@ -313,6 +314,8 @@ static void handle_set_app_id(struct wl_listener *listener, void *data) {
 	struct sway_xdg_shell_view *xdg_shell_view =
 		wl_container_of(listener, xdg_shell_view, set_app_id);
 	struct sway_view *view = &xdg_shell_view->view;
+	node_bump_generation(&view->container->node);
+	view_invalidate_criteria_cache(view);
 	view_execute_criteria(view);
 }
 
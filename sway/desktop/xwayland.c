@@ -363,6 +363,7 @@ static void handle_commit(struct wl_listener *listener, void *data) {
 	struct sway_view *view = &xwayland_view->view;
 	struct wlr_xwayland_surface *xsurface = view->wlr_xwayland_surface;
 	struct wlr_surface_state *state = &xsurface->surface->current;
+	view_bump_commit_seq(view);
 
 	if (view->container->node.instruction) {
 		get_geometry(view, &view->geometry);
@@ -570,6 +571,8 @@ static void handle_set_class(struct wl_listener *listener, void *data) {
 	if (!xsurface->mapped) {
 		return;
 	}
+	node_bump_generation(&view->container->node);
+	view_invalidate_criteria_cache(view);
 	view_execute_criteria(view);
 }
 
@@ -581,6 +584,8 @@ static void handle_set_role(struct wl_listener *listener, void *data) {
 	if (!xsurface->mapped) {
 		return;
 	}
+	node_bump_generation(&view->container->node);
+	view_invalidate_criteria_cache(view);
 	view_execute_criteria(view);
 }
 
@@ -592,6 +597,7 @@ static void handle_set_window_type(struct wl_listener *listener, void *data) {
 	if (!xsurface->mapped) {
 		return;
 	}
+	node_bump_generation(&view->container->node);
 	view_execute_criteria(view);
 }
 
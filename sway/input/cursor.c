@@ -8,6 +8,7 @@
 #include <wlr/types/wlr_box.h>
 #include <wlr/types/wlr_cursor.h>
 #include <wlr/types/wlr_idle.h>
+#include <wlr/types/wlr_output_layout.h>
 #include <wlr/types/wlr_tablet_v2.h>
 #include <wlr/types/wlr_xcursor_manager.h>
 #include <wlr/util/region.h>
@@ -301,9 +302,90 @@ void cursor_unhide(struct sway_cursor *cursor) {
 	cursor_rebase(cursor);
 }
 
+/**
+ * Schedules the frame which flushes the batched motion on the output under the
+ * cursor, or on any other enabled output if there is none. Returns false if no
+ * output would flush it.
+ */
+static bool schedule_motion_frame(struct sway_cursor *cursor) {
+	struct wlr_output *wlr_output = wlr_output_layout_output_at(
+			root->output_layout, cursor->cursor->x, cursor->cursor->y);
+	struct sway_output *output =
+		wlr_output ? output_from_wlr_output(wlr_output) : NULL;
+	if (!output || !output->enabled) {
+		output = root->outputs->length ? root->outputs->items[0] : NULL;
+	}
+	if (!output || !output->wlr_output->enabled) {
+		return false;
+	}
+	wlr_output_schedule_frame(output->wlr_output);
+	return true;
+}
+
+/**
+ * Adds the motion to the cursor's batch, starting a new batch if there is
+ * none. A frame is scheduled for every motion, in case the output the batch
+ * was waiting for went away. Returns false if the motion can't be batched
+ * because no output would flush it.
+ */
+static bool batch_motion(struct sway_cursor *cursor, uint32_t time_msec,
+		double dx, double dy) {
+	if (!schedule_motion_frame(cursor)) {
+		return false;
+	}
+	if (!cursor->motion_batch.pending) {
+		cursor->motion_batch.pending = true;
+		cursor->motion_batch.dx = cursor->motion_batch.dy = 0;
+	}
+	cursor->motion_batch.time_msec = time_msec;
+	cursor->motion_batch.dx += dx;
+	cursor->motion_batch.dy += dy;
+	return true;
+}
+
+bool cursor_flush_motion(struct sway_cursor *cursor) {
+	if (!cursor->motion_batch.pending) {
+		return false;
+	}
+	cursor->motion_batch.pending = false;
+	seatop_pointer_motion(cursor->seat, cursor->motion_batch.time_msec,
+			cursor->motion_batch.dx, cursor->motion_batch.dy);
+	if (cursor->motion_batch.frame) {
+		cursor->motion_batch.frame = false;
+		wlr_seat_pointer_notify_frame(cursor->seat->wlr_seat);
+	}
+	return true;
+}
+
+void cursor_reschedule_motion_all(void) {
+	bool flushed = false;
+	struct sway_seat *seat;
+	wl_list_for_each(seat, &server.input->seats, link) {
+		struct sway_cursor *cursor = seat->cursor;
+		if (cursor->motion_batch.pending && !schedule_motion_frame(cursor)) {
+			flushed |= cursor_flush_motion(cursor);
+		}
+	}
+	if (flushed) {
+		transaction_commit_dirty();
+	}
+}
+
+void cursor_flush_motion_all(void) {
+	bool flushed = false;
+	struct sway_seat *seat;
+	wl_list_for_each(seat, &server.input->seats, link) {
+		flushed |= cursor_flush_motion(seat->cursor);
+	}
+	if (flushed) {
+		transaction_commit_dirty();
+	}
+}
+
 static void pointer_motion(struct sway_cursor *cursor, uint32_t time_msec,
 		struct wlr_input_device *device, double dx, double dy,
 		double dx_unaccel, double dy_unaccel) {
+	// Relative pointer clients always get every event
 	wlr_relative_pointer_manager_v1_send_relative_motion(
 		server.relative_pointer_manager,
 		cursor->seat->wlr_seat, (uint64_t)time_msec * 1000,
@@ -332,7 +414,24 @@ static void pointer_motion(struct sway_cursor *cursor, uint32_t time_msec,
 
 	wlr_cursor_move(cursor->cursor, device, dx, dy);
 
+	// Hit-testing and the seatop only need to see the motion once per
+	// output frame
+	if (cursor->motion_batching && device->type == WLR_INPUT_DEVICE_POINTER &&
+			batch_motion(cursor, time_msec, dx, dy)) {
+		return;
+	}
+	if (cursor->motion_batch.pending) {
+		cursor->motion_batch.pending = false;
+		dx += cursor->motion_batch.dx;
+		dy += cursor->motion_batch.dy;
+	}
+
 	seatop_pointer_motion(cursor->seat, time_msec, dx, dy);
+
+	if (cursor->motion_batch.frame) {
+		cursor->motion_batch.frame = false;
+		wlr_seat_pointer_notify_frame(cursor->seat->wlr_seat);
+	}
 }
 
 static void handle_pointer_motion_relative(
@@ -371,6 +470,7 @@ void dispatch_cursor_button(struct sway_cursor *cursor,
 		time_msec = get_current_time_msec();
 	}
 
+	cursor_flush_motion(cursor);
 	seatop_button(cursor->seat, time_msec, device, button, state);
 }
 
@@ -396,6 +496,7 @@ static void handle_pointer_button(struct wl_listener *listener, void *data) {
 
 void dispatch_cursor_axis(struct sway_cursor *cursor,
 		struct wlr_event_pointer_axis *event) {
+	cursor_flush_motion(cursor);
 	seatop_pointer_axis(cursor->seat, event);
 }
 
@@ -409,6 +510,11 @@ static void handle_pointer_axis(struct wl_listener *listener, void *data) {
 
 static void handle_pointer_frame(struct wl_listener *listener, void *data) {
 	struct sway_cursor *cursor = wl_container_of(listener, cursor, frame);
+	if (cursor->motion_batch.pending) {
+		// Sent after the batched motion
+		cursor->motion_batch.frame = true;
+		return;
+	}
 	wlr_seat_pointer_notify_frame(cursor->seat->wlr_seat);
 }
 
@@ -416,6 +522,7 @@ static void handle_touch_down(struct wl_listener *listener, void *data) {
 	struct sway_cursor *cursor = wl_container_of(listener, cursor, touch_down);
 	struct wlr_event_touch_down *event = data;
 	cursor_handle_activity(cursor, event->device);
+	cursor_flush_motion(cursor);
 	cursor_hide(cursor);
 
 	struct sway_seat *seat = cursor->seat;
@@ -463,6 +570,7 @@ static void handle_touch_up(struct wl_listener *listener, void *data) {
 	struct sway_cursor *cursor = wl_container_of(listener, cursor, touch_up);
 	struct wlr_event_touch_up *event = data;
 	cursor_handle_activity(cursor, event->device);
+	cursor_flush_motion(cursor);
 
 	struct wlr_seat *wlr_seat = cursor->seat->wlr_seat;
 
@@ -484,6 +592,7 @@ static void handle_touch_motion(struct wl_listener *listener, void *data) {
 		wl_container_of(listener, cursor, touch_motion);
 	struct wlr_event_touch_motion *event = data;
 	cursor_handle_activity(cursor, event->device);
+	cursor_flush_motion(cursor);
 
 	struct sway_seat *seat = cursor->seat;
 	struct wlr_seat *wlr_seat = seat->wlr_seat;
@@ -553,6 +662,7 @@ static void handle_tablet_tool_position(struct sway_cursor *cursor,
 		bool change_x, bool change_y,
 		double x, double y, double dx, double dy,
 		int32_t time_msec) {
+	cursor_flush_motion(cursor);
 
 	if (!change_x && !change_y) {
 		return;
@@ -662,6 +772,7 @@ static void handle_tool_tip(struct wl_listener *listener, void *data) {
 	struct sway_cursor *cursor = wl_container_of(listener, cursor, tool_tip);
 	struct wlr_event_tablet_tool_tip *event = data;
 	cursor_handle_activity(cursor, event->device);
+	cursor_flush_motion(cursor);
 
 	struct sway_tablet_tool *sway_tool = event->tool->data;
 	struct wlr_tablet_v2_tablet *tablet_v2 = sway_tool->tablet->tablet_v2;
@@ -745,6 +856,7 @@ static void handle_tool_button(struct wl_listener *listener, void *data) {
 	struct sway_cursor *cursor = wl_container_of(listener, cursor, tool_button);
 	struct wlr_event_tablet_tool_button *event = data;
 	cursor_handle_activity(cursor, event->device);
+	cursor_flush_motion(cursor);
 
 	struct sway_tablet_tool *sway_tool = event->tool->data;
 	if (!sway_tool) {
@@ -874,6 +986,7 @@ static void handle_pointer_pinch_begin(struct wl_listener *listener, void *data)
 	struct sway_cursor *cursor = wl_container_of(
 			listener, cursor, pinch_begin);
 	struct wlr_event_pointer_pinch_begin *event = data;
+	cursor_flush_motion(cursor);
 	wlr_pointer_gestures_v1_send_pinch_begin(
 			cursor->pointer_gestures, cursor->seat->wlr_seat,
 			event->time_msec, event->fingers);
@@ -902,6 +1015,7 @@ static void handle_pointer_swipe_begin(struct wl_listener *listener, void *data)
 	struct sway_cursor *cursor = wl_container_of(
 			listener, cursor, swipe_begin);
 	struct wlr_event_pointer_swipe_begin *event = data;
+	cursor_flush_motion(cursor);
 	wlr_pointer_gestures_v1_send_swipe_begin(
 			cursor->pointer_gestures, cursor->seat->wlr_seat,
 			event->time_msec, event->fingers);
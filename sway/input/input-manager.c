@@ -504,6 +504,16 @@ void input_manager_set_focus(struct sway_node *node) {
 	}
 }
 
+void input_manager_invalidate_focus_index(struct sway_node *node) {
+	if (!server.input) {
+		return;
+	}
+	struct sway_seat *seat;
+	wl_list_for_each(seat, &server.input->seats, link) {
+		seat_invalidate_focus_index(seat, node);
+	}
+}
+
 /**
  * Re-translate keysyms if a change in the input config could affect them.
  */
@@ -562,22 +572,98 @@ void input_manager_reset_input(struct sway_input_device *input_device) {
 	}
 }
 
-void input_manager_reset_all_inputs(void) {
+static bool input_config_changed(list_t *old_configs, list_t *new_configs,
+		const char *identifier) {
+	struct input_config *old_ic = NULL, *new_ic = NULL;
+	int i = list_seq_find(old_configs, input_identifier_cmp, identifier);
+	if (i >= 0) {
+		old_ic = old_configs->items[i];
+	}
+	i = list_seq_find(new_configs, input_identifier_cmp, identifier);
+	if (i >= 0) {
+		new_ic = new_configs->items[i];
+	}
+	if (!old_ic || !new_ic) {
+		return old_ic != new_ic;
+	}
+	return !input_config_equal(old_ic, new_ic);
+}
+
+/**
+ * The xkb files a keymap is compiled from aren't part of the config, so they
+ * can change while the keyboard's config stays the same.
+ */
+static bool input_device_keymap_outdated(struct sway_input_device *device) {
+	if (device->wlr_device->type != WLR_INPUT_DEVICE_KEYBOARD) {
+		return false;
+	}
+	struct sway_seat *seat;
+	wl_list_for_each(seat, &server.input->seats, link) {
+		struct sway_seat_device *seat_device;
+		wl_list_for_each(seat_device, &seat->devices, link) {
+			if (seat_device->input_device == device &&
+					seat_device->keyboard &&
+					sway_keyboard_keymap_outdated(seat_device->keyboard)) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void input_manager_apply_changed_input_configs(struct sway_config *old_config) {
+	bool wildcard_changed = input_config_changed(old_config->input_configs,
+			config->input_configs, "*");
+	bool changed = false;
+	char type_identifier[64];
 	struct sway_input_device *input_device = NULL;
 	wl_list_for_each(input_device, &server.input->devices, link) {
+		snprintf(type_identifier, sizeof(type_identifier), "type:%s",
+				input_device_get_type(input_device));
+		if (!wildcard_changed &&
+				!input_config_changed(old_config->input_configs,
+					config->input_configs, input_device->identifier) &&
+				!input_config_changed(old_config->input_type_configs,
+					config->input_type_configs, type_identifier) &&
+				!input_device_keymap_outdated(input_device)) {
+			continue;
+		}
+		sway_log(SWAY_DEBUG, "Input config for %s changed",
+				input_device->identifier);
 		input_manager_reset_input(input_device);
+		input_manager_configure_input(input_device);
+		changed = true;
 	}
 
-	// If there is at least one keyboard using the default keymap, repeat delay,
-	// and repeat rate, then it is possible that there is a keyboard group that
-	// need their keyboard disarmed.
-	struct sway_seat *seat;
-	wl_list_for_each(seat, &server.input->seats, link) {
-		struct sway_keyboard_group *group;
-		wl_list_for_each(group, &seat->keyboard_groups, link) {
-			sway_keyboard_disarm_key_repeat(group->seat_device->keyboard);
+	if (changed) {
+		// If there is at least one keyboard using the default keymap, repeat
+		// delay, and repeat rate, then it is possible that there is a keyboard
+		// group that need their keyboard disarmed.
+		struct sway_seat *seat;
+		wl_list_for_each(seat, &server.input->seats, link) {
+			struct sway_keyboard_group *group;
+			wl_list_for_each(group, &seat->keyboard_groups, link) {
+				sway_keyboard_disarm_key_repeat(group->seat_device->keyboard);
+			}
 		}
 	}
+
+	// The bindings of the new config still need their keysyms translated
+	for (int i = 0; i < config->input_configs->length; i++) {
+		retranslate_keysyms(config->input_configs->items[i]);
+	}
+}
+
+void input_manager_apply_changed_seat_configs(struct sway_config *old_config) {
+	for (int i = 0; i < config->seat_configs->length; i++) {
+		struct seat_config *sc = config->seat_configs->items[i];
+		int j = list_seq_find(old_config->seat_configs, seat_name_cmp,
+				sc->name);
+		if (j >= 0 && seat_config_equal(old_config->seat_configs->items[j], sc)) {
+			continue;
+		}
+		input_manager_apply_seat_config(sc);
+	}
 }
 
 void input_manager_apply_seat_config(struct seat_config *seat_config) {
@@ -1,6 +1,8 @@
+#define _POSIX_C_SOURCE 200809L
 #include <assert.h>
 #include <limits.h>
 #include <strings.h>
+#include <sys/stat.h>
 #include <wlr/backend/multi.h>
 #include <wlr/backend/session.h>
 #include <wlr/interfaces/wlr_keyboard.h>
@@ -10,10 +12,13 @@
 #include <xkbcommon/xkbcommon-names.h>
 #include "sway/commands.h"
 #include "sway/desktop/transaction.h"
+#include "sway/input/cursor.h"
 #include "sway/input/input-manager.h"
 #include "sway/input/keyboard.h"
 #include "sway/input/seat.h"
 #include "sway/ipc-server.h"
+#include "sway/worker_pool.h"
+#include "hash_table.h"
 #include "log.h"
 
 static struct modifier_key {
@@ -146,107 +151,140 @@ static bool update_shortcut_state(struct sway_shortcut_state *state,
 }
 
 /**
- * If one exists, finds a binding which matches the shortcut model state,
- * current modifiers, release state, and locked state.
+ * Compare a binding whose keys match the shortcut model state against the
+ * current best binding, replacing it if it is a better match. Returns true if
+ * the binding is a perfect match, which ends the search.
  */
-static void get_active_binding(const struct sway_shortcut_state *state,
-		list_t *bindings, struct sway_binding **current_binding,
-		uint32_t modifiers, bool release, bool locked, bool inhibited,
-		const char *input, bool exact_input, xkb_layout_index_t group) {
-	for (int i = 0; i < bindings->length; ++i) {
-		struct sway_binding *binding = bindings->items[i];
-		bool binding_locked = (binding->flags & BINDING_LOCKED) != 0;
-		bool binding_inhibited = (binding->flags & BINDING_INHIBITED) != 0;
-		bool binding_release = binding->flags & BINDING_RELEASE;
-
-		if (modifiers ^ binding->modifiers ||
-				release != binding_release ||
-				locked > binding_locked ||
-				inhibited > binding_inhibited ||
-				(binding->group != XKB_LAYOUT_INVALID &&
-				 binding->group != group) ||
-				(strcmp(binding->input, input) != 0 &&
-				 (strcmp(binding->input, "*") != 0 || exact_input))) {
-			continue;
+static bool update_active_binding(struct sway_binding *binding,
+		struct sway_binding **current_binding, bool locked, bool inhibited,
+		const char *input, xkb_layout_index_t group) {
+	bool binding_locked = (binding->flags & BINDING_LOCKED) != 0;
+	bool binding_inhibited = (binding->flags & BINDING_INHIBITED) != 0;
+
+	if (locked > binding_locked ||
+			inhibited > binding_inhibited ||
+			(binding->group != XKB_LAYOUT_INVALID &&
+			 binding->group != group)) {
+		return false;
+	}
+
+	if (*current_binding) {
+		if (*current_binding == binding) {
+			return false;
 		}
 
-		bool match = false;
-		if (state->npressed == (size_t)binding->keys->length) {
-			match = true;
-			for (size_t j = 0; j < state->npressed; j++) {
-				uint32_t key = *(uint32_t *)binding->keys->items[j];
-				if (key != state->pressed_keys[j]) {
-					match = false;
-					break;
-				}
-			}
-		} else if (binding->keys->length == 1) {
-			/*
-			 * If no multiple-key binding has matched, try looking for
-			 * single-key bindings that match the newly-pressed key.
-			 */
-			match = state->current_key == *(uint32_t *)binding->keys->items[0];
+		bool current_locked =
+			((*current_binding)->flags & BINDING_LOCKED) != 0;
+		bool current_inhibited =
+			((*current_binding)->flags & BINDING_INHIBITED) != 0;
+		bool current_input = strcmp((*current_binding)->input, input) == 0;
+		bool current_group_set =
+			(*current_binding)->group != XKB_LAYOUT_INVALID;
+		bool binding_input = strcmp(binding->input, input) == 0;
+		bool binding_group_set = binding->group != XKB_LAYOUT_INVALID;
+
+		if (current_input == binding_input
+				&& current_locked == binding_locked
+				&& current_inhibited == binding_inhibited
+				&& current_group_set == binding_group_set) {
+			sway_log(SWAY_DEBUG,
+					"Encountered conflicting bindings %d and %d",
+					(*current_binding)->order, binding->order);
+			return false;
 		}
-		if (!match) {
-			continue;
+
+		if (current_input && !binding_input) {
+			return false; // Prefer the correct input
 		}
 
-		if (*current_binding) {
-			if (*current_binding == binding) {
-				continue;
-			}
+		if (current_input == binding_input &&
+			   (*current_binding)->group == group) {
+			return false; // Prefer correct group for matching inputs
+		}
 
-			bool current_locked =
-				((*current_binding)->flags & BINDING_LOCKED) != 0;
-			bool current_inhibited =
-				((*current_binding)->flags & BINDING_INHIBITED) != 0;
-			bool current_input = strcmp((*current_binding)->input, input) == 0;
-			bool current_group_set =
-				(*current_binding)->group != XKB_LAYOUT_INVALID;
-			bool binding_input = strcmp(binding->input, input) == 0;
-			bool binding_group_set = binding->group != XKB_LAYOUT_INVALID;
-
-			if (current_input == binding_input
-					&& current_locked == binding_locked
-					&& current_inhibited == binding_inhibited
-					&& current_group_set == binding_group_set) {
-				sway_log(SWAY_DEBUG,
-						"Encountered conflicting bindings %d and %d",
-						(*current_binding)->order, binding->order);
-				continue;
-			}
+		if (current_input == binding_input &&
+				current_group_set == binding_group_set &&
+				current_locked == locked) {
+			return false; // Prefer correct lock state for matching input+group
+		}
 
-			if (current_input && !binding_input) {
-				continue; // Prefer the correct input
-			}
+		if (current_input == binding_input &&
+				current_group_set == binding_group_set &&
+				current_locked == binding_locked &&
+				current_inhibited == inhibited) {
+			// Prefer correct inhibition state for matching
+			// input+group+locked
+			return false;
+		}
+	}
 
-			if (current_input == binding_input &&
-				   (*current_binding)->group == group) {
-				continue; // Prefer correct group for matching inputs
-			}
+	*current_binding = binding;
+	// If a perfect match is found, quit searching
+	return strcmp((*current_binding)->input, input) == 0 &&
+		(((*current_binding)->flags & BINDING_LOCKED) == locked) &&
+		(((*current_binding)->flags & BINDING_INHIBITED) == inhibited) &&
+		(*current_binding)->group == group;
+}
 
-			if (current_input == binding_input &&
-					current_group_set == binding_group_set &&
-					current_locked == locked) {
-				continue; // Prefer correct lock state for matching input+group
-			}
+/**
+ * If one exists, finds a binding which matches the shortcut model state,
+ * current modifiers, release state, and locked state.
+ *
+ * Candidates are looked up in the binding index rather than scanned: those
+ * whose keys are exactly the pressed keys and, unless a single key is pressed,
+ * single-key bindings for the newly-pressed key. Each comes from a bucket for
+ * the device and, unless the device must match exactly, one for "*". The
+ * buckets are merged back into binding list order, which the conflict
+ * resolution depends on.
+ */
+static void get_active_binding(const struct sway_shortcut_state *state,
+		hash_table_t *index, struct sway_binding **current_binding,
+		uint32_t modifiers, bool release, bool locked, bool inhibited,
+		const char *input, bool exact_input, xkb_layout_index_t group) {
+	if (!index) {
+		return;
+	}
+	bool wildcard = !exact_input && strcmp(input, "*") != 0;
+
+	list_t *buckets[4];
+	int cursors[4] = {0};
+	int nbuckets = 0;
+	buckets[nbuckets++] = binding_index_lookup(index, input, modifiers,
+			release, state->pressed_keys, state->npressed);
+	if (wildcard) {
+		buckets[nbuckets++] = binding_index_lookup(index, "*", modifiers,
+				release, state->pressed_keys, state->npressed);
+	}
+	if (state->npressed != 1) {
+		buckets[nbuckets++] = binding_index_lookup(index, input, modifiers,
+				release, &state->current_key, 1);
+		if (wildcard) {
+			buckets[nbuckets++] = binding_index_lookup(index, "*", modifiers,
+					release, &state->current_key, 1);
+		}
+	}
 
-			if (current_input == binding_input &&
-					current_group_set == binding_group_set &&
-					current_locked == binding_locked &&
-					current_inhibited == inhibited) {
-				// Prefer correct inhibition state for matching
-				// input+group+locked
+	while (true) {
+		struct sway_binding *binding = NULL;
+		int next = -1;
+		for (int i = 0; i < nbuckets; ++i) {
+			if (!buckets[i] || cursors[i] == buckets[i]->length) {
 				continue;
 			}
+			struct sway_binding *candidate = buckets[i]->items[cursors[i]];
+			if (!binding || candidate->position < binding->position) {
+				binding = candidate;
+				next = i;
+			}
+		}
+		if (!binding) {
+			return;
 		}
+		++cursors[next];
 
-		*current_binding = binding;
-		if (strcmp((*current_binding)->input, input) == 0 &&
-				(((*current_binding)->flags & BINDING_LOCKED) == locked) &&
-				(((*current_binding)->flags & BINDING_INHIBITED) == inhibited) &&
-				(*current_binding)->group == group) {
-			return; // If a perfect match is found, quit searching
+		if (update_active_binding(binding, current_binding, locked, inhibited,
+				input, group)) {
+			return;
 		}
 	}
 }
@@ -386,6 +424,9 @@ static void handle_key_event(struct sway_keyboard *keyboard,
 		keyboard->seat_device->input_device->wlr_device;
 	char *device_identifier = input_device_get_identifier(wlr_device);
 	bool exact_identifier = wlr_device->keyboard->group != NULL;
+
+	// Focus has to follow the pointer before the key is delivered
+	cursor_flush_motion(seat->cursor);
 	seat_idle_notify_activity(seat, IDLE_SOURCE_KEYBOARD);
 	bool input_inhibited = seat->exclusive_client != NULL;
 	struct sway_keyboard_shortcuts_inhibitor *sway_inhibitor =
@@ -400,17 +441,20 @@ static void handle_key_event(struct sway_keyboard *keyboard,
 	// Identify active release binding
 	struct sway_binding *binding_released = NULL;
 	get_active_binding(&keyboard->state_keycodes,
-			config->current_mode->keycode_bindings, &binding_released,
+			mode_get_binding_index(config->current_mode, BINDING_KEYCODE),
+			&binding_released,
 			keyinfo.code_modifiers, true, input_inhibited,
 			shortcuts_inhibited, device_identifier,
 			exact_identifier, keyboard->effective_layout);
 	get_active_binding(&keyboard->state_keysyms_raw,
-			config->current_mode->keysym_bindings, &binding_released,
+			mode_get_binding_index(config->current_mode, BINDING_KEYSYM),
+			&binding_released,
 			keyinfo.raw_modifiers, true, input_inhibited,
 			shortcuts_inhibited, device_identifier,
 			exact_identifier, keyboard->effective_layout);
 	get_active_binding(&keyboard->state_keysyms_translated,
-			config->current_mode->keysym_bindings, &binding_released,
+			mode_get_binding_index(config->current_mode, BINDING_KEYSYM),
+			&binding_released,
 			keyinfo.translated_modifiers, true, input_inhibited,
 			shortcuts_inhibited, device_identifier,
 			exact_identifier, keyboard->effective_layout);
@@ -432,17 +476,20 @@ static void handle_key_event(struct sway_keyboard *keyboard,
 	struct sway_binding *binding = NULL;
 	if (event->state == WLR_KEY_PRESSED) {
 		get_active_binding(&keyboard->state_keycodes,
-				config->current_mode->keycode_bindings, &binding,
+				mode_get_binding_index(config->current_mode, BINDING_KEYCODE),
+				&binding,
 				keyinfo.code_modifiers, false, input_inhibited,
 				shortcuts_inhibited, device_identifier,
 				exact_identifier, keyboard->effective_layout);
 		get_active_binding(&keyboard->state_keysyms_raw,
-				config->current_mode->keysym_bindings, &binding,
+				mode_get_binding_index(config->current_mode, BINDING_KEYSYM),
+				&binding,
 				keyinfo.raw_modifiers, false, input_inhibited,
 				shortcuts_inhibited, device_identifier,
 				exact_identifier, keyboard->effective_layout);
 		get_active_binding(&keyboard->state_keysyms_translated,
-				config->current_mode->keysym_bindings, &binding,
+				mode_get_binding_index(config->current_mode, BINDING_KEYSYM),
+				&binding,
 				keyinfo.translated_modifiers, false, input_inhibited,
 				shortcuts_inhibited, device_identifier,
 				exact_identifier, keyboard->effective_layout);
@@ -699,8 +746,8 @@ static void handle_xkb_context_log(struct xkb_context *context,
 	}
 }
 
-struct xkb_keymap *sway_keyboard_compile_keymap(struct input_config *ic,
-		char **error) {
+static struct xkb_keymap *compile_keymap(const char *xkb_file,
+		const struct xkb_rule_names *rules, char **error) {
 	struct xkb_context *context = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
 	if (!sway_assert(context, "cannot create XKB context")) {
 		return NULL;
@@ -710,17 +757,17 @@ struct xkb_keymap *sway_keyboard_compile_keymap(struct input_config *ic,
 
 	struct xkb_keymap *keymap = NULL;
 
-	if (ic && ic->xkb_file) {
-		FILE *keymap_file = fopen(ic->xkb_file, "r");
+	if (xkb_file) {
+		FILE *keymap_file = fopen(xkb_file, "r");
 		if (!keymap_file) {
-			sway_log_errno(SWAY_ERROR, "cannot read xkb file %s", ic->xkb_file);
+			sway_log_errno(SWAY_ERROR, "cannot read xkb file %s", xkb_file);
 			if (error) {
 				size_t len = snprintf(NULL, 0, "cannot read xkb file %s: %s",
-						ic->xkb_file, strerror(errno)) + 1;
+						xkb_file, strerror(errno)) + 1;
 				*error = malloc(len);
 				if (*error) {
 					snprintf(*error, len, "cannot read xkb_file %s: %s",
-							ic->xkb_file, strerror(errno));
+							xkb_file, strerror(errno));
 				}
 			}
 			goto cleanup;
@@ -731,14 +778,10 @@ struct xkb_keymap *sway_keyboard_compile_keymap(struct input_config *ic,
 
 		if (fclose(keymap_file) != 0) {
 			sway_log_errno(SWAY_ERROR, "Failed to close xkb file %s",
-					ic->xkb_file);
+					xkb_file);
 		}
 	} else {
-		struct xkb_rule_names rules = {0};
-		if (ic) {
-			input_config_fill_rule_names(ic, &rules);
-		}
-		keymap = xkb_keymap_new_from_names(context, &rules,
+		keymap = xkb_keymap_new_from_names(context, rules,
 			XKB_KEYMAP_COMPILE_NO_FLAGS);
 	}
 
@@ -748,6 +791,213 @@ cleanup:
 	return keymap;
 }
 
+/**
+ * Compiled keymaps by their sources, so that identical input configs (and the
+ * many validation merges done while reading the config) share one compile.
+ * Keymaps can be compiled ahead of time on the worker pool.
+ */
+struct keymap_cache_entry {
+	struct xkb_keymap *keymap; // NULL while compiling or if it failed
+	struct sway_worker_job *job; // while compiling
+};
+
+struct keymap_job {
+	struct keymap_cache_entry *entry;
+	char *xkb_file;
+	struct xkb_rule_names rules;
+	struct xkb_keymap *keymap;
+};
+
+static hash_table_t *keymap_cache = NULL;
+
+static char *keymap_cache_key(const char *xkb_file,
+		const struct xkb_rule_names *rules) {
+	char *key;
+	if (xkb_file) {
+		// The file is keyed by its modification time as well, so that
+		// changes are picked up
+		struct stat sb;
+		if (stat(xkb_file, &sb) != 0) {
+			return NULL;
+		}
+		const char *fmt = "file:%lld.%09ld:%lld:%s";
+		size_t len = snprintf(NULL, 0, fmt, (long long)sb.st_mtim.tv_sec,
+				sb.st_mtim.tv_nsec, (long long)sb.st_size, xkb_file) + 1;
+		if ((key = malloc(len))) {
+			snprintf(key, len, fmt, (long long)sb.st_mtim.tv_sec,
+					sb.st_mtim.tv_nsec, (long long)sb.st_size, xkb_file);
+		}
+		return key;
+	}
+	// libxkbcommon treats NULL and empty names alike
+	const char *names[] = {
+		rules->rules, rules->model, rules->layout, rules->variant,
+		rules->options,
+	};
+	const char *fmt = "names:%s\x1f%s\x1f%s\x1f%s\x1f%s";
+	for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+		names[i] = names[i] ? names[i] : "";
+	}
+	size_t len = snprintf(NULL, 0, fmt, names[0], names[1], names[2],
+			names[3], names[4]) + 1;
+	if ((key = malloc(len))) {
+		snprintf(key, len, fmt, names[0], names[1], names[2], names[3],
+				names[4]);
+	}
+	return key;
+}
+
+static void keymap_job_run(void *data) {
+	struct keymap_job *job = data;
+	job->keymap = compile_keymap(job->xkb_file, &job->rules, NULL);
+}
+
+static void keymap_job_done(void *data) {
+	struct keymap_job *job = data;
+	job->entry->keymap = job->keymap;
+	job->entry->job = NULL;
+	free(job->xkb_file);
+	free((char *)job->rules.rules);
+	free((char *)job->rules.model);
+	free((char *)job->rules.layout);
+	free((char *)job->rules.variant);
+	free((char *)job->rules.options);
+	free(job);
+}
+
+static char *strdup_or_null(const char *str) {
+	return str ? strdup(str) : NULL;
+}
+
+static void keymap_cache_prepare(const char *xkb_file,
+		const struct xkb_rule_names *rules) {
+	char *key = keymap_cache_key(xkb_file, rules);
+	if (!key) {
+		return;
+	}
+	if (!keymap_cache && !(keymap_cache = create_hash_table())) {
+		free(key);
+		return;
+	}
+	if (hash_table_get(keymap_cache, key)) {
+		free(key);
+		return;
+	}
+
+	struct keymap_cache_entry *entry =
+		calloc(1, sizeof(struct keymap_cache_entry));
+	struct keymap_job *job = calloc(1, sizeof(struct keymap_job));
+	if (!entry || !job) {
+		free(entry);
+		free(job);
+		free(key);
+		return;
+	}
+	hash_table_set(keymap_cache, key, entry);
+	free(key);
+
+	job->entry = entry;
+	job->xkb_file = strdup_or_null(xkb_file);
+	job->rules.rules = strdup_or_null(rules->rules);
+	job->rules.model = strdup_or_null(rules->model);
+	job->rules.layout = strdup_or_null(rules->layout);
+	job->rules.variant = strdup_or_null(rules->variant);
+	job->rules.options = strdup_or_null(rules->options);
+	entry->job = worker_pool_submit(keymap_job_run, keymap_job_done, job);
+}
+
+static struct xkb_keymap *keymap_cache_get(const char *xkb_file,
+		const struct xkb_rule_names *rules, char **error) {
+	char *key = keymap_cache_key(xkb_file, rules);
+	struct keymap_cache_entry *entry =
+		key && keymap_cache ? hash_table_get(keymap_cache, key) : NULL;
+	if (!entry) {
+		struct xkb_keymap *keymap = compile_keymap(xkb_file, rules, error);
+		if (keymap && key) {
+			entry = calloc(1, sizeof(struct keymap_cache_entry));
+			if (entry && (keymap_cache ||
+					(keymap_cache = create_hash_table()))) {
+				entry->keymap = xkb_keymap_ref(keymap);
+				hash_table_set(keymap_cache, key, entry);
+			} else {
+				free(entry);
+			}
+		}
+		free(key);
+		return keymap;
+	}
+	free(key);
+
+	if (entry->job) {
+		worker_job_wait(entry->job);
+	}
+	if (!entry->keymap) {
+		// Compile again for the error message
+		return error ? compile_keymap(xkb_file, rules, error) : NULL;
+	}
+	return xkb_keymap_ref(entry->keymap);
+}
+
+static void free_keymap_cache_entry(const char *key, void *value,
+		void *data) {
+	struct keymap_cache_entry *entry = value;
+	xkb_keymap_unref(entry->keymap);
+	free(entry);
+}
+
+static void wait_keymap_cache_entry(const char *key, void *value,
+		void *data) {
+	struct keymap_cache_entry *entry = value;
+	if (entry->job) {
+		worker_job_wait(entry->job);
+	}
+}
+
+void sway_keyboard_clear_keymap_cache(void) {
+	if (!keymap_cache) {
+		return;
+	}
+	hash_table_for_each(keymap_cache, wait_keymap_cache_entry, NULL);
+	hash_table_for_each(keymap_cache, free_keymap_cache_entry, NULL);
+	hash_table_clear(keymap_cache);
+}
+
+void sway_keyboard_prepare_keymap(struct input_config *ic) {
+	struct xkb_rule_names rules = {0};
+	if (ic) {
+		input_config_fill_rule_names(ic, &rules);
+	}
+	keymap_cache_prepare(ic ? ic->xkb_file : NULL, &rules);
+}
+
+struct xkb_keymap *sway_keyboard_compile_keymap(struct input_config *ic,
+		char **error) {
+	struct xkb_rule_names rules = {0};
+	if (ic) {
+		input_config_fill_rule_names(ic, &rules);
+	}
+	return keymap_cache_get(ic ? ic->xkb_file : NULL, &rules, error);
+}
+
+struct xkb_keymap *sway_keyboard_compile_keymap_from_names(
+		const struct xkb_rule_names *rules) {
+	return keymap_cache_get(NULL, rules, NULL);
+}
+
+bool sway_keyboard_keymap_outdated(struct sway_keyboard *keyboard) {
+	struct input_config *ic =
+		input_device_get_config(keyboard->seat_device->input_device);
+	struct xkb_keymap *keymap = sway_keyboard_compile_keymap(ic, NULL);
+	if (!keymap) {
+		// Left to sway_keyboard_configure, which falls back to the defaults
+		return true;
+	}
+	bool outdated = !keyboard->keymap ||
+		!wlr_keyboard_keymaps_match(keyboard->keymap, keymap);
+	xkb_keymap_unref(keymap);
+	return outdated;
+}
+
 static bool repeat_info_match(struct sway_keyboard *a, struct wlr_keyboard *b) {
 	return a->repeat_rate == b->repeat_info.rate &&
 		a->repeat_delay == b->repeat_info.delay;
@@ -46,6 +46,16 @@ static void seat_device_destroy(struct sway_seat_device *seat_device) {
 	free(seat_device);
 }
 
+static void seat_node_destroy(struct sway_seat_node *seat_node) {
+	// The node's parent no longer has this entry in its subtree
+	seat_invalidate_focus_index(seat_node->seat,
+		node_get_parent(seat_node->node));
+	wl_list_remove(&seat_node->destroy.link);
+	wl_list_remove(&seat_node->link);
+	wl_list_remove(&seat_node->node_link);
+	free(seat_node);
+}
+
 void seat_destroy(struct sway_seat *seat) {
 	struct sway_seat_device *seat_device, *next;
 	wl_list_for_each_safe(seat_device, next, &seat->devices, link) {
@@ -58,6 +68,10 @@ void seat_destroy(struct sway_seat *seat) {
 	wl_list_remove(&seat->request_set_selection.link);
 	wl_list_remove(&seat->request_set_primary_selection.link);
 	wl_list_remove(&seat->link);
+	struct sway_seat_node *seat_node, *next_seat_node;
+	wl_list_for_each_safe(seat_node, next_seat_node, &seat->focus_stack, link) {
+		seat_node_destroy(seat_node);
+	}
 	wlr_seat_destroy(seat->wlr_seat);
 	for (int i = 0; i < seat->deferred_bindings->length; i++) {
 		free_sway_binding(seat->deferred_bindings->items[i]);
@@ -67,12 +81,6 @@ void seat_destroy(struct sway_seat *seat) {
 	free(seat);
 }
 
-static void seat_node_destroy(struct sway_seat_node *seat_node) {
-	wl_list_remove(&seat_node->destroy.link);
-	wl_list_remove(&seat_node->link);
-	free(seat_node);
-}
-
 void seat_idle_notify_activity(struct sway_seat *seat,
 		enum sway_input_idle_source source) {
 	uint32_t mask = seat->idle_inhibit_sources;
@@ -197,20 +205,252 @@ void seat_for_each_node(struct sway_seat *seat,
 	}
 }
 
+#define FOCUS_SEQ_NONE INT64_MIN
+
+static struct sway_seat_node *seat_node_find(struct sway_seat *seat,
+		struct sway_node *node) {
+	struct sway_seat_node *seat_node;
+	wl_list_for_each(seat_node, &node->seat_nodes, node_link) {
+		if (seat_node->seat == seat) {
+			return seat_node;
+		}
+	}
+	return NULL;
+}
+
+static bool node_has_focus_index(struct sway_node *node) {
+	return node && (node->type == N_WORKSPACE || node->type == N_CONTAINER);
+}
+
+void seat_invalidate_focus_index(struct sway_seat *seat,
+		struct sway_node *node) {
+	for (; node_has_focus_index(node); node = node_get_parent(node)) {
+		struct sway_seat_node *seat_node = seat_node_find(seat, node);
+		if (!seat_node) {
+			continue;
+		}
+		if (seat_node->index_dirty) {
+			return; // so are its ancestors
+		}
+		seat_node->index_dirty = true;
+	}
+}
+
+/**
+ * Rebuild a dirty focus index from the indexes of the node's children.
+ */
+static void seat_node_update_index(struct sway_seat_node *seat_node) {
+	if (!seat_node->index_dirty) {
+		return;
+	}
+	struct sway_seat *seat = seat_node->seat;
+	struct sway_node *node = seat_node->node;
+
+	seat_node->subtree_seq = seat_node->focus_seq;
+	seat_node->view_seq =
+		node_is_view(node) ? seat_node->focus_seq : FOCUS_SEQ_NONE;
+	seat_node->active_child = NULL;
+	seat_node->inactive_child = NULL;
+	seat_node->inactive_floating = NULL;
+	seat_node->view_child = NULL;
+
+	list_t *children = NULL, *floating = NULL;
+	if (node->type == N_WORKSPACE) {
+		children = node->sway_workspace->tiling;
+		floating = node->sway_workspace->floating;
+	} else {
+		children = node->sway_container->children;
+	}
+
+	int64_t active_seq = FOCUS_SEQ_NONE;
+	int64_t inactive_seq = FOCUS_SEQ_NONE;
+	int64_t floating_seq = FOCUS_SEQ_NONE;
+	for (int i = 0; children && i < children->length; ++i) {
+		struct sway_container *con = children->items[i];
+		struct sway_seat_node *child = seat_node_find(seat, &con->node);
+		if (!child) {
+			continue;
+		}
+		seat_node_update_index(child);
+		if (child->focus_seq > active_seq) {
+			active_seq = child->focus_seq;
+			seat_node->active_child = &con->node;
+		}
+		if (child->subtree_seq > inactive_seq) {
+			inactive_seq = child->subtree_seq;
+			seat_node->inactive_child = &con->node;
+		}
+		if (child->view_seq > seat_node->view_seq) {
+			seat_node->view_seq = child->view_seq;
+			seat_node->view_child = &con->node;
+		}
+	}
+	for (int i = 0; floating && i < floating->length; ++i) {
+		struct sway_container *con = floating->items[i];
+		struct sway_seat_node *child = seat_node_find(seat, &con->node);
+		if (!child) {
+			continue;
+		}
+		seat_node_update_index(child);
+		if (child->subtree_seq > floating_seq) {
+			floating_seq = child->subtree_seq;
+			seat_node->inactive_floating = &con->node;
+		}
+		if (child->view_seq > seat_node->view_seq) {
+			seat_node->view_seq = child->view_seq;
+			seat_node->view_child = &con->node;
+		}
+	}
+	if (inactive_seq > seat_node->subtree_seq) {
+		seat_node->subtree_seq = inactive_seq;
+	}
+	if (floating_seq > seat_node->subtree_seq) {
+		seat_node->subtree_seq = floating_seq;
+	}
+	seat_node->index_dirty = false;
+}
+
+/**
+ * Return the seat node of a workspace or container with an up to date focus
+ * index, or NULL if the node has none.
+ */
+static struct sway_seat_node *seat_node_get_index(struct sway_seat *seat,
+		struct sway_node *node) {
+	if (!node_has_focus_index(node)) {
+		return NULL;
+	}
+	struct sway_seat_node *seat_node = seat_node_find(seat, node);
+	if (seat_node) {
+		seat_node_update_index(seat_node);
+	}
+	return seat_node;
+}
+
+/**
+ * Return the child whose subtree holds the most recent focus stack entry,
+ * floating or not.
+ */
+static struct sway_node *index_inactive_child(struct sway_seat_node *index) {
+	if (!index->inactive_child || !index->inactive_floating) {
+		return index->inactive_child ?
+			index->inactive_child : index->inactive_floating;
+	}
+	struct sway_seat_node *tiling =
+		seat_node_get_index(index->seat, index->inactive_child);
+	struct sway_seat_node *floating =
+		seat_node_get_index(index->seat, index->inactive_floating);
+	if (!tiling || !floating) {
+		return tiling ? index->inactive_child : index->inactive_floating;
+	}
+	return floating->subtree_seq > tiling->subtree_seq ?
+		index->inactive_floating : index->inactive_child;
+}
+
+/**
+ * Return the most recent focus stack entry in the subtree rooted at node,
+ * which may be the node itself.
+ */
+static struct sway_node *focus_index_descend(struct sway_seat *seat,
+		struct sway_node *node) {
+	while (node) {
+		struct sway_seat_node *index = seat_node_get_index(seat, node);
+		if (!index || index->subtree_seq == FOCUS_SEQ_NONE) {
+			return NULL;
+		}
+		if (index->focus_seq == index->subtree_seq) {
+			return node;
+		}
+		node = index_inactive_child(index);
+	}
+	return NULL;
+}
+
+/**
+ * Return the most recently focused view in the subtree rooted at node.
+ */
+static struct sway_node *focus_index_descend_view(struct sway_seat *seat,
+		struct sway_node *node) {
+	while (node) {
+		struct sway_seat_node *index = seat_node_get_index(seat, node);
+		if (!index || index->view_seq == FOCUS_SEQ_NONE) {
+			return NULL;
+		}
+		if (node_is_view(node)) {
+			return node;
+		}
+		node = index->view_child;
+	}
+	return NULL;
+}
+
+static void consider_subtree(struct sway_seat *seat, struct sway_node *node,
+		bool views, struct sway_node **best, int64_t *best_seq) {
+	struct sway_seat_node *index = seat_node_get_index(seat, node);
+	if (!index) {
+		return;
+	}
+	int64_t seq = views ? index->view_seq : index->subtree_seq;
+	if (seq > *best_seq) {
+		*best = node;
+		*best_seq = seq;
+	}
+}
+
+static void consider_output_subtrees(struct sway_seat *seat,
+		struct sway_output *output, bool views, struct sway_node **best,
+		int64_t *best_seq) {
+	for (int i = 0; i < output->workspaces->length; ++i) {
+		struct sway_workspace *ws = output->workspaces->items[i];
+		consider_subtree(seat, &ws->node, views, best, best_seq);
+	}
+}
+
+/**
+ * Outputs and the root have no focus index. Return the node below the given
+ * output or root whose subtree holds the most recent focus stack entry, or
+ * view entry.
+ */
+static struct sway_node *get_recent_subtree(struct sway_seat *seat,
+		struct sway_node *node, bool views) {
+	struct sway_node *best = NULL;
+	int64_t best_seq = FOCUS_SEQ_NONE;
+	if (node->type == N_OUTPUT) {
+		consider_output_subtrees(seat, node->sway_output, views,
+			&best, &best_seq);
+		return best;
+	}
+
+	for (int i = 0; i < root->outputs->length; ++i) {
+		consider_output_subtrees(seat, root->outputs->items[i], views,
+			&best, &best_seq);
+	}
+	if (root->noop_output) {
+		consider_output_subtrees(seat, root->noop_output, views,
+			&best, &best_seq);
+	}
+	// A detached global fullscreen container is considered a descendant of
+	// the root, see node_has_ancestor, and so is its subtree
+	struct sway_container *fullscreen = root->fullscreen_global;
+	if (fullscreen && !node_get_parent(&fullscreen->node)) {
+		consider_subtree(seat, &fullscreen->node, views, &best, &best_seq);
+	}
+	return best;
+}
+
 struct sway_container *seat_get_focus_inactive_view(struct sway_seat *seat,
 		struct sway_node *ancestor) {
 	if (ancestor->type == N_CONTAINER && ancestor->sway_container->view) {
 		return ancestor->sway_container;
 	}
-	struct sway_seat_node *current;
-	wl_list_for_each(current, &seat->focus_stack, link) {
-		struct sway_node *node = current->node;
-		if (node->type == N_CONTAINER && node->sway_container->view &&
-				node_has_ancestor(node, ancestor)) {
-			return node->sway_container;
-		}
+	struct sway_node *node = NULL;
+	if (ancestor->type == N_ROOT || ancestor->type == N_OUTPUT) {
+		node = get_recent_subtree(seat, ancestor, true);
+	} else {
+		struct sway_seat_node *index = seat_node_get_index(seat, ancestor);
+		node = index ? index->view_child : NULL;
 	}
-	return NULL;
+	node = focus_index_descend_view(seat, node);
+	return node ? node->sway_container : NULL;
 }
 
 static void handle_seat_node_destroy(struct wl_listener *listener, void *data) {
@@ -313,11 +553,9 @@ static struct sway_seat_node *seat_node_from_node(
 		return NULL;
 	}
 
-	struct sway_seat_node *seat_node = NULL;
-	wl_list_for_each(seat_node, &seat->focus_stack, link) {
-		if (seat_node->node == node) {
-			return seat_node;
-		}
+	struct sway_seat_node *seat_node = seat_node_find(seat, node);
+	if (seat_node) {
+		return seat_node;
 	}
 
 	seat_node = calloc(1, sizeof(struct sway_seat_node));
@@ -329,12 +567,62 @@ static struct sway_seat_node *seat_node_from_node(
 	seat_node->node = node;
 	seat_node->seat = seat;
 	wl_list_insert(seat->focus_stack.prev, &seat_node->link);
+	wl_list_insert(&node->seat_nodes, &seat_node->node_link);
 	wl_signal_add(&node->events.destroy, &seat_node->destroy);
 	seat_node->destroy.notify = handle_seat_node_destroy;
 
+	seat_node->focus_seq = --seat->focus_seq_bottom;
+	seat_node->subtree_seq = seat_node->focus_seq;
+	seat_node->view_seq =
+		node_is_view(node) ? seat_node->focus_seq : FOCUS_SEQ_NONE;
+	seat_invalidate_focus_index(seat, node_get_parent(node));
+	seat_node->index_dirty = true;
+
 	return seat_node;
 }
 
+/**
+ * Move a seat node to the top of the focus stack. Being the most recent entry,
+ * it is now the most recent one of every subtree it belongs to, so the focus
+ * indexes of its ancestors can be updated directly.
+ */
+static void seat_node_raise(struct sway_seat_node *seat_node) {
+	struct sway_seat *seat = seat_node->seat;
+	wl_list_remove(&seat_node->link);
+	wl_list_insert(&seat->focus_stack, &seat_node->link);
+
+	int64_t seq = ++seat->focus_seq_top;
+	bool view = node_is_view(seat_node->node);
+	seat_node->focus_seq = seq;
+	seat_node->subtree_seq = seq;
+	if (view) {
+		seat_node->view_seq = seq;
+	}
+
+	struct sway_node *child = seat_node->node;
+	struct sway_node *parent = node_get_parent(child);
+	for (; node_has_focus_index(parent); parent = node_get_parent(parent)) {
+		struct sway_seat_node *index = seat_node_find(seat, parent);
+		if (index) {
+			if (parent->type == N_WORKSPACE &&
+					container_is_floating(child->sway_container)) {
+				index->inactive_floating = child;
+			} else {
+				index->inactive_child = child;
+				if (child == seat_node->node) {
+					index->active_child = child;
+				}
+			}
+			index->subtree_seq = seq;
+			if (view) {
+				index->view_seq = seq;
+				index->view_child = child;
+			}
+		}
+		child = parent;
+	}
+}
+
 static void handle_new_node(struct wl_listener *listener, void *data) {
 	struct sway_seat *seat = wl_container_of(listener, seat, new_node);
 	struct sway_node *node = data;
@@ -482,8 +770,7 @@ static void collect_focus_iter(struct sway_node *node, void *data) {
 	if (!seat_node) {
 		return;
 	}
-	wl_list_remove(&seat_node->link);
-	wl_list_insert(&seat->focus_stack, &seat_node->link);
+	seat_node_raise(seat_node);
 }
 
 static void collect_focus_workspace_iter(struct sway_workspace *workspace,
@@ -998,8 +1285,7 @@ static void set_workspace(struct sway_seat *seat,
 
 void seat_set_raw_focus(struct sway_seat *seat, struct sway_node *node) {
 	struct sway_seat_node *seat_node = seat_node_from_node(seat, node);
-	wl_list_remove(&seat_node->link);
-	wl_list_insert(&seat->focus_stack, &seat_node->link);
+	seat_node_raise(seat_node);
 	node_set_dirty(node);
 
 	// If focusing a scratchpad container that is fullscreen global, parent
@@ -1256,11 +1542,16 @@ struct sway_node *seat_get_focus_inactive(struct sway_seat *seat,
 	if (node_is_view(node)) {
 		return node;
 	}
-	struct sway_seat_node *current;
-	wl_list_for_each(current, &seat->focus_stack, link) {
-		if (node_has_ancestor(current->node, node)) {
-			return current->node;
-		}
+	struct sway_node *child = NULL;
+	if (node->type == N_ROOT || node->type == N_OUTPUT) {
+		child = get_recent_subtree(seat, node, false);
+	} else {
+		struct sway_seat_node *index = seat_node_get_index(seat, node);
+		child = index ? index_inactive_child(index) : NULL;
+	}
+	struct sway_node *focus = focus_index_descend(seat, child);
+	if (focus) {
+		return focus;
 	}
 	if (node->type == N_WORKSPACE) {
 		return node;
@@ -1273,16 +1564,10 @@ struct sway_container *seat_get_focus_inactive_tiling(struct sway_seat *seat,
 	if (!workspace->tiling->length) {
 		return NULL;
 	}
-	struct sway_seat_node *current;
-	wl_list_for_each(current, &seat->focus_stack, link) {
-		struct sway_node *node = current->node;
-		if (node->type == N_CONTAINER &&
-				!container_is_floating_or_child(node->sway_container) &&
-				node->sway_container->workspace == workspace) {
-			return node->sway_container;
-		}
-	}
-	return NULL;
+	struct sway_seat_node *index = seat_node_get_index(seat, &workspace->node);
+	struct sway_node *node =
+		focus_index_descend(seat, index ? index->inactive_child : NULL);
+	return node ? node->sway_container : NULL;
 }
 
 struct sway_container *seat_get_focus_inactive_floating(struct sway_seat *seat,
@@ -1290,16 +1575,10 @@ struct sway_container *seat_get_focus_inactive_floating(struct sway_seat *seat,
 	if (!workspace->floating->length) {
 		return NULL;
 	}
-	struct sway_seat_node *current;
-	wl_list_for_each(current, &seat->focus_stack, link) {
-		struct sway_node *node = current->node;
-		if (node->type == N_CONTAINER &&
-				container_is_floating_or_child(node->sway_container) &&
-				node->sway_container->workspace == workspace) {
-			return node->sway_container;
-		}
-	}
-	return NULL;
+	struct sway_seat_node *index = seat_node_get_index(seat, &workspace->node);
+	struct sway_node *node =
+		focus_index_descend(seat, index ? index->inactive_floating : NULL);
+	return node ? node->sway_container : NULL;
 }
 
 struct sway_node *seat_get_active_tiling_child(struct sway_seat *seat,
@@ -1307,22 +1586,25 @@ struct sway_node *seat_get_active_tiling_child(struct sway_seat *seat,
 	if (node_is_view(parent)) {
 		return parent;
 	}
-	struct sway_seat_node *current;
-	wl_list_for_each(current, &seat->focus_stack, link) {
-		struct sway_node *node = current->node;
-		if (node_get_parent(node) != parent) {
-			continue;
-		}
-		if (parent->type == N_WORKSPACE) {
-			// Only consider tiling children
-			struct sway_workspace *ws = parent->sway_workspace;
-			if (list_find(ws->tiling, node->sway_container) == -1) {
-				continue;
+	if (parent->type == N_ROOT) {
+		return NULL; // outputs are never in the focus stack
+	}
+	if (parent->type == N_OUTPUT) {
+		struct sway_output *output = parent->sway_output;
+		struct sway_node *active = NULL;
+		int64_t active_seq = FOCUS_SEQ_NONE;
+		for (int i = 0; i < output->workspaces->length; ++i) {
+			struct sway_workspace *ws = output->workspaces->items[i];
+			struct sway_seat_node *seat_node = seat_node_find(seat, &ws->node);
+			if (seat_node && seat_node->focus_seq > active_seq) {
+				active = &ws->node;
+				active_seq = seat_node->focus_seq;
 			}
 		}
-		return node;
+		return active;
 	}
-	return NULL;
+	struct sway_seat_node *index = seat_node_get_index(seat, parent);
+	return index ? index->active_child : NULL;
 }
 
 struct sway_node *seat_get_focus(struct sway_seat *seat) {
@@ -1384,6 +1666,12 @@ void seat_apply_config(struct sway_seat *seat,
 	seat->idle_inhibit_sources = seat_config->idle_inhibit_sources;
 	seat->idle_wake_sources = seat_config->idle_wake_sources;
 
+	seat->cursor->motion_batching =
+		seat_config->motion_batching == MOTION_BATCHING_ENABLE;
+	if (!seat->cursor->motion_batching) {
+		cursor_flush_motion(seat->cursor);
+	}
+
 	wl_list_for_each(seat_device, &seat->devices, link) {
 		seat_configure_device(seat, seat_device->input_device);
 		cursor_handle_activity(seat->cursor,
@@ -1,3 +1,4 @@
+#include "sway/commands.h"
 #include "sway/config.h"
 #include "sway/desktop/transaction.h"
 #include "sway/input/switch.h"
@@ -57,6 +58,9 @@ static void execute_binding(struct sway_switch *sway_switch) {
 		dummy_binding->type = BINDING_SWITCH;
 		dummy_binding->flags = matched_binding->flags;
 		dummy_binding->command = matched_binding->command;
+		// The dummy borrows the compiled program of the binding
+		dummy_binding->program = command_program_cache(
+				&matched_binding->program, matched_binding->command);
 
 		seat_execute_command(seat, dummy_binding);
 		free(dummy_binding);
@@ -1,6 +1,10 @@
+#define _POSIX_C_SOURCE 200809L
 #include <json.h>
 #include <libevdev/libevdev.h>
+#include <inttypes.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <ctype.h>
 #include "config.h"
 #include "log.h"
@@ -10,6 +14,7 @@
 #include "sway/tree/view.h"
 #include "sway/tree/workspace.h"
 #include "sway/output.h"
+#include "sway/startup_profile.h"
 #include "sway/input/input-manager.h"
 #include "sway/input/cursor.h"
 #include "sway/input/seat.h"
@@ -23,6 +28,124 @@
 static const int i3_output_id = INT32_MAX;
 static const int i3_scratch_id = INT32_MAX - 1;
 
+/**
+ * Node properties which GET_TREE queries can select. Properties which are not
+ * selected are not computed.
+ */
+enum ipc_json_node_field {
+	IPC_FIELD_ID,
+	IPC_FIELD_NAME,
+	IPC_FIELD_TYPE,
+	IPC_FIELD_RECT,
+	IPC_FIELD_FOCUSED,
+	IPC_FIELD_FOCUS,
+	IPC_FIELD_BORDER,
+	IPC_FIELD_CURRENT_BORDER_WIDTH,
+	IPC_FIELD_LAYOUT,
+	IPC_FIELD_ORIENTATION,
+	IPC_FIELD_PERCENT,
+	IPC_FIELD_WINDOW_RECT,
+	IPC_FIELD_DECO_RECT,
+	IPC_FIELD_GEOMETRY,
+	IPC_FIELD_WINDOW,
+	IPC_FIELD_URGENT,
+	IPC_FIELD_MARKS,
+	IPC_FIELD_FULLSCREEN_MODE,
+	IPC_FIELD_NODES,
+	IPC_FIELD_FLOATING_NODES,
+	IPC_FIELD_STICKY,
+	// outputs
+	IPC_FIELD_ACTIVE,
+	IPC_FIELD_DPMS,
+	IPC_FIELD_PRIMARY,
+	IPC_FIELD_MAKE,
+	IPC_FIELD_MODEL,
+	IPC_FIELD_SERIAL,
+	IPC_FIELD_SCALE,
+	IPC_FIELD_SCALE_FILTER,
+	IPC_FIELD_TRANSFORM,
+	IPC_FIELD_ADAPTIVE_SYNC_STATUS,
+	IPC_FIELD_CURRENT_WORKSPACE,
+	IPC_FIELD_MODES,
+	IPC_FIELD_CURRENT_MODE,
+	IPC_FIELD_MAX_RENDER_TIME,
+	// workspaces
+	IPC_FIELD_NUM,
+	IPC_FIELD_OUTPUT,
+	IPC_FIELD_REPRESENTATION,
+	// views
+	IPC_FIELD_PID,
+	IPC_FIELD_APP_ID,
+	IPC_FIELD_SHELL,
+	IPC_FIELD_WINDOW_PROPERTIES,
+	IPC_FIELD_VISIBLE,
+	IPC_FIELD_INHIBIT_IDLE,
+	IPC_FIELD_IDLE_INHIBITORS,
+	IPC_FIELD_COUNT,
+};
+
+static const char *node_field_names[IPC_FIELD_COUNT] = {
+	[IPC_FIELD_ID] = "id",
+	[IPC_FIELD_NAME] = "name",
+	[IPC_FIELD_TYPE] = "type",
+	[IPC_FIELD_RECT] = "rect",
+	[IPC_FIELD_FOCUSED] = "focused",
+	[IPC_FIELD_FOCUS] = "focus",
+	[IPC_FIELD_BORDER] = "border",
+	[IPC_FIELD_CURRENT_BORDER_WIDTH] = "current_border_width",
+	[IPC_FIELD_LAYOUT] = "layout",
+	[IPC_FIELD_ORIENTATION] = "orientation",
+	[IPC_FIELD_PERCENT] = "percent",
+	[IPC_FIELD_WINDOW_RECT] = "window_rect",
+	[IPC_FIELD_DECO_RECT] = "deco_rect",
+	[IPC_FIELD_GEOMETRY] = "geometry",
+	[IPC_FIELD_WINDOW] = "window",
+	[IPC_FIELD_URGENT] = "urgent",
+	[IPC_FIELD_MARKS] = "marks",
+	[IPC_FIELD_FULLSCREEN_MODE] = "fullscreen_mode",
+	[IPC_FIELD_NODES] = "nodes",
+	[IPC_FIELD_FLOATING_NODES] = "floating_nodes",
+	[IPC_FIELD_STICKY] = "sticky",
+	[IPC_FIELD_ACTIVE] = "active",
+	[IPC_FIELD_DPMS] = "dpms",
+	[IPC_FIELD_PRIMARY] = "primary",
+	[IPC_FIELD_MAKE] = "make",
+	[IPC_FIELD_MODEL] = "model",
+	[IPC_FIELD_SERIAL] = "serial",
+	[IPC_FIELD_SCALE] = "scale",
+	[IPC_FIELD_SCALE_FILTER] = "scale_filter",
+	[IPC_FIELD_TRANSFORM] = "transform",
+	[IPC_FIELD_ADAPTIVE_SYNC_STATUS] = "adaptive_sync_status",
+	[IPC_FIELD_CURRENT_WORKSPACE] = "current_workspace",
+	[IPC_FIELD_MODES] = "modes",
+	[IPC_FIELD_CURRENT_MODE] = "current_mode",
+	[IPC_FIELD_MAX_RENDER_TIME] = "max_render_time",
+	[IPC_FIELD_NUM] = "num",
+	[IPC_FIELD_OUTPUT] = "output",
+	[IPC_FIELD_REPRESENTATION] = "representation",
+	[IPC_FIELD_PID] = "pid",
+	[IPC_FIELD_APP_ID] = "app_id",
+	[IPC_FIELD_SHELL] = "shell",
+	[IPC_FIELD_WINDOW_PROPERTIES] = "window_properties",
+	[IPC_FIELD_VISIBLE] = "visible",
+	[IPC_FIELD_INHIBIT_IDLE] = "inhibit_idle",
+	[IPC_FIELD_IDLE_INHIBITORS] = "idle_inhibitors",
+};
+
+static bool wants(uint64_t fields, enum ipc_json_node_field field) {
+	return fields & ((uint64_t)1 << field);
+}
+
+bool ipc_json_node_field_mask(const char *name, uint64_t *mask) {
+	for (size_t i = 0; i < IPC_FIELD_COUNT; ++i) {
+		if (strcmp(name, node_field_names[i]) == 0) {
+			*mask |= (uint64_t)1 << i;
+			return true;
+		}
+	}
+	return false;
+}
+
 static const char *ipc_json_layout_description(enum sway_container_layout l) {
 	switch (l) {
 	case L_VERT:
@@ -189,125 +312,224 @@ static json_object *ipc_json_create_empty_rect(void) {
 	return ipc_json_create_rect(&empty);
 }
 
+/**
+ * Create a node's description with its common properties. The focus array is
+ * consumed, and may be NULL if it isn't wanted.
+ */
 static json_object *ipc_json_create_node(int id, char *name,
-		bool focused, json_object *focus, struct wlr_box *box) {
+		bool focused, json_object *focus, struct wlr_box *box,
+		uint64_t fields) {
 	json_object *object = json_object_new_object();
 
-	json_object_object_add(object, "id", json_object_new_int(id));
-	json_object_object_add(object, "name",
-			name ? json_object_new_string(name) : NULL);
-	json_object_object_add(object, "rect", ipc_json_create_rect(box));
-	json_object_object_add(object, "focused", json_object_new_boolean(focused));
-	json_object_object_add(object, "focus", focus);
+	if (wants(fields, IPC_FIELD_ID)) {
+		json_object_object_add(object, "id", json_object_new_int(id));
+	}
+	if (wants(fields, IPC_FIELD_NAME)) {
+		json_object_object_add(object, "name",
+				name ? json_object_new_string(name) : NULL);
+	}
+	if (wants(fields, IPC_FIELD_RECT)) {
+		json_object_object_add(object, "rect", ipc_json_create_rect(box));
+	}
+	if (wants(fields, IPC_FIELD_FOCUSED)) {
+		json_object_object_add(object, "focused",
+				json_object_new_boolean(focused));
+	}
+	if (wants(fields, IPC_FIELD_FOCUS)) {
+		json_object_object_add(object, "focus", focus);
+	} else {
+		json_object_put(focus);
+	}
 
 	// set default values to be compatible with i3
-	json_object_object_add(object, "border",
-			json_object_new_string(
-				ipc_json_border_description(B_NONE)));
-	json_object_object_add(object, "current_border_width",
-			json_object_new_int(0));
-	json_object_object_add(object, "layout",
-			json_object_new_string(
-				ipc_json_layout_description(L_HORIZ)));
-	json_object_object_add(object, "orientation",
-			json_object_new_string(
-				ipc_json_orientation_description(L_HORIZ)));
-	json_object_object_add(object, "percent", NULL);
-	json_object_object_add(object, "window_rect", ipc_json_create_empty_rect());
-	json_object_object_add(object, "deco_rect", ipc_json_create_empty_rect());
-	json_object_object_add(object, "geometry", ipc_json_create_empty_rect());
-	json_object_object_add(object, "window", NULL);
-	json_object_object_add(object, "urgent", json_object_new_boolean(false));
-	json_object_object_add(object, "marks", json_object_new_array());
-	json_object_object_add(object, "fullscreen_mode", json_object_new_int(0));
-	json_object_object_add(object, "nodes", json_object_new_array());
-	json_object_object_add(object, "floating_nodes", json_object_new_array());
-	json_object_object_add(object, "sticky", json_object_new_boolean(false));
+	if (wants(fields, IPC_FIELD_BORDER)) {
+		json_object_object_add(object, "border",
+				json_object_new_string(
+					ipc_json_border_description(B_NONE)));
+	}
+	if (wants(fields, IPC_FIELD_CURRENT_BORDER_WIDTH)) {
+		json_object_object_add(object, "current_border_width",
+				json_object_new_int(0));
+	}
+	if (wants(fields, IPC_FIELD_LAYOUT)) {
+		json_object_object_add(object, "layout",
+				json_object_new_string(
+					ipc_json_layout_description(L_HORIZ)));
+	}
+	if (wants(fields, IPC_FIELD_ORIENTATION)) {
+		json_object_object_add(object, "orientation",
+				json_object_new_string(
+					ipc_json_orientation_description(L_HORIZ)));
+	}
+	if (wants(fields, IPC_FIELD_PERCENT)) {
+		json_object_object_add(object, "percent", NULL);
+	}
+	if (wants(fields, IPC_FIELD_WINDOW_RECT)) {
+		json_object_object_add(object, "window_rect",
+				ipc_json_create_empty_rect());
+	}
+	if (wants(fields, IPC_FIELD_DECO_RECT)) {
+		json_object_object_add(object, "deco_rect",
+				ipc_json_create_empty_rect());
+	}
+	if (wants(fields, IPC_FIELD_GEOMETRY)) {
+		json_object_object_add(object, "geometry",
+				ipc_json_create_empty_rect());
+	}
+	if (wants(fields, IPC_FIELD_WINDOW)) {
+		json_object_object_add(object, "window", NULL);
+	}
+	if (wants(fields, IPC_FIELD_URGENT)) {
+		json_object_object_add(object, "urgent",
+				json_object_new_boolean(false));
+	}
+	if (wants(fields, IPC_FIELD_MARKS)) {
+		json_object_object_add(object, "marks", json_object_new_array());
+	}
+	if (wants(fields, IPC_FIELD_FULLSCREEN_MODE)) {
+		json_object_object_add(object, "fullscreen_mode",
+				json_object_new_int(0));
+	}
+	if (wants(fields, IPC_FIELD_NODES)) {
+		json_object_object_add(object, "nodes", json_object_new_array());
+	}
+	if (wants(fields, IPC_FIELD_FLOATING_NODES)) {
+		json_object_object_add(object, "floating_nodes",
+				json_object_new_array());
+	}
+	if (wants(fields, IPC_FIELD_STICKY)) {
+		json_object_object_add(object, "sticky",
+				json_object_new_boolean(false));
+	}
 
 	return object;
 }
 
-static void ipc_json_describe_root(struct sway_root *root, json_object *object) {
-	json_object_object_add(object, "type", json_object_new_string("root"));
+static void ipc_json_describe_root(struct sway_root *root, json_object *object,
+		uint64_t fields) {
+	if (wants(fields, IPC_FIELD_TYPE)) {
+		json_object_object_add(object, "type", json_object_new_string("root"));
+	}
 }
 
 static void ipc_json_describe_output(struct sway_output *output,
-		json_object *object) {
+		json_object *object, uint64_t fields) {
 	struct wlr_output *wlr_output = output->wlr_output;
-	json_object_object_add(object, "type", json_object_new_string("output"));
-	json_object_object_add(object, "active", json_object_new_boolean(true));
-	json_object_object_add(object, "dpms",
-			json_object_new_boolean(wlr_output->enabled));
-	json_object_object_add(object, "primary", json_object_new_boolean(false));
-	json_object_object_add(object, "layout", json_object_new_string("output"));
-	json_object_object_add(object, "orientation",
+	if (wants(fields, IPC_FIELD_TYPE)) {
+		json_object_object_add(object, "type",
+				json_object_new_string("output"));
+	}
+	if (wants(fields, IPC_FIELD_ACTIVE)) {
+		json_object_object_add(object, "active", json_object_new_boolean(true));
+	}
+	if (wants(fields, IPC_FIELD_DPMS)) {
+		json_object_object_add(object, "dpms",
+				json_object_new_boolean(wlr_output->enabled));
+	}
+	if (wants(fields, IPC_FIELD_PRIMARY)) {
+		json_object_object_add(object, "primary",
+				json_object_new_boolean(false));
+	}
+	if (wants(fields, IPC_FIELD_LAYOUT)) {
+		json_object_object_add(object, "layout",
+				json_object_new_string("output"));
+	}
+	if (wants(fields, IPC_FIELD_ORIENTATION)) {
+		json_object_object_add(object, "orientation",
+				json_object_new_string(
+					ipc_json_orientation_description(L_NONE)));
+	}
+	if (wants(fields, IPC_FIELD_MAKE)) {
+		json_object_object_add(object, "make",
+				json_object_new_string(wlr_output->make));
+	}
+	if (wants(fields, IPC_FIELD_MODEL)) {
+		json_object_object_add(object, "model",
+				json_object_new_string(wlr_output->model));
+	}
+	if (wants(fields, IPC_FIELD_SERIAL)) {
+		json_object_object_add(object, "serial",
+				json_object_new_string(wlr_output->serial));
+	}
+	if (wants(fields, IPC_FIELD_SCALE)) {
+		json_object_object_add(object, "scale",
+				json_object_new_double(wlr_output->scale));
+	}
+	if (wants(fields, IPC_FIELD_SCALE_FILTER)) {
+		json_object_object_add(object, "scale_filter",
 			json_object_new_string(
-				ipc_json_orientation_description(L_NONE)));
-	json_object_object_add(object, "make",
-			json_object_new_string(wlr_output->make));
-	json_object_object_add(object, "model",
-			json_object_new_string(wlr_output->model));
-	json_object_object_add(object, "serial",
-			json_object_new_string(wlr_output->serial));
-	json_object_object_add(object, "scale",
-			json_object_new_double(wlr_output->scale));
-	json_object_object_add(object, "scale_filter",
-		json_object_new_string(
-			sway_output_scale_filter_to_string(output->scale_filter)));
-	json_object_object_add(object, "transform",
-		json_object_new_string(
-			ipc_json_output_transform_description(wlr_output->transform)));
-	const char *adaptive_sync_status =
-		ipc_json_output_adaptive_sync_status_description(
-			wlr_output->adaptive_sync_status);
-	json_object_object_add(object, "adaptive_sync_status",
-		json_object_new_string(adaptive_sync_status));
+				sway_output_scale_filter_to_string(output->scale_filter)));
+	}
+	if (wants(fields, IPC_FIELD_TRANSFORM)) {
+		json_object_object_add(object, "transform",
+			json_object_new_string(
+				ipc_json_output_transform_description(wlr_output->transform)));
+	}
+	if (wants(fields, IPC_FIELD_ADAPTIVE_SYNC_STATUS)) {
+		const char *adaptive_sync_status =
+			ipc_json_output_adaptive_sync_status_description(
+				wlr_output->adaptive_sync_status);
+		json_object_object_add(object, "adaptive_sync_status",
+			json_object_new_string(adaptive_sync_status));
+	}
 
 	struct sway_workspace *ws = output_get_active_workspace(output);
 	if (!sway_assert(ws, "Expected output to have a workspace")) {
 		return;
 	}
-	json_object_object_add(object, "current_workspace",
-			json_object_new_string(ws->name));
+	if (wants(fields, IPC_FIELD_CURRENT_WORKSPACE)) {
+		json_object_object_add(object, "current_workspace",
+				json_object_new_string(ws->name));
+	}
 
-	json_object *modes_array = json_object_new_array();
-	struct wlr_output_mode *mode;
-	wl_list_for_each(mode, &wlr_output->modes, link) {
-		json_object *mode_object = json_object_new_object();
-		json_object_object_add(mode_object, "width",
-			json_object_new_int(mode->width));
-		json_object_object_add(mode_object, "height",
-			json_object_new_int(mode->height));
-		json_object_object_add(mode_object, "refresh",
-			json_object_new_int(mode->refresh));
-		json_object_array_add(modes_array, mode_object);
+	if (wants(fields, IPC_FIELD_MODES)) {
+		json_object *modes_array = json_object_new_array();
+		struct wlr_output_mode *mode;
+		wl_list_for_each(mode, &wlr_output->modes, link) {
+			json_object *mode_object = json_object_new_object();
+			json_object_object_add(mode_object, "width",
+				json_object_new_int(mode->width));
+			json_object_object_add(mode_object, "height",
+				json_object_new_int(mode->height));
+			json_object_object_add(mode_object, "refresh",
+				json_object_new_int(mode->refresh));
+			json_object_array_add(modes_array, mode_object);
+		}
+
+		json_object_object_add(object, "modes", modes_array);
 	}
 
-	json_object_object_add(object, "modes", modes_array);
+	if (wants(fields, IPC_FIELD_CURRENT_MODE)) {
+		json_object *current_mode_object = json_object_new_object();
+		json_object_object_add(current_mode_object, "width",
+			json_object_new_int(wlr_output->width));
+		json_object_object_add(current_mode_object, "height",
+			json_object_new_int(wlr_output->height));
+		json_object_object_add(current_mode_object, "refresh",
+			json_object_new_int(wlr_output->refresh));
+		json_object_object_add(object, "current_mode", current_mode_object);
+	}
 
-	json_object *current_mode_object = json_object_new_object();
-	json_object_object_add(current_mode_object, "width",
-		json_object_new_int(wlr_output->width));
-	json_object_object_add(current_mode_object, "height",
-		json_object_new_int(wlr_output->height));
-	json_object_object_add(current_mode_object, "refresh",
-		json_object_new_int(wlr_output->refresh));
-	json_object_object_add(object, "current_mode", current_mode_object);
+	if (wants(fields, IPC_FIELD_PERCENT)) {
+		struct sway_node *parent = node_get_parent(&output->node);
+		struct wlr_box parent_box = {0, 0, 0, 0};
 
-	struct sway_node *parent = node_get_parent(&output->node);
-	struct wlr_box parent_box = {0, 0, 0, 0};
+		if (parent != NULL) {
+			node_get_box(parent, &parent_box);
+		}
 
-	if (parent != NULL) {
-		node_get_box(parent, &parent_box);
+		if (parent_box.width != 0 && parent_box.height != 0) {
+			double percent = ((double)output->width / parent_box.width)
+					* ((double)output->height / parent_box.height);
+			json_object_object_add(object, "percent",
+					json_object_new_double(percent));
+		}
 	}
 
-	if (parent_box.width != 0 && parent_box.height != 0) {
-		double percent = ((double)output->width / parent_box.width)
-				* ((double)output->height / parent_box.height);
-		json_object_object_add(object, "percent", json_object_new_double(percent));
+	if (wants(fields, IPC_FIELD_MAX_RENDER_TIME)) {
+		json_object_object_add(object, "max_render_time",
+				json_object_new_int(output->max_render_time));
 	}
-
-	json_object_object_add(object, "max_render_time", json_object_new_int(output->max_render_time));
 }
 
 json_object *ipc_json_describe_disabled_output(struct sway_output *output) {
@@ -357,7 +579,97 @@ json_object *ipc_json_describe_disabled_output(struct sway_output *output) {
 	return object;
 }
 
-static json_object *ipc_json_describe_scratchpad_output(void) {
+static json_object *ipc_json_describe_frame_timing_stats(
+		struct sway_frame_timing_stats *stats, bool histogram) {
+	json_object *object = json_object_new_object();
+	json_object_object_add(object, "samples",
+			json_object_new_int(stats->samples));
+	json_object_object_add(object, "min", json_object_new_int64(stats->min));
+	json_object_object_add(object, "max", json_object_new_int64(stats->max));
+	json_object_object_add(object, "mean", json_object_new_int64(stats->mean));
+	json_object_object_add(object, "p50", json_object_new_int64(stats->p50));
+	json_object_object_add(object, "p90", json_object_new_int64(stats->p90));
+	json_object_object_add(object, "p99", json_object_new_int64(stats->p99));
+	if (histogram) {
+		json_object *buckets = json_object_new_array();
+		for (size_t i = 0; i < FRAME_TIMING_HISTOGRAM_BUCKETS; ++i) {
+			json_object_array_add(buckets,
+					json_object_new_int(stats->histogram[i]));
+		}
+		json_object_object_add(object, "histogram", buckets);
+	}
+	return object;
+}
+
+json_object *ipc_json_describe_frame_timings(struct sway_output *output) {
+	struct sway_frame_timings *timings = &output->frame_timings;
+
+	json_object *object = json_object_new_object();
+	json_object_object_add(object, "name",
+			json_object_new_string(output->wlr_output->name));
+	json_object_object_add(object, "max_render_time",
+			json_object_new_int(output->max_render_time));
+	json_object_object_add(object, "refresh",
+			json_object_new_int(output->wlr_output->refresh));
+	json_object_object_add(object, "frames",
+			json_object_new_int(timings->count));
+
+	json_object *bounds = json_object_new_array();
+	for (size_t i = 0; i < FRAME_TIMING_HISTOGRAM_BUCKETS; ++i) {
+		int64_t bound = frame_timing_histogram_bounds_usec[i];
+		json_object_array_add(bounds,
+				bound < 0 ? NULL : json_object_new_int64(bound));
+	}
+	json_object_object_add(object, "histogram_bounds", bounds);
+
+	struct sway_frame_timing_stats stats;
+	json_object *phases = json_object_new_object();
+	for (int i = 0; i <= FRAME_PHASE_COUNT; ++i) {
+		frame_timing_get_phase_stats(timings, i, &stats);
+		json_object_object_add(phases, frame_timing_phase_name(i),
+				ipc_json_describe_frame_timing_stats(&stats, true));
+	}
+	json_object_object_add(object, "phases", phases);
+
+	frame_timing_get_refresh_stats(timings, &stats);
+	json_object_object_add(object, "msec_until_refresh",
+			ipc_json_describe_frame_timing_stats(&stats, false));
+
+	frame_timing_get_transaction_stats(timings, &stats);
+	json_object_object_add(object, "transactions",
+			ipc_json_describe_frame_timing_stats(&stats, true));
+
+	return object;
+}
+
+json_object *ipc_json_get_startup_profile(void) {
+	json_object *object = json_object_new_object();
+	json_object_object_add(object, "complete",
+			json_object_new_boolean(startup_profile_complete()));
+
+	int64_t total = 0;
+	json_object *phases = json_object_new_array();
+	for (int i = 0; i < STARTUP_PHASE_COUNT; ++i) {
+		int64_t usec = startup_phase_duration_usec(i);
+		json_object *phase = json_object_new_object();
+		json_object_object_add(phase, "name",
+				json_object_new_string(startup_phase_name(i)));
+		json_object_object_add(phase, "duration",
+				usec < 0 ? NULL : json_object_new_int64(usec));
+		json_object_array_add(phases, phase);
+		total += usec < 0 ? 0 : usec;
+	}
+	json_object_object_add(object, "phases", phases);
+	json_object_object_add(object, "total", json_object_new_int64(total));
+
+	return object;
+}
+
+static json_object *describe_node_recursive(struct sway_node *node,
+		uint64_t fields);
+
+static json_object *ipc_json_describe_scratchpad_output(bool recursive,
+		uint64_t fields) {
 	struct wlr_box box;
 	root_get_box(root, &box);
 
@@ -370,78 +682,116 @@ static json_object *ipc_json_describe_scratchpad_output(void) {
 	}
 
 	json_object *workspace = ipc_json_create_node(i3_scratch_id,
-				"__i3_scratch", false, workspace_focus, &box);
-	json_object_object_add(workspace, "fullscreen_mode", json_object_new_int(1));
-	json_object_object_add(workspace, "type",
-			json_object_new_string("workspace"));
+				"__i3_scratch", false, workspace_focus, &box, fields);
+	if (wants(fields, IPC_FIELD_FULLSCREEN_MODE)) {
+		json_object_object_add(workspace, "fullscreen_mode",
+				json_object_new_int(1));
+	}
+	if (wants(fields, IPC_FIELD_TYPE)) {
+		json_object_object_add(workspace, "type",
+				json_object_new_string("workspace"));
+	}
 
 	// List all hidden scratchpad containers as floating nodes
-	json_object *floating_array = json_object_new_array();
-	for (int i = 0; i < root->scratchpad->length; ++i) {
-		struct sway_container *container = root->scratchpad->items[i];
-		if (container_is_scratchpad_hidden(container)) {
-			json_object_array_add(floating_array,
-				ipc_json_describe_node_recursive(&container->node));
+	if (wants(fields, IPC_FIELD_FLOATING_NODES)) {
+		json_object *floating_array = json_object_new_array();
+		for (int i = 0; i < root->scratchpad->length; ++i) {
+			struct sway_container *container = root->scratchpad->items[i];
+			if (container_is_scratchpad_hidden(container)) {
+				json_object_array_add(floating_array, recursive ?
+					describe_node_recursive(&container->node, fields) :
+					json_object_new_int(container->node.id));
+			}
 		}
+		json_object_object_add(workspace, "floating_nodes", floating_array);
 	}
-	json_object_object_add(workspace, "floating_nodes", floating_array);
 
 	// Create focus stack for __i3 output
 	json_object *output_focus = json_object_new_array();
 	json_object_array_add(output_focus, json_object_new_int(i3_scratch_id));
 
 	json_object *output = ipc_json_create_node(i3_output_id,
-					"__i3", false, output_focus, &box);
-	json_object_object_add(output, "type",
-			json_object_new_string("output"));
-	json_object_object_add(output, "layout",
-			json_object_new_string("output"));
+					"__i3", false, output_focus, &box, fields);
+	if (wants(fields, IPC_FIELD_TYPE)) {
+		json_object_object_add(output, "type",
+				json_object_new_string("output"));
+	}
+	if (wants(fields, IPC_FIELD_LAYOUT)) {
+		json_object_object_add(output, "layout",
+				json_object_new_string("output"));
+	}
 
-	json_object *nodes = json_object_new_array();
-	json_object_array_add(nodes, workspace);
-	json_object_object_add(output, "nodes", nodes);
+	if (wants(fields, IPC_FIELD_NODES)) {
+		json_object *nodes = json_object_new_array();
+		json_object_array_add(nodes, workspace);
+		json_object_object_add(output, "nodes", nodes);
+	} else {
+		json_object_put(workspace);
+	}
 
 	return output;
 }
 
 static void ipc_json_describe_workspace(struct sway_workspace *workspace,
-		json_object *object) {
-	int num;
-	if (isdigit(workspace->name[0])) {
-		errno = 0;
-		char *endptr = NULL;
-		long long parsed_num = strtoll(workspace->name, &endptr, 10);
-		if (errno != 0 || parsed_num > INT32_MAX || parsed_num < 0 || endptr == workspace->name) {
-			num = -1;
+		json_object *object, uint64_t fields) {
+	if (wants(fields, IPC_FIELD_NUM)) {
+		int num;
+		if (isdigit(workspace->name[0])) {
+			errno = 0;
+			char *endptr = NULL;
+			long long parsed_num = strtoll(workspace->name, &endptr, 10);
+			if (errno != 0 || parsed_num > INT32_MAX || parsed_num < 0 || endptr == workspace->name) {
+				num = -1;
+			} else {
+				num = (int) parsed_num;
+			}
 		} else {
-			num = (int) parsed_num;
+			num = -1;
 		}
-	} else {
-		num = -1;
-	}
-	json_object_object_add(object, "num", json_object_new_int(num));
-	json_object_object_add(object, "fullscreen_mode", json_object_new_int(1));
-	json_object_object_add(object, "output", workspace->output ?
-			json_object_new_string(workspace->output->wlr_output->name) : NULL);
-	json_object_object_add(object, "type", json_object_new_string("workspace"));
-	json_object_object_add(object, "urgent",
-			json_object_new_boolean(workspace->urgent));
-	json_object_object_add(object, "representation", workspace->representation ?
-			json_object_new_string(workspace->representation) : NULL);
-
-	json_object_object_add(object, "layout",
-			json_object_new_string(
-				ipc_json_layout_description(workspace->layout)));
-	json_object_object_add(object, "orientation",
-			json_object_new_string(
-				ipc_json_orientation_description(workspace->layout)));
+		json_object_object_add(object, "num", json_object_new_int(num));
+	}
+	if (wants(fields, IPC_FIELD_FULLSCREEN_MODE)) {
+		json_object_object_add(object, "fullscreen_mode",
+				json_object_new_int(1));
+	}
+	if (wants(fields, IPC_FIELD_OUTPUT)) {
+		json_object_object_add(object, "output", workspace->output ?
+				json_object_new_string(workspace->output->wlr_output->name) : NULL);
+	}
+	if (wants(fields, IPC_FIELD_TYPE)) {
+		json_object_object_add(object, "type",
+				json_object_new_string("workspace"));
+	}
+	if (wants(fields, IPC_FIELD_URGENT)) {
+		json_object_object_add(object, "urgent",
+				json_object_new_boolean(workspace->urgent));
+	}
+	if (wants(fields, IPC_FIELD_REPRESENTATION)) {
+		json_object_object_add(object, "representation",
+				workspace->representation ?
+				json_object_new_string(workspace->representation) : NULL);
+	}
 
-	// Floating
+	if (wants(fields, IPC_FIELD_LAYOUT)) {
+		json_object_object_add(object, "layout",
+				json_object_new_string(
+					ipc_json_layout_description(workspace->layout)));
+	}
+	if (wants(fields, IPC_FIELD_ORIENTATION)) {
+		json_object_object_add(object, "orientation",
+				json_object_new_string(
+					ipc_json_orientation_description(workspace->layout)));
+	}
+}
+
+static void ipc_json_describe_workspace_floating(
+		struct sway_workspace *workspace, json_object *object,
+		uint64_t fields) {
 	json_object *floating_array = json_object_new_array();
 	for (int i = 0; i < workspace->floating->length; ++i) {
 		struct sway_container *floater = workspace->floating->items[i];
 		json_object_array_add(floating_array,
-				ipc_json_describe_node_recursive(&floater->node));
+				describe_node_recursive(&floater->node, fields));
 	}
 	json_object_object_add(object, "floating_nodes", floating_array);
 }
@@ -483,66 +833,51 @@ static void get_deco_rect(struct sway_container *c, struct wlr_box *deco_rect) {
 	}
 }
 
-static void ipc_json_describe_view(struct sway_container *c, json_object *object) {
-	json_object_object_add(object, "pid", json_object_new_int(c->view->pid));
-
-	const char *app_id = view_get_app_id(c->view);
-	json_object_object_add(object, "app_id",
-			app_id ? json_object_new_string(app_id) : NULL);
-
-	bool visible = view_is_visible(c->view);
-	json_object_object_add(object, "visible", json_object_new_boolean(visible));
-
-	struct wlr_box window_box = {
-		c->content_x - c->x,
-		(c->current.border == B_PIXEL) ? c->current.border_thickness : 0,
-		c->content_width,
-		c->content_height
-	};
-
-	json_object_object_add(object, "window_rect", ipc_json_create_rect(&window_box));
-
-	struct wlr_box geometry = {0, 0, c->view->natural_width, c->view->natural_height};
-	json_object_object_add(object, "geometry", ipc_json_create_rect(&geometry));
-
-	json_object_object_add(object, "max_render_time", json_object_new_int(c->view->max_render_time));
-
-	json_object_object_add(object, "shell", json_object_new_string(view_get_shell(c->view)));
-
-	json_object_object_add(object, "inhibit_idle",
-		json_object_new_boolean(view_inhibit_idle(c->view)));
+static void ipc_json_describe_view(struct sway_container *c, json_object *object,
+		uint64_t fields) {
+	if (wants(fields, IPC_FIELD_PID)) {
+		json_object_object_add(object, "pid", json_object_new_int(c->view->pid));
+	}
 
-	json_object *idle_inhibitors = json_object_new_object();
+	if (wants(fields, IPC_FIELD_APP_ID)) {
+		const char *app_id = view_get_app_id(c->view);
+		json_object_object_add(object, "app_id",
+				app_id ? json_object_new_string(app_id) : NULL);
+	}
 
-	struct sway_idle_inhibitor_v1 *user_inhibitor =
-		sway_idle_inhibit_v1_user_inhibitor_for_view(c->view);
+	if (wants(fields, IPC_FIELD_WINDOW_RECT)) {
+		struct wlr_box window_box = {
+			c->content_x - c->x,
+			(c->current.border == B_PIXEL) ? c->current.border_thickness : 0,
+			c->content_width,
+			c->content_height
+		};
 
-	if (user_inhibitor) {
-		json_object_object_add(idle_inhibitors, "user",
-			json_object_new_string(
-				ipc_json_user_idle_inhibitor_description(user_inhibitor->mode)));
-	} else {
-		json_object_object_add(idle_inhibitors, "user",
-			json_object_new_string("none"));
+		json_object_object_add(object, "window_rect", ipc_json_create_rect(&window_box));
 	}
 
-	struct sway_idle_inhibitor_v1 *application_inhibitor =
-		sway_idle_inhibit_v1_application_inhibitor_for_view(c->view);
+	if (wants(fields, IPC_FIELD_GEOMETRY)) {
+		struct wlr_box geometry = {0, 0, c->view->natural_width, c->view->natural_height};
+		json_object_object_add(object, "geometry", ipc_json_create_rect(&geometry));
+	}
 
-	if (application_inhibitor) {
-		json_object_object_add(idle_inhibitors, "application",
-			json_object_new_string("enabled"));
-	} else {
-		json_object_object_add(idle_inhibitors, "application",
-			json_object_new_string("none"));
+	if (wants(fields, IPC_FIELD_MAX_RENDER_TIME)) {
+		json_object_object_add(object, "max_render_time", json_object_new_int(c->view->max_render_time));
 	}
 
-	json_object_object_add(object, "idle_inhibitors", idle_inhibitors);
+	if (wants(fields, IPC_FIELD_SHELL)) {
+		json_object_object_add(object, "shell", json_object_new_string(view_get_shell(c->view)));
+	}
 
 #if HAVE_XWAYLAND
 	if (c->view->type == SWAY_VIEW_XWAYLAND) {
-		json_object_object_add(object, "window",
-				json_object_new_int(view_get_x11_window_id(c->view)));
+		if (wants(fields, IPC_FIELD_WINDOW)) {
+			json_object_object_add(object, "window",
+					json_object_new_int(view_get_x11_window_id(c->view)));
+		}
+		if (!wants(fields, IPC_FIELD_WINDOW_PROPERTIES)) {
+			return;
+		}
 
 		json_object *window_props = json_object_new_object();
 
@@ -580,62 +915,144 @@ static void ipc_json_describe_view(struct sway_container *c, json_object *object
 #endif
 }
 
-static void ipc_json_describe_container(struct sway_container *c, json_object *object) {
-	json_object_object_add(object, "name",
-			c->title ? json_object_new_string(c->title) : NULL);
-	json_object_object_add(object, "type",
-			json_object_new_string(container_is_floating(c) ? "floating_con" : "con"));
+/**
+ * Properties of a view which can change without the view being marked dirty,
+ * and so are never cached.
+ */
+static void ipc_json_describe_view_dynamic(struct sway_container *c,
+		json_object *object, uint64_t fields) {
+	if (wants(fields, IPC_FIELD_VISIBLE)) {
+		bool visible = view_is_visible(c->view);
+		json_object_object_add(object, "visible",
+				json_object_new_boolean(visible));
+	}
 
-	json_object_object_add(object, "layout",
-			json_object_new_string(
-				ipc_json_layout_description(c->layout)));
+	if (wants(fields, IPC_FIELD_INHIBIT_IDLE)) {
+		json_object_object_add(object, "inhibit_idle",
+			json_object_new_boolean(view_inhibit_idle(c->view)));
+	}
 
-	json_object_object_add(object, "orientation",
+	if (!wants(fields, IPC_FIELD_IDLE_INHIBITORS)) {
+		return;
+	}
+
+	json_object *idle_inhibitors = json_object_new_object();
+
+	struct sway_idle_inhibitor_v1 *user_inhibitor =
+		sway_idle_inhibit_v1_user_inhibitor_for_view(c->view);
+
+	if (user_inhibitor) {
+		json_object_object_add(idle_inhibitors, "user",
 			json_object_new_string(
-				ipc_json_orientation_description(c->layout)));
+				ipc_json_user_idle_inhibitor_description(user_inhibitor->mode)));
+	} else {
+		json_object_object_add(idle_inhibitors, "user",
+			json_object_new_string("none"));
+	}
 
-	bool urgent = c->view ?
-		view_is_urgent(c->view) : container_has_urgent_child(c);
-	json_object_object_add(object, "urgent", json_object_new_boolean(urgent));
-	json_object_object_add(object, "sticky", json_object_new_boolean(c->is_sticky));
+	struct sway_idle_inhibitor_v1 *application_inhibitor =
+		sway_idle_inhibit_v1_application_inhibitor_for_view(c->view);
 
-	json_object_object_add(object, "fullscreen_mode",
-			json_object_new_int(c->fullscreen_mode));
+	if (application_inhibitor) {
+		json_object_object_add(idle_inhibitors, "application",
+			json_object_new_string("enabled"));
+	} else {
+		json_object_object_add(idle_inhibitors, "application",
+			json_object_new_string("none"));
+	}
 
-	struct sway_node *parent = node_get_parent(&c->node);
-	struct wlr_box parent_box = {0, 0, 0, 0};
+	json_object_object_add(object, "idle_inhibitors", idle_inhibitors);
+}
+
+static void ipc_json_describe_container(struct sway_container *c,
+		json_object *object, uint64_t fields) {
+	if (wants(fields, IPC_FIELD_NAME)) {
+		json_object_object_add(object, "name",
+				c->title ? json_object_new_string(c->title) : NULL);
+	}
+	if (wants(fields, IPC_FIELD_TYPE)) {
+		json_object_object_add(object, "type",
+				json_object_new_string(container_is_floating(c) ? "floating_con" : "con"));
+	}
 
-	if (parent != NULL) {
-		node_get_box(parent, &parent_box);
+	if (wants(fields, IPC_FIELD_LAYOUT)) {
+		json_object_object_add(object, "layout",
+				json_object_new_string(
+					ipc_json_layout_description(c->layout)));
 	}
 
-	if (parent_box.width != 0 && parent_box.height != 0) {
-		double percent = ((double)c->width / parent_box.width)
-				* ((double)c->height / parent_box.height);
-		json_object_object_add(object, "percent", json_object_new_double(percent));
+	if (wants(fields, IPC_FIELD_ORIENTATION)) {
+		json_object_object_add(object, "orientation",
+				json_object_new_string(
+					ipc_json_orientation_description(c->layout)));
 	}
 
-	json_object_object_add(object, "border",
-			json_object_new_string(
-				ipc_json_border_description(c->current.border)));
-	json_object_object_add(object, "current_border_width",
-			json_object_new_int(c->current.border_thickness));
-	json_object_object_add(object, "floating_nodes", json_object_new_array());
+	if (wants(fields, IPC_FIELD_URGENT)) {
+		bool urgent = c->view ?
+			view_is_urgent(c->view) : container_has_urgent_child(c);
+		json_object_object_add(object, "urgent",
+				json_object_new_boolean(urgent));
+	}
+	if (wants(fields, IPC_FIELD_STICKY)) {
+		json_object_object_add(object, "sticky",
+				json_object_new_boolean(c->is_sticky));
+	}
+
+	if (wants(fields, IPC_FIELD_FULLSCREEN_MODE)) {
+		json_object_object_add(object, "fullscreen_mode",
+				json_object_new_int(c->fullscreen_mode));
+	}
 
-	struct wlr_box deco_box = {0, 0, 0, 0};
-	get_deco_rect(c, &deco_box);
-	json_object_object_add(object, "deco_rect", ipc_json_create_rect(&deco_box));
+	if (wants(fields, IPC_FIELD_PERCENT)) {
+		struct sway_node *parent = node_get_parent(&c->node);
+		struct wlr_box parent_box = {0, 0, 0, 0};
 
-	json_object *marks = json_object_new_array();
-	list_t *con_marks = c->marks;
-	for (int i = 0; i < con_marks->length; ++i) {
-		json_object_array_add(marks, json_object_new_string(con_marks->items[i]));
+		if (parent != NULL) {
+			node_get_box(parent, &parent_box);
+		}
+
+		if (parent_box.width != 0 && parent_box.height != 0) {
+			double percent = ((double)c->width / parent_box.width)
+					* ((double)c->height / parent_box.height);
+			json_object_object_add(object, "percent",
+					json_object_new_double(percent));
+		}
 	}
 
-	json_object_object_add(object, "marks", marks);
+	if (wants(fields, IPC_FIELD_BORDER)) {
+		json_object_object_add(object, "border",
+				json_object_new_string(
+					ipc_json_border_description(c->current.border)));
+	}
+	if (wants(fields, IPC_FIELD_CURRENT_BORDER_WIDTH)) {
+		json_object_object_add(object, "current_border_width",
+				json_object_new_int(c->current.border_thickness));
+	}
+	if (wants(fields, IPC_FIELD_FLOATING_NODES)) {
+		json_object_object_add(object, "floating_nodes",
+				json_object_new_array());
+	}
+
+	if (wants(fields, IPC_FIELD_DECO_RECT)) {
+		struct wlr_box deco_box = {0, 0, 0, 0};
+		get_deco_rect(c, &deco_box);
+		json_object_object_add(object, "deco_rect",
+				ipc_json_create_rect(&deco_box));
+	}
+
+	if (wants(fields, IPC_FIELD_MARKS)) {
+		json_object *marks = json_object_new_array();
+		list_t *con_marks = c->marks;
+		for (int i = 0; i < con_marks->length; ++i) {
+			json_object_array_add(marks,
+					json_object_new_string(con_marks->items[i]));
+		}
+
+		json_object_object_add(object, "marks", marks);
+	}
 
 	if (c->view) {
-		ipc_json_describe_view(c, object);
+		ipc_json_describe_view(c, object, fields);
 	}
 }
 
@@ -667,14 +1084,15 @@ static void focus_inactive_children_iterator(struct sway_node *node,
 	json_object_array_add(focus, json_object_new_int(node->id));
 }
 
-json_object *ipc_json_describe_node(struct sway_node *node) {
+static json_object *describe_node_static(struct sway_node *node,
+		uint64_t fields) {
 	struct sway_seat *seat = input_manager_get_default_seat();
 	bool focused = seat_get_focus(seat) == node;
 	char *name = node_get_name(node);
 
 	struct wlr_box box;
 	node_get_box(node, &box);
-	if (node->type == N_CONTAINER) {
+	if (node->type == N_CONTAINER && wants(fields, IPC_FIELD_RECT)) {
 		struct wlr_box deco_rect = {0, 0, 0, 0};
 		get_deco_rect(node->sway_container, &deco_rect);
 		size_t count = 1;
@@ -685,61 +1103,84 @@ json_object *ipc_json_describe_node(struct sway_node *node) {
 		box.height -= deco_rect.height * count;
 	}
 
-	json_object *focus = json_object_new_array();
-	struct focus_inactive_data data = {
-		.node = node,
-		.object = focus,
-	};
-	seat_for_each_node(seat, focus_inactive_children_iterator, &data);
+	json_object *focus = NULL;
+	if (wants(fields, IPC_FIELD_FOCUS)) {
+		focus = json_object_new_array();
+		struct focus_inactive_data data = {
+			.node = node,
+			.object = focus,
+		};
+		seat_for_each_node(seat, focus_inactive_children_iterator, &data);
+	}
 
 	json_object *object = ipc_json_create_node(
-				(int)node->id, name, focused, focus, &box);
+				(int)node->id, name, focused, focus, &box, fields);
 
 	switch (node->type) {
 	case N_ROOT:
-		ipc_json_describe_root(root, object);
+		ipc_json_describe_root(root, object, fields);
 		break;
 	case N_OUTPUT:
-		ipc_json_describe_output(node->sway_output, object);
+		ipc_json_describe_output(node->sway_output, object, fields);
 		break;
 	case N_CONTAINER:
-		ipc_json_describe_container(node->sway_container, object);
+		ipc_json_describe_container(node->sway_container, object, fields);
 		break;
 	case N_WORKSPACE:
-		ipc_json_describe_workspace(node->sway_workspace, object);
+		ipc_json_describe_workspace(node->sway_workspace, object, fields);
 		break;
 	}
 
 	return object;
 }
 
-json_object *ipc_json_describe_node_recursive(struct sway_node *node) {
-	json_object *object = ipc_json_describe_node(node);
+static json_object *describe_node(struct sway_node *node, uint64_t fields) {
+	json_object *object = describe_node_static(node, fields);
+	if (node_is_view(node)) {
+		ipc_json_describe_view_dynamic(node->sway_container, object, fields);
+	}
+	if (node->type == N_WORKSPACE && wants(fields, IPC_FIELD_FLOATING_NODES)) {
+		ipc_json_describe_workspace_floating(node->sway_workspace, object,
+				fields);
+	}
+	return object;
+}
+
+json_object *ipc_json_describe_node(struct sway_node *node) {
+	return describe_node(node, IPC_JSON_ALL_FIELDS);
+}
+
+static json_object *describe_node_recursive(struct sway_node *node,
+		uint64_t fields) {
+	json_object *object = describe_node(node, fields);
+	if (!wants(fields, IPC_FIELD_NODES)) {
+		return object;
+	}
 	int i;
 
 	json_object *children = json_object_new_array();
 	switch (node->type) {
 	case N_ROOT:
 		json_object_array_add(children,
-				ipc_json_describe_scratchpad_output());
+				ipc_json_describe_scratchpad_output(true, fields));
 		for (i = 0; i < root->outputs->length; ++i) {
 			struct sway_output *output = root->outputs->items[i];
 			json_object_array_add(children,
-					ipc_json_describe_node_recursive(&output->node));
+					describe_node_recursive(&output->node, fields));
 		}
 		break;
 	case N_OUTPUT:
 		for (i = 0; i < node->sway_output->workspaces->length; ++i) {
 			struct sway_workspace *ws = node->sway_output->workspaces->items[i];
 			json_object_array_add(children,
-					ipc_json_describe_node_recursive(&ws->node));
+					describe_node_recursive(&ws->node, fields));
 		}
 		break;
 	case N_WORKSPACE:
 		for (i = 0; i < node->sway_workspace->tiling->length; ++i) {
 			struct sway_container *con = node->sway_workspace->tiling->items[i];
 			json_object_array_add(children,
-					ipc_json_describe_node_recursive(&con->node));
+					describe_node_recursive(&con->node, fields));
 		}
 		break;
 	case N_CONTAINER:
@@ -748,7 +1189,7 @@ json_object *ipc_json_describe_node_recursive(struct sway_node *node) {
 				struct sway_container *child =
 					node->sway_container->children->items[i];
 				json_object_array_add(children,
-						ipc_json_describe_node_recursive(&child->node));
+						describe_node_recursive(&child->node, fields));
 			}
 		}
 		break;
@@ -758,6 +1199,295 @@ json_object *ipc_json_describe_node_recursive(struct sway_node *node) {
 	return object;
 }
 
+json_object *ipc_json_describe_node_recursive(struct sway_node *node) {
+	return describe_node_recursive(node, IPC_JSON_ALL_FIELDS);
+}
+
+json_object *ipc_json_describe_node_fields(struct sway_node *node,
+		uint64_t fields) {
+	// Floating containers are only reachable through the tiling children of
+	// the root and outputs, so either field selects both
+	uint64_t children = ((uint64_t)1 << IPC_FIELD_NODES) |
+		((uint64_t)1 << IPC_FIELD_FLOATING_NODES);
+	if (fields & children) {
+		fields |= children;
+	}
+	return describe_node_recursive(node, fields);
+}
+
+/**
+ * GET_TREE replies are serialized piecewise rather than through a single
+ * json-c tree, so that the descriptions of unchanged containers and
+ * workspaces can be reused. The output matches json-c's spaced format.
+ */
+struct json_buffer {
+	char *data;
+	size_t length, capacity;
+	bool failed;
+};
+
+static void json_buffer_append(struct json_buffer *buf, const char *str) {
+	if (buf->failed) {
+		return;
+	}
+	if (!str) {
+		buf->failed = true;
+		return;
+	}
+	size_t len = strlen(str);
+	if (buf->length + len + 1 > buf->capacity) {
+		size_t capacity = buf->capacity ? buf->capacity : 4096;
+		while (buf->length + len + 1 > capacity) {
+			capacity *= 2;
+		}
+		char *data = realloc(buf->data, capacity);
+		if (!data) {
+			buf->failed = true;
+			return;
+		}
+		buf->data = data;
+		buf->capacity = capacity;
+	}
+	memcpy(buf->data + buf->length, str, len + 1);
+	buf->length += len;
+}
+
+static void json_buffer_append_int(struct json_buffer *buf, int64_t value) {
+	char str[32];
+	snprintf(str, sizeof(str), "%" PRId64, value);
+	json_buffer_append(buf, str);
+}
+
+static void json_buffer_append_separator(struct json_buffer *buf,
+		bool *first) {
+	json_buffer_append(buf, *first ? " " : ", ");
+	*first = false;
+}
+
+static char *json_buffer_finish(struct json_buffer *buf) {
+	if (buf->failed) {
+		free(buf->data);
+		return NULL;
+	}
+	return buf->data;
+}
+
+/**
+ * Serialize the cacheable properties of a node as a JSON object without its
+ * closing brace, so the remaining properties can be appended to it.
+ */
+static char *serialize_node_static(struct sway_node *node) {
+	json_object *object = describe_node_static(node, IPC_JSON_ALL_FIELDS);
+	json_object_object_del(object, "nodes");
+	json_object_object_del(object, "floating_nodes");
+
+	const char *str = json_object_to_json_string(object);
+	size_t len = strlen(str);
+	while (len > 0 && str[len - 1] == ' ') {
+		--len;
+	}
+	if (len > 0 && str[len - 1] == '}') {
+		--len;
+	}
+	while (len > 0 && str[len - 1] == ' ') {
+		--len;
+	}
+	char *result = strndup(str, len);
+	json_object_put(object);
+	return result;
+}
+
+static void append_node_properties(struct json_buffer *buf,
+		struct sway_node *node) {
+	if (node->type == N_ROOT || node->type == N_OUTPUT) {
+		// These are few, and output state changes without the output being
+		// marked dirty, so they are always described afresh
+		char *str = serialize_node_static(node);
+		json_buffer_append(buf, str);
+		free(str);
+	} else {
+		if (!node->json_cache ||
+				node->json_cache_generation != node->generation) {
+			free(node->json_cache);
+			node->json_cache = serialize_node_static(node);
+			node->json_cache_generation = node->generation;
+		}
+		json_buffer_append(buf, node->json_cache);
+	}
+
+	if (node_is_view(node)) {
+		json_object *object = json_object_new_object();
+		ipc_json_describe_view_dynamic(node->sway_container, object,
+				IPC_JSON_ALL_FIELDS);
+		json_object_object_foreach(object, key, value) {
+			json_buffer_append(buf, ", \"");
+			json_buffer_append(buf, key);
+			json_buffer_append(buf, "\": ");
+			json_buffer_append(buf, json_object_to_json_string(value));
+		}
+		json_object_put(object);
+	}
+}
+
+static void append_node(struct json_buffer *buf, struct sway_node *node,
+		bool recursive);
+
+static void append_child(struct json_buffer *buf, struct sway_node *child,
+		bool recursive, bool *first) {
+	json_buffer_append_separator(buf, first);
+	if (recursive) {
+		append_node(buf, child, true);
+	} else {
+		json_buffer_append_int(buf, child->id);
+	}
+}
+
+/**
+ * Append a node's description. Its children are either described as well or,
+ * if not recursive, listed by ID.
+ */
+static void append_node(struct json_buffer *buf, struct sway_node *node,
+		bool recursive) {
+	append_node_properties(buf, node);
+
+	json_buffer_append(buf, ", \"nodes\": [");
+	bool first = true;
+	switch (node->type) {
+	case N_ROOT:
+		json_buffer_append_separator(buf, &first);
+		if (recursive) {
+			json_object *scratchpad = ipc_json_describe_scratchpad_output(true,
+					IPC_JSON_ALL_FIELDS);
+			json_buffer_append(buf, json_object_to_json_string(scratchpad));
+			json_object_put(scratchpad);
+		} else {
+			json_buffer_append_int(buf, i3_output_id);
+		}
+		for (int i = 0; i < root->outputs->length; ++i) {
+			struct sway_output *output = root->outputs->items[i];
+			append_child(buf, &output->node, recursive, &first);
+		}
+		break;
+	case N_OUTPUT:
+		for (int i = 0; i < node->sway_output->workspaces->length; ++i) {
+			struct sway_workspace *ws = node->sway_output->workspaces->items[i];
+			append_child(buf, &ws->node, recursive, &first);
+		}
+		break;
+	case N_WORKSPACE:
+		for (int i = 0; i < node->sway_workspace->tiling->length; ++i) {
+			struct sway_container *con = node->sway_workspace->tiling->items[i];
+			append_child(buf, &con->node, recursive, &first);
+		}
+		break;
+	case N_CONTAINER:
+		if (node->sway_container->children) {
+			for (int i = 0; i < node->sway_container->children->length; ++i) {
+				struct sway_container *child =
+					node->sway_container->children->items[i];
+				append_child(buf, &child->node, recursive, &first);
+			}
+		}
+		break;
+	}
+	json_buffer_append(buf, " ]");
+
+	json_buffer_append(buf, ", \"floating_nodes\": [");
+	first = true;
+	if (node->type == N_WORKSPACE) {
+		for (int i = 0; i < node->sway_workspace->floating->length; ++i) {
+			struct sway_container *floater =
+				node->sway_workspace->floating->items[i];
+			append_child(buf, &floater->node, recursive, &first);
+		}
+	}
+	json_buffer_append(buf, " ] }");
+}
+
+char *ipc_json_get_tree(void) {
+	struct json_buffer buf = {0};
+	append_node(&buf, &root->node, true);
+	return json_buffer_finish(&buf);
+}
+
+struct tree_changes_data {
+	struct json_buffer *buf;
+	uint64_t since;
+	bool first;
+};
+
+static void append_changed_node(struct sway_node *node,
+		struct tree_changes_data *data) {
+	if (node->type == N_ROOT || node->type == N_OUTPUT ||
+			node->generation > data->since) {
+		json_buffer_append_separator(data->buf, &data->first);
+		append_node(data->buf, node, false);
+	}
+}
+
+static void append_changed_container(struct sway_container *con,
+		void *data) {
+	append_changed_node(&con->node, data);
+}
+
+static void append_removed_id(size_t id, void *data) {
+	struct tree_changes_data *changes = data;
+	json_buffer_append_separator(changes->buf, &changes->first);
+	json_buffer_append_int(changes->buf, id);
+}
+
+char *ipc_json_get_tree_changes(uint64_t since) {
+	struct json_buffer buf = {0};
+	struct tree_changes_data data = {
+		.buf = &buf,
+		.since = since,
+		.first = true,
+	};
+
+	json_buffer_append(&buf, "{ \"generation\": ");
+	json_buffer_append_int(&buf, node_get_current_generation());
+
+	json_buffer_append(&buf, ", \"removed\": [");
+	bool full = since == 0 ||
+		!node_for_each_removal_since(since, append_removed_id, &data);
+	json_buffer_append(&buf, " ]");
+	json_buffer_append(&buf, full ? ", \"full\": true" : ", \"full\": false");
+	if (full) {
+		data.since = 0;
+	}
+
+	json_buffer_append(&buf, ", \"changed\": [");
+	data.first = true;
+	append_changed_node(&root->node, &data);
+
+	// The scratchpad pseudo output has no generation of its own
+	json_object *scratchpad = ipc_json_describe_scratchpad_output(false,
+			IPC_JSON_ALL_FIELDS);
+	json_buffer_append_separator(&buf, &data.first);
+	json_buffer_append(&buf, json_object_to_json_string(scratchpad));
+	json_object_put(scratchpad);
+
+	for (int i = 0; i < root->outputs->length; ++i) {
+		struct sway_output *output = root->outputs->items[i];
+		append_changed_node(&output->node, &data);
+		for (int j = 0; j < output->workspaces->length; ++j) {
+			struct sway_workspace *ws = output->workspaces->items[j];
+			append_changed_node(&ws->node, &data);
+			workspace_for_each_container(ws, append_changed_container, &data);
+		}
+	}
+	for (int i = 0; i < root->scratchpad->length; ++i) {
+		struct sway_container *con = root->scratchpad->items[i];
+		if (container_is_scratchpad_hidden(con)) {
+			append_changed_node(&con->node, &data);
+			container_for_each_child(con, append_changed_container, &data);
+		}
+	}
+	json_buffer_append(&buf, " ] }");
+
+	return json_buffer_finish(&buf);
+}
+
 static json_object *describe_libinput_device(struct libinput_device *device) {
 	json_object *object = json_object_new_object();
 
@@ -1,5 +1,5 @@
 // See https://i3wm.org/docs/ipc.html for protocol information
-#define _POSIX_C_SOURCE 200112L
+#define _POSIX_C_SOURCE 200809L
 #include <linux/input-event-codes.h>
 #include <assert.h>
 #include <errno.h>
@@ -12,11 +12,13 @@
 #include <string.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <unistd.h>
 #include <wayland-server-core.h>
 #include "sway/commands.h"
 #include "sway/config.h"
+#include "sway/criteria.h"
 #include "sway/desktop/transaction.h"
 #include "sway/ipc-json.h"
 #include "sway/ipc-server.h"
@@ -28,6 +30,7 @@
 #include "sway/tree/root.h"
 #include "sway/tree/view.h"
 #include "sway/tree/workspace.h"
+#include "cbor.h"
 #include "list.h"
 #include "log.h"
 #include "util.h"
@@ -38,19 +41,63 @@ static struct sockaddr_un *ipc_sockaddr = NULL;
 static list_t *ipc_client_list = NULL;
 static struct wl_listener ipc_display_destroy;
 
+/**
+ * A window event held back for clients which subscribed with coalescing. Only
+ * the latest event of each kind per container is kept, and it is described
+ * when the pending events are flushed.
+ */
+struct ipc_pending_event {
+	struct sway_container *container;
+	const char *change; // a string literal
+	struct wl_listener destroy;
+	struct wl_list link; // pending_events
+};
+
+static struct wl_list pending_events;
+static struct wl_event_source *pending_events_timer = NULL;
+
+static void ipc_pending_event_destroy(struct ipc_pending_event *pending);
+
 static const char ipc_magic[] = {'i', '3', '-', 'i', 'p', 'c'};
 
 #define IPC_HEADER_SIZE (sizeof(ipc_magic) + 8)
 
+// Maximum number of iovecs passed to a single sendmsg call
+#define IPC_MAX_IOVECS 64
+
+/**
+ * An immutable, refcounted message. Events are serialized once and shared by
+ * the queues of all subscribed clients.
+ */
+struct ipc_message {
+	int refs;
+	char header[IPC_HEADER_SIZE];
+	char *payload;
+	uint32_t payload_length;
+};
+
+struct ipc_queued_message {
+	struct ipc_message *message;
+	struct wl_list link; // ipc_client::write_queue
+};
+
+enum ipc_encoding {
+	IPC_ENCODING_JSON,
+	IPC_ENCODING_CBOR,
+	IPC_ENCODING_COUNT,
+};
+
 struct ipc_client {
 	struct wl_event_source *event_source;
 	struct wl_event_source *writable_event_source;
 	struct sway_server *server;
 	int fd;
 	enum ipc_command_type subscribed_events;
-	size_t write_buffer_len;
-	size_t write_buffer_size;
-	char *write_buffer;
+	bool coalesce_events;
+	enum ipc_encoding encoding; // of replies and events
+	struct wl_list write_queue; // ipc_queued_message::link
+	size_t write_queue_size; // bytes left to send
+	size_t write_offset; // bytes of the first queued message already sent
 	// The following are for storing data between event_loop calls
 	uint32_t pending_length;
 	enum ipc_command_type pending_type;
@@ -78,6 +125,14 @@ static void handle_display_destroy(struct wl_listener *listener, void *data) {
 	}
 	list_free(ipc_client_list);
 
+	struct ipc_pending_event *pending, *tmp;
+	wl_list_for_each_safe(pending, tmp, &pending_events, link) {
+		ipc_pending_event_destroy(pending);
+	}
+	if (pending_events_timer) {
+		wl_event_source_remove(pending_events_timer);
+	}
+
 	free(ipc_sockaddr);
 
 	wl_list_remove(&ipc_display_destroy.link);
@@ -117,6 +172,7 @@ void ipc_init(struct sway_server *server) {
 	setenv("SWAYSOCK", ipc_sockaddr->sun_path, 1);
 
 	ipc_client_list = create_list();
+	wl_list_init(&pending_events);
 
 	ipc_display_destroy.notify = handle_display_destroy;
 	wl_display_add_destroy_listener(server->wl_display, &ipc_display_destroy);
@@ -183,18 +239,15 @@ int ipc_handle_connection(int fd, uint32_t mask, void *data) {
 	client->pending_length = 0;
 	client->fd = client_fd;
 	client->subscribed_events = 0;
+	client->coalesce_events = false;
+	client->encoding = IPC_ENCODING_JSON;
 	client->event_source = wl_event_loop_add_fd(server->wl_event_loop,
 			client_fd, WL_EVENT_READABLE, ipc_client_handle_readable, client);
 	client->writable_event_source = NULL;
 
-	client->write_buffer_size = 128;
-	client->write_buffer_len = 0;
-	client->write_buffer = malloc(client->write_buffer_size);
-	if (!client->write_buffer) {
-		sway_log(SWAY_ERROR, "Unable to allocate ipc client write buffer");
-		close(client_fd);
-		return 0;
-	}
+	wl_list_init(&client->write_queue);
+	client->write_queue_size = 0;
+	client->write_offset = 0;
 
 	sway_log(SWAY_DEBUG, "New client: fd %d", client_fd);
 	list_add(ipc_client_list, client);
@@ -271,36 +324,356 @@ int ipc_client_handle_readable(int client_fd, uint32_t mask, void *data) {
 	return 0;
 }
 
-static bool ipc_has_event_listeners(enum ipc_command_type event) {
+/**
+ * Create a message, taking ownership of the payload.
+ */
+static struct ipc_message *ipc_message_create(enum ipc_command_type type,
+		char *payload, uint32_t payload_length) {
+	struct ipc_message *message = malloc(sizeof(struct ipc_message));
+	if (!message) {
+		free(payload);
+		return NULL;
+	}
+	message->refs = 1;
+	message->payload = payload;
+	message->payload_length = payload_length;
+
+	uint32_t *header32 = (uint32_t *)(message->header + sizeof(ipc_magic));
+	memcpy(message->header, ipc_magic, sizeof(ipc_magic));
+	memcpy(&header32[0], &payload_length, sizeof(payload_length));
+	memcpy(&header32[1], &type, sizeof(type));
+	return message;
+}
+
+/**
+ * Serialize a value in the given encoding. Returns an allocated payload, or
+ * NULL on allocation failure.
+ */
+static char *ipc_encode(enum ipc_encoding encoding, json_object *obj,
+		uint32_t *payload_length) {
+	if (encoding == IPC_ENCODING_CBOR) {
+		size_t len;
+		char *payload = cbor_encode_json(obj, &len);
+		*payload_length = len;
+		return payload;
+	}
+	const char *json_string = json_object_to_json_string(obj);
+	*payload_length = strlen(json_string);
+	return strdup(json_string);
+}
+
+static void ipc_message_unref(struct ipc_message *message) {
+	if (--message->refs > 0) {
+		return;
+	}
+	free(message->payload);
+	free(message);
+}
+
+static size_t ipc_message_size(struct ipc_message *message) {
+	return IPC_HEADER_SIZE + message->payload_length;
+}
+
+/**
+ * Queue a message for the client. Returns false if the client had to be
+ * disconnected, either because it is too far behind or on allocation failure.
+ */
+static bool ipc_client_queue_message(struct ipc_client *client,
+		struct ipc_message *message, bool is_event) {
+	size_t size = ipc_message_size(message);
+	if (client->write_queue_size + size > config->ipc_backlog_size) {
+		if (config->ipc_backlog_policy == IPC_BACKLOG_DISCONNECT) {
+			sway_log(SWAY_ERROR, "Client %d backlog too big (%zu bytes), "
+					"disconnecting client", client->fd,
+					client->write_queue_size + size);
+			ipc_client_disconnect(client);
+			return false;
+		} else if (is_event) {
+			sway_log(SWAY_INFO, "Client %d backlog too big (%zu bytes), "
+					"dropping event", client->fd, client->write_queue_size);
+			return true;
+		}
+		// Replies are never dropped, the client is waiting for them
+	}
+
+	struct ipc_queued_message *queued =
+		calloc(1, sizeof(struct ipc_queued_message));
+	if (!queued) {
+		sway_log(SWAY_ERROR, "Unable to queue ipc message");
+		ipc_client_disconnect(client);
+		return false;
+	}
+	queued->message = message;
+	++message->refs;
+	wl_list_insert(client->write_queue.prev, &queued->link);
+	client->write_queue_size += size;
+
+	if (!client->writable_event_source) {
+		client->writable_event_source = wl_event_loop_add_fd(
+				server.wl_event_loop, client->fd, WL_EVENT_WRITABLE,
+				ipc_client_handle_writable, client);
+	}
+	return true;
+}
+
+static void ipc_client_pop_message(struct ipc_client *client) {
+	struct ipc_queued_message *queued =
+		wl_container_of(client->write_queue.next, queued, link);
+	wl_list_remove(&queued->link);
+	ipc_message_unref(queued->message);
+	free(queued);
+}
+
+/**
+ * Queue an encoded reply, taking ownership of the payload so it isn't copied.
+ */
+static bool ipc_queue_reply(struct ipc_client *client,
+		enum ipc_command_type payload_type, char *payload,
+		uint32_t payload_length) {
+	struct ipc_message *message = payload == NULL ? NULL :
+		ipc_message_create(payload_type, payload, payload_length);
+	if (!message) {
+		sway_log(SWAY_ERROR, "Unable to allocate ipc reply");
+		ipc_client_disconnect(client);
+		return false;
+	}
+	bool queued = ipc_client_queue_message(client, message, false);
+	ipc_message_unref(message);
+	if (queued) {
+		sway_log(SWAY_DEBUG, "Added IPC reply of type 0x%x to client %d queue "
+			"(%u bytes)", payload_type, client->fd, payload_length);
+	}
+	return queued;
+}
+
+/**
+ * Queue a reply given as JSON text, taking ownership of the payload. It is
+ * transcoded if the client asked for another encoding.
+ */
+static bool ipc_send_reply_owned(struct ipc_client *client,
+		enum ipc_command_type payload_type, char *payload,
+		uint32_t payload_length) {
+	if (payload && client->encoding != IPC_ENCODING_JSON) {
+		json_object *obj = json_tokener_parse(payload);
+		free(payload);
+		payload = ipc_encode(client->encoding, obj, &payload_length);
+		json_object_put(obj);
+	}
+	return ipc_queue_reply(client, payload_type, payload, payload_length);
+}
+
+static bool ipc_send_reply_json(struct ipc_client *client,
+		enum ipc_command_type payload_type, json_object *obj) {
+	uint32_t payload_length;
+	char *payload = ipc_encode(client->encoding, obj, &payload_length);
+	return ipc_queue_reply(client, payload_type, payload, payload_length);
+}
+
+enum ipc_event_recipients {
+	IPC_RECIPIENTS_ALL,
+	IPC_RECIPIENTS_IMMEDIATE, // clients which didn't ask for coalescing
+	IPC_RECIPIENTS_COALESCED, // clients which did
+};
+
+static bool ipc_client_wants_event(struct ipc_client *client,
+		enum ipc_command_type event, enum ipc_event_recipients recipients) {
+	if ((client->subscribed_events & event_mask(event)) == 0) {
+		return false;
+	}
+	switch (recipients) {
+	case IPC_RECIPIENTS_ALL:
+		return true;
+	case IPC_RECIPIENTS_IMMEDIATE:
+		return !client->coalesce_events;
+	case IPC_RECIPIENTS_COALESCED:
+		return client->coalesce_events;
+	}
+	return false;
+}
+
+static bool ipc_has_recipients(enum ipc_command_type event,
+		enum ipc_event_recipients recipients) {
 	for (int i = 0; i < ipc_client_list->length; i++) {
 		struct ipc_client *client = ipc_client_list->items[i];
-		if ((client->subscribed_events & event_mask(event)) != 0) {
+		if (ipc_client_wants_event(client, event, recipients)) {
 			return true;
 		}
 	}
 	return false;
 }
 
-static void ipc_send_event(const char *json_string, enum ipc_command_type event) {
+static bool ipc_has_event_listeners(enum ipc_command_type event) {
+	return ipc_has_recipients(event, IPC_RECIPIENTS_ALL);
+}
+
+/**
+ * Send an event to the matching clients. It is serialized at most once per
+ * encoding in use.
+ */
+static void ipc_send_event_to(json_object *obj,
+		enum ipc_command_type event, enum ipc_event_recipients recipients) {
+	struct ipc_message *messages[IPC_ENCODING_COUNT] = {0};
 	struct ipc_client *client;
 	for (int i = 0; i < ipc_client_list->length; i++) {
 		client = ipc_client_list->items[i];
-		if ((client->subscribed_events & event_mask(event)) == 0) {
+		if (!ipc_client_wants_event(client, event, recipients)) {
 			continue;
 		}
-		if (!ipc_send_reply(client, event, json_string,
-				(uint32_t)strlen(json_string))) {
-			sway_log_errno(SWAY_INFO, "Unable to send reply to IPC client");
-			/* ipc_send_reply destroys client on error, which also
-			 * removes it from the list, so we need to process
+		struct ipc_message **message = &messages[client->encoding];
+		if (!*message) {
+			uint32_t payload_length;
+			char *payload =
+				ipc_encode(client->encoding, obj, &payload_length);
+			*message = payload == NULL ? NULL :
+				ipc_message_create(event, payload, payload_length);
+			if (!*message) {
+				sway_log(SWAY_ERROR, "Unable to allocate ipc event");
+				continue;
+			}
+		}
+		if (!ipc_client_queue_message(client, *message, true)) {
+			sway_log(SWAY_INFO, "Unable to send event to IPC client");
+			/* ipc_client_queue_message destroys client on error, which
+			 * also removes it from the list, so we need to process
 			 * current index again */
 			i--;
 		}
 	}
+	for (size_t i = 0; i < IPC_ENCODING_COUNT; ++i) {
+		if (messages[i]) {
+			ipc_message_unref(messages[i]);
+		}
+	}
+}
+
+static json_object *ipc_describe_window_event(struct sway_container *window,
+		const char *change) {
+	json_object *obj = json_object_new_object();
+	json_object_object_add(obj, "change", json_object_new_string(change));
+	json_object_object_add(obj, "container",
+			ipc_json_describe_node_recursive(&window->node));
+	return obj;
+}
+
+static void ipc_pending_event_destroy(struct ipc_pending_event *pending) {
+	wl_list_remove(&pending->destroy.link);
+	wl_list_remove(&pending->link);
+	free(pending);
+}
+
+static void ipc_flush_pending_events(void) {
+	if (wl_list_empty(&pending_events)) {
+		return;
+	}
+	struct ipc_pending_event *pending, *tmp;
+	wl_list_for_each_safe(pending, tmp, &pending_events, link) {
+		if (ipc_has_recipients(IPC_EVENT_WINDOW, IPC_RECIPIENTS_COALESCED)) {
+			sway_log(SWAY_DEBUG, "Sending coalesced window::%s event",
+					pending->change);
+			json_object *obj =
+				ipc_describe_window_event(pending->container, pending->change);
+			ipc_send_event_to(obj, IPC_EVENT_WINDOW,
+					IPC_RECIPIENTS_COALESCED);
+			json_object_put(obj);
+		}
+		ipc_pending_event_destroy(pending);
+	}
+	if (pending_events_timer) {
+		wl_event_source_timer_update(pending_events_timer, 0);
+	}
+}
+
+static int handle_pending_events_timer(void *data) {
+	ipc_flush_pending_events();
+	return 0;
+}
+
+static void handle_pending_event_container_destroy(struct wl_listener *listener,
+		void *data) {
+	struct ipc_pending_event *pending =
+		wl_container_of(listener, pending, destroy);
+	ipc_pending_event_destroy(pending);
+}
+
+/**
+ * Pending events are flushed about once per frame of the fastest output.
+ */
+static int ipc_coalesce_interval(void) {
+	int refresh = 0; // mHz
+	for (int i = 0; i < root->outputs->length; ++i) {
+		struct sway_output *output = root->outputs->items[i];
+		if (output->wlr_output->refresh > refresh) {
+			refresh = output->wlr_output->refresh;
+		}
+	}
+	if (refresh <= 0) {
+		return 16;
+	}
+	int interval = 1000000 / refresh;
+	return interval > 0 ? interval : 1;
+}
+
+static void ipc_add_pending_event(struct sway_container *window,
+		const char *change) {
+	struct ipc_pending_event *pending;
+	wl_list_for_each(pending, &pending_events, link) {
+		if (pending->container == window && pending->change == change) {
+			// Keep the events in the order of their latest occurrence
+			wl_list_remove(&pending->link);
+			wl_list_insert(pending_events.prev, &pending->link);
+			return;
+		}
+	}
+
+	pending = calloc(1, sizeof(struct ipc_pending_event));
+	if (!pending) {
+		sway_log(SWAY_ERROR, "Unable to allocate pending ipc event");
+		return;
+	}
+	pending->container = window;
+	pending->change = change;
+	pending->destroy.notify = handle_pending_event_container_destroy;
+	wl_signal_add(&window->node.events.destroy, &pending->destroy);
+
+	if (!pending_events_timer) {
+		pending_events_timer = wl_event_loop_add_timer(server.wl_event_loop,
+				handle_pending_events_timer, NULL);
+	}
+	if (wl_list_empty(&pending_events) && pending_events_timer) {
+		wl_event_source_timer_update(pending_events_timer,
+				ipc_coalesce_interval());
+	}
+	wl_list_insert(pending_events.prev, &pending->link);
+}
+
+/**
+ * Return the canonical string of a window change which may be coalesced, or
+ * NULL if it must be sent right away.
+ */
+static const char *ipc_coalescable_change(const char *change) {
+	static const char *changes[] = { "focus", "title" };
+	for (size_t i = 0; i < sizeof(changes) / sizeof(changes[0]); ++i) {
+		if (strcmp(change, changes[i]) == 0) {
+			return changes[i];
+		}
+	}
+	return NULL;
+}
+
+static void ipc_send_event(json_object *obj, enum ipc_command_type event) {
+	// Coalesced events must not overtake the events which follow them
+	ipc_flush_pending_events();
+	ipc_send_event_to(obj, event, IPC_RECIPIENTS_ALL);
 }
 
 void ipc_event_workspace(struct sway_workspace *old,
 		struct sway_workspace *new, const char *change) {
+	if (old) {
+		node_bump_generation(&old->node);
+	}
+	if (new) {
+		node_bump_generation(&new->node);
+	}
 	if (!ipc_has_event_listeners(IPC_EVENT_WORKSPACE)) {
 		return;
 	}
@@ -321,23 +694,34 @@ void ipc_event_workspace(struct sway_workspace *old,
 		json_object_object_add(obj, "current", NULL);
 	}
 
-	const char *json_string = json_object_to_json_string(obj);
-	ipc_send_event(json_string, IPC_EVENT_WORKSPACE);
+	ipc_send_event(obj, IPC_EVENT_WORKSPACE);
 	json_object_put(obj);
 }
 
 void ipc_event_window(struct sway_container *window, const char *change) {
+	// Whatever warrants a window event also changes its IPC description
+	node_bump_generation(&window->node);
 	if (!ipc_has_event_listeners(IPC_EVENT_WINDOW)) {
 		return;
 	}
-	sway_log(SWAY_DEBUG, "Sending window::%s event", change);
-	json_object *obj = json_object_new_object();
-	json_object_object_add(obj, "change", json_object_new_string(change));
-	json_object_object_add(obj, "container",
-			ipc_json_describe_node_recursive(&window->node));
 
-	const char *json_string = json_object_to_json_string(obj);
-	ipc_send_event(json_string, IPC_EVENT_WINDOW);
+	const char *coalescable = ipc_coalescable_change(change);
+	if (coalescable &&
+			ipc_has_recipients(IPC_EVENT_WINDOW, IPC_RECIPIENTS_COALESCED)) {
+		ipc_add_pending_event(window, coalescable);
+		if (!ipc_has_recipients(IPC_EVENT_WINDOW, IPC_RECIPIENTS_IMMEDIATE)) {
+			return;
+		}
+		sway_log(SWAY_DEBUG, "Sending window::%s event", change);
+		json_object *obj = ipc_describe_window_event(window, change);
+		ipc_send_event_to(obj, IPC_EVENT_WINDOW, IPC_RECIPIENTS_IMMEDIATE);
+		json_object_put(obj);
+		return;
+	}
+
+	sway_log(SWAY_DEBUG, "Sending window::%s event", change);
+	json_object *obj = ipc_describe_window_event(window, change);
+	ipc_send_event(obj, IPC_EVENT_WINDOW);
 	json_object_put(obj);
 }
 
@@ -348,8 +732,7 @@ void ipc_event_barconfig_update(struct bar_config *bar) {
 	sway_log(SWAY_DEBUG, "Sending barconfig_update event");
 	json_object *json = ipc_json_describe_bar_config(bar);
 
-	const char *json_string = json_object_to_json_string(json);
-	ipc_send_event(json_string, IPC_EVENT_BARCONFIG_UPDATE);
+	ipc_send_event(json, IPC_EVENT_BARCONFIG_UPDATE);
 	json_object_put(json);
 }
 
@@ -364,8 +747,7 @@ void ipc_event_bar_state_update(struct bar_config *bar) {
 	json_object_object_add(json, "visible_by_modifier",
 			json_object_new_boolean(bar->visible_by_modifier));
 
-	const char *json_string = json_object_to_json_string(json);
-	ipc_send_event(json_string, IPC_EVENT_BAR_STATE_UPDATE);
+	ipc_send_event(json, IPC_EVENT_BAR_STATE_UPDATE);
 	json_object_put(json);
 }
 
@@ -379,8 +761,7 @@ void ipc_event_mode(const char *mode, bool pango) {
 	json_object_object_add(obj, "pango_markup",
 			json_object_new_boolean(pango));
 
-	const char *json_string = json_object_to_json_string(obj);
-	ipc_send_event(json_string, IPC_EVENT_MODE);
+	ipc_send_event(obj, IPC_EVENT_MODE);
 	json_object_put(obj);
 }
 
@@ -393,8 +774,7 @@ void ipc_event_shutdown(const char *reason) {
 	json_object *json = json_object_new_object();
 	json_object_object_add(json, "change", json_object_new_string(reason));
 
-	const char *json_string = json_object_to_json_string(json);
-	ipc_send_event(json_string, IPC_EVENT_SHUTDOWN);
+	ipc_send_event(json, IPC_EVENT_SHUTDOWN);
 	json_object_put(json);
 }
 
@@ -479,8 +859,7 @@ void ipc_event_binding(struct sway_binding *binding) {
 	json_object *json = json_object_new_object();
 	json_object_object_add(json, "change", json_object_new_string("run"));
 	json_object_object_add(json, "binding", json_binding);
-	const char *json_string = json_object_to_json_string(json);
-	ipc_send_event(json_string, IPC_EVENT_BINDING);
+	ipc_send_event(json, IPC_EVENT_BINDING);
 	json_object_put(json);
 }
 
@@ -494,8 +873,7 @@ static void ipc_event_tick(const char *payload) {
 	json_object_object_add(json, "first", json_object_new_boolean(false));
 	json_object_object_add(json, "payload", json_object_new_string(payload));
 
-	const char *json_string = json_object_to_json_string(json);
-	ipc_send_event(json_string, IPC_EVENT_TICK);
+	ipc_send_event(json, IPC_EVENT_TICK);
 	json_object_put(json);
 }
 
@@ -509,8 +887,7 @@ void ipc_event_input(const char *change, struct sway_input_device *device) {
 	json_object_object_add(json, "change", json_object_new_string(change));
 	json_object_object_add(json, "input", ipc_json_describe_input(device));
 
-	const char *json_string = json_object_to_json_string(json);
-	ipc_send_event(json_string, IPC_EVENT_INPUT);
+	ipc_send_event(json, IPC_EVENT_INPUT);
 	json_object_put(json);
 }
 
@@ -529,13 +906,42 @@ int ipc_client_handle_writable(int client_fd, uint32_t mask, void *data) {
 		return 0;
 	}
 
-	if (client->write_buffer_len <= 0) {
+	if (wl_list_empty(&client->write_queue)) {
 		return 0;
 	}
 
 	sway_log(SWAY_DEBUG, "Client %d writable", client->fd);
 
-	ssize_t written = write(client->fd, client->write_buffer, client->write_buffer_len);
+	// Gather as much of the queue as possible into a single call
+	struct iovec iov[IPC_MAX_IOVECS];
+	int iovcnt = 0;
+	size_t offset = client->write_offset;
+	struct ipc_queued_message *queued;
+	wl_list_for_each(queued, &client->write_queue, link) {
+		if (iovcnt + 2 > IPC_MAX_IOVECS) {
+			break;
+		}
+		struct ipc_message *message = queued->message;
+		if (offset < IPC_HEADER_SIZE) {
+			iov[iovcnt].iov_base = message->header + offset;
+			iov[iovcnt].iov_len = IPC_HEADER_SIZE - offset;
+			++iovcnt;
+			offset = IPC_HEADER_SIZE;
+		}
+		if (offset < ipc_message_size(message)) {
+			iov[iovcnt].iov_base =
+				message->payload + (offset - IPC_HEADER_SIZE);
+			iov[iovcnt].iov_len = ipc_message_size(message) - offset;
+			++iovcnt;
+		}
+		offset = 0;
+	}
+
+	struct msghdr msg = {
+		.msg_iov = iov,
+		.msg_iovlen = iovcnt,
+	};
+	ssize_t written = sendmsg(client->fd, &msg, MSG_NOSIGNAL);
 
 	if (written == -1 && errno == EAGAIN) {
 		return 0;
@@ -545,10 +951,21 @@ int ipc_client_handle_writable(int client_fd, uint32_t mask, void *data) {
 		return 0;
 	}
 
-	memmove(client->write_buffer, client->write_buffer + written, client->write_buffer_len - written);
-	client->write_buffer_len -= written;
+	client->write_queue_size -= written;
+	size_t remaining = written;
+	while (remaining > 0) {
+		queued = wl_container_of(client->write_queue.next, queued, link);
+		size_t unsent = ipc_message_size(queued->message) - client->write_offset;
+		if (remaining < unsent) {
+			client->write_offset += remaining;
+			break;
+		}
+		remaining -= unsent;
+		client->write_offset = 0;
+		ipc_client_pop_message(client);
+	}
 
-	if (client->write_buffer_len == 0 && client->writable_event_source) {
+	if (wl_list_empty(&client->write_queue) && client->writable_event_source) {
 		wl_event_source_remove(client->writable_event_source);
 		client->writable_event_source = NULL;
 	}
@@ -573,7 +990,9 @@ void ipc_client_disconnect(struct ipc_client *client) {
 		i++;
 	}
 	list_del(ipc_client_list, i);
-	free(client->write_buffer);
+	while (!wl_list_empty(&client->write_queue)) {
+		ipc_client_pop_message(client);
+	}
 	close(client->fd);
 	free(client);
 }
@@ -597,6 +1016,110 @@ static void ipc_get_workspaces_callback(struct sway_workspace *workspace,
 			json_object_new_boolean(visible));
 }
 
+static bool find_container_by_id(struct sway_container *con, void *data) {
+	size_t *id = data;
+	return con->node.id == *id;
+}
+
+static struct sway_node *ipc_find_node(size_t id) {
+	if (root->node.id == id) {
+		return &root->node;
+	}
+	for (int i = 0; i < root->outputs->length; ++i) {
+		struct sway_output *output = root->outputs->items[i];
+		if (output->node.id == id) {
+			return &output->node;
+		}
+		for (int j = 0; j < output->workspaces->length; ++j) {
+			struct sway_workspace *ws = output->workspaces->items[j];
+			if (ws->node.id == id) {
+				return &ws->node;
+			}
+		}
+	}
+	struct sway_container *con = root_find_container(find_container_by_id, &id);
+	return con ? &con->node : NULL;
+}
+
+/**
+ * Describe the nodes selected by a GET_TREE query, restricted to the requested
+ * properties. Returns NULL and sets error if the query is invalid.
+ */
+static json_object *ipc_get_tree_query(json_object *request, char **error) {
+	json_object *id = NULL, *criteria = NULL, *fields_json = NULL;
+	json_object_object_foreach(request, key, value) {
+		if (strcmp(key, "id") == 0) {
+			id = value;
+		} else if (strcmp(key, "criteria") == 0) {
+			criteria = value;
+		} else if (strcmp(key, "fields") == 0) {
+			fields_json = value;
+		} else {
+			*error = strdup("Unknown get_tree query key");
+			return NULL;
+		}
+	}
+
+	uint64_t fields = IPC_JSON_ALL_FIELDS;
+	if (fields_json) {
+		if (!json_object_is_type(fields_json, json_type_array)) {
+			*error = strdup("Expected an array of fields");
+			return NULL;
+		}
+		fields = 0;
+		size_t len = json_object_array_length(fields_json);
+		for (size_t i = 0; i < len; ++i) {
+			json_object *field = json_object_array_get_idx(fields_json, i);
+			if (!json_object_is_type(field, json_type_string) ||
+					!ipc_json_node_field_mask(
+						json_object_get_string(field), &fields)) {
+				*error = strdup("Unknown field");
+				return NULL;
+			}
+		}
+	}
+
+	if (id && criteria) {
+		*error = strdup("Expected either an id or criteria, not both");
+		return NULL;
+	}
+	if (id) {
+		struct sway_node *node = NULL;
+		if (json_object_is_type(id, json_type_int) &&
+				json_object_get_int64(id) >= 0) {
+			node = ipc_find_node(json_object_get_int64(id));
+		}
+		if (!node) {
+			*error = strdup("No node with that id");
+			return NULL;
+		}
+		return ipc_json_describe_node_fields(node, fields);
+	}
+	if (criteria) {
+		if (!json_object_is_type(criteria, json_type_string)) {
+			*error = strdup("Expected criteria as a string");
+			return NULL;
+		}
+		char *raw = strdup(json_object_get_string(criteria));
+		struct criteria *parsed = criteria_parse(raw, error);
+		free(raw);
+		if (!parsed) {
+			return NULL;
+		}
+		json_object *matches = json_object_new_array();
+		list_t *containers = criteria_get_containers(parsed);
+		for (int i = 0; i < containers->length; ++i) {
+			struct sway_container *con = containers->items[i];
+			json_object_array_add(matches,
+					ipc_json_describe_node_fields(&con->node, fields));
+		}
+		list_free(containers);
+		criteria_destroy(parsed);
+		return matches;
+	}
+	return ipc_json_describe_node_fields(&root->node, fields);
+}
+
 static void ipc_get_marks_callback(struct sway_container *con, void *data) {
 	json_object *marks = (json_object *)data;
 	for (int i = 0; i < con->marks->length; ++i) {
@@ -693,9 +1216,7 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 						ipc_json_describe_disabled_output(output));
 			}
 		}
-		const char *json_string = json_object_to_json_string(outputs);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
+		ipc_send_reply_json(client, payload_type, outputs);
 		json_object_put(outputs); // free
 		goto exit_cleanup;
 	}
@@ -704,9 +1225,7 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 	{
 		json_object *workspaces = json_object_new_array();
 		root_for_each_workspace(ipc_get_workspaces_callback, workspaces);
-		const char *json_string = json_object_to_json_string(workspaces);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
+		ipc_send_reply_json(client, payload_type, workspaces);
 		json_object_put(workspaces); // free
 		goto exit_cleanup;
 	}
@@ -715,17 +1234,31 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 	{
 		// TODO: Check if they're permitted to use these events
 		struct json_object *request = json_tokener_parse(buf);
-		if (request == NULL || !json_object_is_type(request, json_type_array)) {
+		// Either an array of events, or an object with the array of events
+		// and options: {"events": [...], "coalesce": true}
+		struct json_object *events = request;
+		bool coalesce = false;
+		if (request && json_object_is_type(request, json_type_object)) {
+			struct json_object *coalesce_obj;
+			if (json_object_object_get_ex(request, "coalesce", &coalesce_obj)) {
+				coalesce = json_object_get_boolean(coalesce_obj);
+			}
+			if (!json_object_object_get_ex(request, "events", &events)) {
+				events = NULL;
+			}
+		}
+		if (events == NULL || !json_object_is_type(events, json_type_array)) {
 			const char msg[] = "{\"success\": false}";
 			ipc_send_reply(client, payload_type, msg, strlen(msg));
+			json_object_put(request);
 			sway_log(SWAY_INFO, "Failed to parse subscribe request");
 			goto exit_cleanup;
 		}
 
 		bool is_tick = false;
 		// parse requested event types
-		for (size_t i = 0; i < json_object_array_length(request); i++) {
-			const char *event_type = json_object_get_string(json_object_array_get_idx(request, i));
+		for (size_t i = 0; i < json_object_array_length(events); i++) {
+			const char *event_type = json_object_get_string(json_object_array_get_idx(events, i));
 			if (strcmp(event_type, "workspace") == 0) {
 				client->subscribed_events |= event_mask(IPC_EVENT_WORKSPACE);
 			} else if (strcmp(event_type, "barconfig_update") == 0) {
@@ -755,6 +1288,9 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 		}
 
 		json_object_put(request);
+		if (coalesce) {
+			client->coalesce_events = true;
+		}
 		const char msg[] = "{\"success\": true}";
 		ipc_send_reply(client, payload_type, msg, strlen(msg));
 		if (is_tick) {
@@ -772,9 +1308,7 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 		wl_list_for_each(device, &server.input->devices, link) {
 			json_object_array_add(inputs, ipc_json_describe_input(device));
 		}
-		const char *json_string = json_object_to_json_string(inputs);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
+		ipc_send_reply_json(client, payload_type, inputs);
 		json_object_put(inputs); // free
 		goto exit_cleanup;
 	}
@@ -786,20 +1320,90 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 		wl_list_for_each(seat, &server.input->seats, link) {
 			json_object_array_add(seats, ipc_json_describe_seat(seat));
 		}
-		const char *json_string = json_object_to_json_string(seats);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
+		ipc_send_reply_json(client, payload_type, seats);
 		json_object_put(seats); // free
 		goto exit_cleanup;
 	}
 
+	case IPC_GET_FRAME_TIMINGS:
+	{
+		json_object *outputs = json_object_new_array();
+		for (int i = 0; i < root->outputs->length; ++i) {
+			struct sway_output *output = root->outputs->items[i];
+			json_object_array_add(outputs,
+					ipc_json_describe_frame_timings(output));
+		}
+		ipc_send_reply_json(client, payload_type, outputs);
+		json_object_put(outputs); // free
+		goto exit_cleanup;
+	}
+
+	case IPC_GET_STARTUP_PROFILE:
+	{
+		json_object *profile = ipc_json_get_startup_profile();
+		ipc_send_reply_json(client, payload_type, profile);
+		json_object_put(profile); // free
+		goto exit_cleanup;
+	}
+
 	case IPC_GET_TREE:
 	{
-		json_object *tree = ipc_json_describe_node_recursive(&root->node);
-		const char *json_string = json_object_to_json_string(tree);
-		ipc_send_reply(client, payload_type, json_string,
+		char *json_string;
+		if (payload_length == 0 && client->encoding != IPC_ENCODING_JSON) {
+			// The cached descriptions are JSON text, so skip them rather than
+			// transcoding the whole tree
+			json_object *tree = ipc_json_describe_node_recursive(&root->node);
+			ipc_send_reply_json(client, payload_type, tree);
+			json_object_put(tree);
+			goto exit_cleanup;
+		} else if (payload_length == 0) {
+			json_string = ipc_json_get_tree();
+		} else {
+			json_object *request = json_tokener_parse(buf);
+			json_object *since = NULL;
+			if (!json_object_is_type(request, json_type_object) ||
+					!json_object_object_get_ex(request, "since", &since)) {
+				// A query: {"id": <id>, "criteria": <criteria>, "fields": [...]}
+				char *error = NULL;
+				json_object *reply = request == NULL ? NULL :
+					ipc_get_tree_query(request, &error);
+				if (!reply) {
+					reply = json_object_new_object();
+					json_object_object_add(reply, "success",
+							json_object_new_boolean(false));
+					json_object_object_add(reply, "error",
+							json_object_new_string(error ? error :
+								"Invalid get_tree request"));
+					free(error);
+				}
+				ipc_send_reply_json(client, payload_type, reply);
+				json_object_put(reply);
+				json_object_put(request);
+				goto exit_cleanup;
+			}
+			// An incremental request: {"since": <generation>}
+			if (!json_object_is_type(since, json_type_int) ||
+					json_object_get_int64(since) < 0 ||
+					json_object_object_length(request) != 1) {
+				const char msg[] = "{\"success\": false, "
+					"\"error\": \"Invalid get_tree request\"}";
+				ipc_send_reply(client, payload_type, msg, strlen(msg));
+				json_object_put(request);
+				goto exit_cleanup;
+			}
+			json_string = ipc_json_get_tree_changes(
+					json_object_get_int64(since));
+			json_object_put(request);
+		}
+		if (!json_string) {
+			const char msg[] = "{\"success\": false, "
+				"\"error\": \"Unable to allocate reply\"}";
+			sway_log(SWAY_ERROR, "Unable to allocate get_tree reply");
+			ipc_send_reply(client, payload_type, msg, strlen(msg));
+			goto exit_cleanup;
+		}
+		ipc_send_reply_owned(client, payload_type, json_string,
 			(uint32_t)strlen(json_string));
-		json_object_put(tree);
 		goto exit_cleanup;
 	}
 
@@ -807,9 +1411,7 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 	{
 		json_object *marks = json_object_new_array();
 		root_for_each_container(ipc_get_marks_callback, marks);
-		const char *json_string = json_object_to_json_string(marks);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
+		ipc_send_reply_json(client, payload_type, marks);
 		json_object_put(marks);
 		goto exit_cleanup;
 	}
@@ -817,9 +1419,7 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 	case IPC_GET_VERSION:
 	{
 		json_object *version = ipc_json_get_version();
-		const char *json_string = json_object_to_json_string(version);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
+		ipc_send_reply_json(client, payload_type, version);
 		json_object_put(version); // free
 		goto exit_cleanup;
 	}
@@ -833,9 +1433,7 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 				struct bar_config *bar = config->bars->items[i];
 				json_object_array_add(bars, json_object_new_string(bar->id));
 			}
-			const char *json_string = json_object_to_json_string(bars);
-			ipc_send_reply(client, payload_type, json_string,
-				(uint32_t)strlen(json_string));
+			ipc_send_reply_json(client, payload_type, bars);
 			json_object_put(bars); // free
 		} else {
 			// Send particular bar's details
@@ -854,9 +1452,7 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 				goto exit_cleanup;
 			}
 			json_object *json = ipc_json_describe_bar_config(bar);
-			const char *json_string = json_object_to_json_string(json);
-			ipc_send_reply(client, payload_type, json_string,
-				(uint32_t)strlen(json_string));
+			ipc_send_reply_json(client, payload_type, json);
 			json_object_put(json); // free
 		}
 		goto exit_cleanup;
@@ -869,9 +1465,7 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 			struct sway_mode *mode = config->modes->items[i];
 			json_object_array_add(modes, json_object_new_string(mode->name));
 		}
-		const char *json_string = json_object_to_json_string(modes);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
+		ipc_send_reply_json(client, payload_type, modes);
 		json_object_put(modes); // free
 		goto exit_cleanup;
 	}
@@ -879,9 +1473,7 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 	case IPC_GET_BINDING_STATE:
 	{
 		json_object *current_mode = ipc_json_get_binding_mode();
-		const char *json_string = json_object_to_json_string(current_mode);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
+		ipc_send_reply_json(client, payload_type, current_mode);
 		json_object_put(current_mode); // free
 		goto exit_cleanup;
 	}
@@ -890,9 +1482,7 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 	{
 		json_object *json = json_object_new_object();
 		json_object_object_add(json, "config", json_object_new_string(config->current_config));
-		const char *json_string = json_object_to_json_string(json);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
+		ipc_send_reply_json(client, payload_type, json);
 		json_object_put(json); // free
 		goto exit_cleanup;
 	}
@@ -905,6 +1495,29 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 		goto exit_cleanup;
 	}
 
+	case IPC_SET_ENCODING:
+	{
+		// The reply is always JSON, so that clients can read it whatever
+		// they asked for. The encoding applies from the next message on.
+		enum ipc_encoding encoding = client->encoding;
+		client->encoding = IPC_ENCODING_JSON;
+		if (strcmp(buf, "json") == 0) {
+			encoding = IPC_ENCODING_JSON;
+		} else if (strcmp(buf, "cbor") == 0) {
+			encoding = IPC_ENCODING_CBOR;
+		} else {
+			const char msg[] = "{\"success\": false, "
+				"\"error\": \"Unknown encoding\"}";
+			ipc_send_reply(client, payload_type, msg, strlen(msg));
+			client->encoding = encoding;
+			goto exit_cleanup;
+		}
+		const char msg[] = "{\"success\": true}";
+		ipc_send_reply(client, payload_type, msg, strlen(msg));
+		client->encoding = encoding;
+		goto exit_cleanup;
+	}
+
 	default:
 		sway_log(SWAY_INFO, "Unknown IPC command type %x", payload_type);
 		goto exit_cleanup;
@@ -919,45 +1532,8 @@ bool ipc_send_reply(struct ipc_client *client, enum ipc_command_type payload_typ
 		const char *payload, uint32_t payload_length) {
 	assert(payload);
 
-	char data[IPC_HEADER_SIZE];
-	uint32_t *data32 = (uint32_t*)(data + sizeof(ipc_magic));
-
-	memcpy(data, ipc_magic, sizeof(ipc_magic));
-	memcpy(&data32[0], &payload_length, sizeof(payload_length));
-	memcpy(&data32[1], &payload_type, sizeof(payload_type));
-
-	while (client->write_buffer_len + IPC_HEADER_SIZE + payload_length >=
-				 client->write_buffer_size) {
-		client->write_buffer_size *= 2;
-	}
-
-	if (client->write_buffer_size > 4e6) { // 4 MB
-		sway_log(SWAY_ERROR, "Client write buffer too big (%zu), disconnecting client",
-				client->write_buffer_size);
-		ipc_client_disconnect(client);
-		return false;
-	}
-
-	char *new_buffer = realloc(client->write_buffer, client->write_buffer_size);
-	if (!new_buffer) {
-		sway_log(SWAY_ERROR, "Unable to reallocate ipc client write buffer");
-		ipc_client_disconnect(client);
-		return false;
-	}
-	client->write_buffer = new_buffer;
-
-	memcpy(client->write_buffer + client->write_buffer_len, data, IPC_HEADER_SIZE);
-	client->write_buffer_len += IPC_HEADER_SIZE;
-	memcpy(client->write_buffer + client->write_buffer_len, payload, payload_length);
-	client->write_buffer_len += payload_length;
-
-	if (!client->writable_event_source) {
-		client->writable_event_source = wl_event_loop_add_fd(
-				server.wl_event_loop, client->fd, WL_EVENT_WRITABLE,
-				ipc_client_handle_writable, client);
-	}
-
-	sway_log(SWAY_DEBUG, "Added IPC reply of type 0x%x to client %d queue: %s",
+	sway_log(SWAY_DEBUG, "Sending IPC reply of type 0x%x to client %d: %s",
 		payload_type, client->fd, payload);
-	return true;
+	return ipc_send_reply_owned(client, payload_type,
+			strndup(payload, payload_length), payload_length);
 }
@@ -15,8 +15,11 @@
 #include "sway/commands.h"
 #include "sway/config.h"
 #include "sway/server.h"
+#include "sway/startup_profile.h"
 #include "sway/swaynag.h"
+#include "sway/worker_pool.h"
 #include "sway/desktop/transaction.h"
+#include "sway/input/keyboard.h"
 #include "sway/tree/root.h"
 #include "sway/ipc-server.h"
 #include "ipc-client.h"
@@ -211,6 +214,8 @@ void enable_debug_flag(const char *flag) {
 		debug.damage = DAMAGE_RERENDER;
 	} else if (strcmp(flag, "noatomic") == 0) {
 		debug.noatomic = true;
+	} else if (strcmp(flag, "noocclusion") == 0) {
+		debug.noocclusion = true;
 	} else if (strcmp(flag, "txn-wait") == 0) {
 		debug.txn_wait = true;
 	} else if (strcmp(flag, "txn-timings") == 0) {
@@ -223,7 +228,8 @@ void enable_debug_flag(const char *flag) {
 }
 
 int main(int argc, char **argv) {
-	static int verbose = 0, debug = 0, validate = 0, allow_unsupported_gpu = 0;
+	static int verbose = 0, debug = 0, validate = 0, allow_unsupported_gpu = 0,
+		startup_profile = 0;
 
 	static struct option long_options[] = {
 		{"help", no_argument, NULL, 'h'},
@@ -233,6 +239,7 @@ int main(int argc, char **argv) {
 		{"version", no_argument, NULL, 'v'},
 		{"verbose", no_argument, NULL, 'V'},
 		{"get-socketpath", no_argument, NULL, 'p'},
+		{"startup-profile", no_argument, NULL, 'S'},
 		{"unsupported-gpu", no_argument, NULL, 'u'},
 		{"my-next-gpu-wont-be-nvidia", no_argument, NULL, 'u'},
 		{0, 0, 0, 0}
@@ -250,6 +257,7 @@ int main(int argc, char **argv) {
 		"  -v, --version          Show the version number and quit.\n"
 		"  -V, --verbose          Enables more verbose logging.\n"
 		"      --get-socketpath   Gets the IPC socket path and prints it, then exits.\n"
+		"      --startup-profile  Prints how long each startup phase took.\n"
 		"\n";
 
 	int c;
@@ -287,6 +295,9 @@ int main(int argc, char **argv) {
 		case 'V': // verbose
 			verbose = 1;
 			break;
+		case 'S': // --startup-profile
+			startup_profile = 1;
+			break;
 		case 'p': ; // --get-socketpath
 			if (getenv("SWAYSOCK")) {
 				fprintf(stdout, "%s\n", getenv("SWAYSOCK"));
@@ -355,6 +366,8 @@ int main(int argc, char **argv) {
 		return 0;
 	}
 
+	startup_profile_begin(startup_profile);
+
 	if (!server_privileged_prepare(&server)) {
 		return 1;
 	}
@@ -373,13 +386,21 @@ int main(int argc, char **argv) {
 	sway_log(SWAY_INFO, "Starting sway version " SWAY_VERSION);
 
 	root = root_create();
+	startup_phase_end(STARTUP_PHASE_PREPARE);
 
 	if (!server_init(&server)) {
 		return 1;
 	}
+	if (!worker_pool_init(server.wl_event_loop)) {
+		sway_log(SWAY_INFO, "Running without worker threads");
+	}
+	startup_phase_end(STARTUP_PHASE_SERVER_INIT);
 
 	if (validate) {
 		bool valid = load_main_config(config_path, false, true);
+		// Keymaps queued by the validation may still be compiling
+		worker_pool_finish();
+		sway_keyboard_clear_keymap_cache();
 		free(config_path);
 		return valid ? 0 : 1;
 	}
@@ -391,11 +412,13 @@ int main(int argc, char **argv) {
 		sway_terminate(EXIT_FAILURE);
 		goto shutdown;
 	}
+	startup_phase_end(STARTUP_PHASE_CONFIG);
 
 	if (!server_start(&server)) {
 		sway_terminate(EXIT_FAILURE);
 		goto shutdown;
 	}
+	startup_phase_end(STARTUP_PHASE_SERVER_START);
 
 	config->active = true;
 	load_swaybars();
@@ -406,18 +429,22 @@ int main(int argc, char **argv) {
 	if (config->swaynag_config_errors.client != NULL) {
 		swaynag_show(&config->swaynag_config_errors);
 	}
+	startup_phase_end(STARTUP_PHASE_CLIENTS);
 
 	server_run(&server);
 
 shutdown:
 	sway_log(SWAY_INFO, "Shutting down sway");
 
+	worker_pool_finish();
 	server_fini(&server);
 	root_destroy(root);
 	root = NULL;
 
 	free(config_path);
 	free_config(config);
+	config_file_cache_finish();
+	sway_keyboard_clear_keymap_cache();
 
 	pango_cairo_font_map_set_default(NULL);
 
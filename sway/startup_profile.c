@@ -0,0 +1,69 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <time.h>
+#include "sway/startup_profile.h"
+
+static struct {
+	struct timespec begin;
+	struct timespec end[STARTUP_PHASE_COUNT];
+	int ended; // number of phases which ended
+	bool print;
+} profile;
+
+static const char *phase_names[] = {
+	[STARTUP_PHASE_PREPARE] = "prepare",
+	[STARTUP_PHASE_SERVER_INIT] = "server_init",
+	[STARTUP_PHASE_CONFIG] = "config",
+	[STARTUP_PHASE_SERVER_START] = "server_start",
+	[STARTUP_PHASE_CLIENTS] = "clients",
+	[STARTUP_PHASE_FIRST_FRAME] = "first_frame",
+};
+
+static int64_t timespec_to_usec(const struct timespec *ts) {
+	return (int64_t)ts->tv_sec * 1000000 + ts->tv_nsec / 1000;
+}
+
+static void print_profile(void) {
+	fprintf(stderr, "Startup profile:\n");
+	for (int i = 0; i < STARTUP_PHASE_COUNT; ++i) {
+		int64_t usec = startup_phase_duration_usec(i);
+		fprintf(stderr, "  %-14s %8.3f ms\n", phase_names[i], usec / 1000.0);
+	}
+	int64_t total = timespec_to_usec(&profile.end[STARTUP_PHASE_COUNT - 1]) -
+		timespec_to_usec(&profile.begin);
+	fprintf(stderr, "  %-14s %8.3f ms\n", "total", total / 1000.0);
+}
+
+void startup_profile_begin(bool print) {
+	clock_gettime(CLOCK_MONOTONIC, &profile.begin);
+	profile.ended = 0;
+	profile.print = print;
+}
+
+void startup_phase_end(enum startup_phase phase) {
+	if ((int)phase != profile.ended) {
+		return;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &profile.end[phase]);
+	profile.ended++;
+	if (profile.print && startup_profile_complete()) {
+		print_profile();
+	}
+}
+
+bool startup_profile_complete(void) {
+	return profile.ended == STARTUP_PHASE_COUNT;
+}
+
+const char *startup_phase_name(enum startup_phase phase) {
+	return phase_names[phase];
+}
+
+int64_t startup_phase_duration_usec(enum startup_phase phase) {
+	if ((int)phase >= profile.ended) {
+		return -1;
+	}
+	const struct timespec *begin =
+		phase == 0 ? &profile.begin : &profile.end[phase - 1];
+	return timespec_to_usec(&profile.end[phase]) - timespec_to_usec(begin);
+}
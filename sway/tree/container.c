@@ -6,10 +6,10 @@
 #include <strings.h>
 #include <wayland-server-core.h>
 #include <wlr/types/wlr_output_layout.h>
-#include "cairo.h"
 #include "pango.h"
 #include "sway/config.h"
 #include "sway/desktop.h"
+#include "sway/desktop/text_atlas.h"
 #include "sway/desktop/transaction.h"
 #include "sway/input/input-manager.h"
 #include "sway/input/seat.h"
@@ -17,6 +17,7 @@
 #include "sway/output.h"
 #include "sway/server.h"
 #include "sway/tree/arrange.h"
+#include "sway/tree/hit_index.h"
 #include "sway/tree/view.h"
 #include "sway/tree/workspace.h"
 #include "list.h"
@@ -40,6 +41,8 @@ struct sway_container *container_create(struct sway_view *view) {
 	}
 	c->marks = create_list();
 	c->outputs = create_list();
+	c->title_textures_dirty = ~0u;
+	c->marks_textures_dirty = ~0u;
 
 	wl_signal_init(&c->events.destroy);
 	wl_signal_emit(&root->events.new_node, &c->node);
@@ -58,19 +61,20 @@ void container_destroy(struct sway_container *con) {
 	}
 	free(con->title);
 	free(con->formatted_title);
-	wlr_texture_destroy(con->title_focused);
-	wlr_texture_destroy(con->title_focused_inactive);
-	wlr_texture_destroy(con->title_unfocused);
-	wlr_texture_destroy(con->title_urgent);
+	free(con->node.json_cache);
+	text_atlas_release(con->title_focused);
+	text_atlas_release(con->title_focused_inactive);
+	text_atlas_release(con->title_unfocused);
+	text_atlas_release(con->title_urgent);
 	list_free(con->children);
 	list_free(con->current.children);
 	list_free(con->outputs);
 
 	list_free_items_and_destroy(con->marks);
-	wlr_texture_destroy(con->marks_focused);
-	wlr_texture_destroy(con->marks_focused_inactive);
-	wlr_texture_destroy(con->marks_unfocused);
-	wlr_texture_destroy(con->marks_urgent);
+	text_atlas_release(con->marks_focused);
+	text_atlas_release(con->marks_focused_inactive);
+	text_atlas_release(con->marks_unfocused);
+	text_atlas_release(con->marks_urgent);
 
 	if (con->view) {
 		if (con->view->container == con) {
@@ -84,6 +88,12 @@ void container_destroy(struct sway_container *con) {
 	free(con);
 }
 
+static void unindex_mark(struct sway_container *con, char *mark) {
+	if (hash_table_get(root->marks, mark) == con) {
+		hash_table_remove(root->marks, mark);
+	}
+}
+
 void container_begin_destroy(struct sway_container *con) {
 	if (con->view) {
 		ipc_event_window(con, "close");
@@ -103,6 +113,11 @@ void container_begin_destroy(struct sway_container *con) {
 
 	con->node.destroying = true;
 	node_set_dirty(&con->node);
+	node_record_removal(&con->node);
+
+	for (int i = 0; i < con->marks->length; ++i) {
+		unindex_mark(con, con->marks->items[i]);
+	}
 
 	if (con->scratchpad) {
 		root_scratchpad_remove_container(con);
@@ -283,33 +298,6 @@ static struct sway_container *container_at_linear(struct sway_node *parent,
 	return NULL;
 }
 
-static struct sway_container *floating_container_at(double lx, double ly,
-		struct wlr_surface **surface, double *sx, double *sy) {
-	// For outputs with floating containers that overhang the output bounds,
-	// those at the end of the output list appear on top of floating
-	// containers from other outputs, so iterate the list in reverse.
-	for (int i = root->outputs->length - 1; i >= 0; --i) {
-		struct sway_output *output = root->outputs->items[i];
-		for (int j = 0; j < output->workspaces->length; ++j) {
-			struct sway_workspace *ws = output->workspaces->items[j];
-			if (!workspace_is_visible(ws)) {
-				continue;
-			}
-			// Items at the end of the list are on top, so iterate the list in
-			// reverse.
-			for (int k = ws->floating->length - 1; k >= 0; --k) {
-				struct sway_container *floater = ws->floating->items[k];
-				struct sway_container *container =
-					tiling_container_at(&floater->node, lx, ly, surface, sx, sy);
-				if (container) {
-					return container;
-				}
-			}
-		}
-	}
-	return NULL;
-}
-
 struct sway_container *view_container_at(struct sway_node *parent,
 		double lx, double ly,
 		struct wlr_surface **surface, double *sx, double *sy) {
@@ -389,7 +377,7 @@ struct sway_container *container_at(struct sway_workspace *workspace,
 		*surface = NULL;
 	}
 	// Floating
-	if ((c = floating_container_at(lx, ly, surface ,sx ,sy))) {
+	if ((c = hit_index_floating_at(lx, ly, surface, sx, sy))) {
 		return c;
 	}
 	// Tiling (focused)
@@ -399,7 +387,7 @@ struct sway_container *container_at(struct sway_workspace *workspace,
 		}
 	}
 	// Tiling (non-focused)
-	if ((c = tiling_container_at(&workspace->node, lx, ly, surface, sx, sy))) {
+	if ((c = hit_index_tiling_at(workspace, lx, ly, surface, sx, sy))) {
 		return c;
 	}
 	return NULL;
@@ -447,85 +435,111 @@ struct sway_output *container_get_effective_output(struct sway_container *con) {
 }
 
 static void update_title_texture(struct sway_container *con,
-		struct wlr_texture **texture, struct border_colors *class) {
+		struct sway_text_atlas_entry **texture, struct border_colors *class) {
 	struct sway_output *output = container_get_effective_output(con);
 	if (!output) {
 		return;
 	}
-	if (*texture) {
-		wlr_texture_destroy(*texture);
-		*texture = NULL;
-	}
-	if (!con->formatted_title) {
-		return;
+	struct sway_text_atlas_entry *old = *texture;
+	*texture = NULL;
+	if (con->formatted_title) {
+		double scale = output->wlr_output->scale;
+		struct text_atlas_params params = {
+			.text = con->formatted_title,
+			.font = config->font,
+			.markup = config->pango_markup,
+			.scale = scale,
+			.height = con->title_height * scale,
+			.subpixel = output->wlr_output->subpixel,
+			.background = class->background,
+			.foreground = class->text,
+		};
+		struct wlr_renderer *renderer = wlr_backend_get_renderer(
+				output->wlr_output->backend);
+		*texture = text_atlas_acquire(renderer, &params);
+	}
+	// Released after acquiring so that an unchanged title keeps its entry
+	text_atlas_release(old);
+}
+
+static int border_class_index(struct border_colors *class) {
+	if (class == &config->border_colors.focused) {
+		return 0;
+	} else if (class == &config->border_colors.focused_inactive) {
+		return 1;
+	} else if (class == &config->border_colors.unfocused) {
+		return 2;
+	} else if (class == &config->border_colors.urgent) {
+		return 3;
+	}
+	return -1;
+}
+
+static struct sway_text_atlas_entry **get_title_texture_slot(
+		struct sway_container *con, int index) {
+	struct sway_text_atlas_entry **slots[] = {
+		&con->title_focused,
+		&con->title_focused_inactive,
+		&con->title_unfocused,
+		&con->title_urgent,
+	};
+	return slots[index];
+}
+
+static struct sway_text_atlas_entry **get_marks_texture_slot(
+		struct sway_container *con, int index) {
+	struct sway_text_atlas_entry **slots[] = {
+		&con->marks_focused,
+		&con->marks_focused_inactive,
+		&con->marks_unfocused,
+		&con->marks_urgent,
+	};
+	return slots[index];
+}
+
+static void release_title_textures(struct sway_container *con) {
+	for (int i = 0; i < 4; ++i) {
+		struct sway_text_atlas_entry **slot = get_title_texture_slot(con, i);
+		text_atlas_release(*slot);
+		*slot = NULL;
 	}
+	con->title_textures_dirty = ~0u;
+}
 
-	double scale = output->wlr_output->scale;
-	int width = 0;
-	int height = con->title_height * scale;
-
-	// We must use a non-nil cairo_t for cairo_set_font_options to work.
-	// Therefore, we cannot use cairo_create(NULL).
-	cairo_surface_t *dummy_surface = cairo_image_surface_create(
-			CAIRO_FORMAT_ARGB32, 0, 0);
-	cairo_t *c = cairo_create(dummy_surface);
-	cairo_set_antialias(c, CAIRO_ANTIALIAS_BEST);
-	cairo_font_options_t *fo = cairo_font_options_create();
-	cairo_font_options_set_hint_style(fo, CAIRO_HINT_STYLE_FULL);
-	if (output->wlr_output->subpixel == WL_OUTPUT_SUBPIXEL_NONE) {
-		cairo_font_options_set_antialias(fo, CAIRO_ANTIALIAS_GRAY);
-	} else {
-		cairo_font_options_set_antialias(fo, CAIRO_ANTIALIAS_SUBPIXEL);
-		cairo_font_options_set_subpixel_order(fo,
-			to_cairo_subpixel_order(output->wlr_output->subpixel));
-	}
-	cairo_set_font_options(c, fo);
-	get_text_size(c, config->font, &width, NULL, NULL, scale,
-			config->pango_markup, "%s", con->formatted_title);
-	cairo_surface_destroy(dummy_surface);
-	cairo_destroy(c);
-
-	cairo_surface_t *surface = cairo_image_surface_create(
-			CAIRO_FORMAT_ARGB32, width, height);
-	cairo_t *cairo = cairo_create(surface);
-	cairo_set_antialias(cairo, CAIRO_ANTIALIAS_BEST);
-	cairo_set_font_options(cairo, fo);
-	cairo_font_options_destroy(fo);
-	cairo_set_source_rgba(cairo, class->background[0], class->background[1],
-			class->background[2], class->background[3]);
-	cairo_paint(cairo);
-	PangoContext *pango = pango_cairo_create_context(cairo);
-	cairo_set_source_rgba(cairo, class->text[0], class->text[1],
-			class->text[2], class->text[3]);
-	cairo_move_to(cairo, 0, 0);
-
-	pango_printf(cairo, config->font, scale, config->pango_markup,
-			"%s", con->formatted_title);
-
-	cairo_surface_flush(surface);
-	unsigned char *data = cairo_image_surface_get_data(surface);
-	int stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, width);
-	struct wlr_renderer *renderer = wlr_backend_get_renderer(
-			output->wlr_output->backend);
-	*texture = wlr_texture_from_pixels(
-			renderer, WL_SHM_FORMAT_ARGB8888, stride, width, height, data);
-	cairo_surface_destroy(surface);
-	g_object_unref(pango);
-	cairo_destroy(cairo);
+static void release_marks_textures(struct sway_container *con) {
+	for (int i = 0; i < 4; ++i) {
+		struct sway_text_atlas_entry **slot = get_marks_texture_slot(con, i);
+		text_atlas_release(*slot);
+		*slot = NULL;
+	}
+	con->marks_textures_dirty = ~0u;
 }
 
 void container_update_title_textures(struct sway_container *container) {
-	update_title_texture(container, &container->title_focused,
-			&config->border_colors.focused);
-	update_title_texture(container, &container->title_focused_inactive,
-			&config->border_colors.focused_inactive);
-	update_title_texture(container, &container->title_unfocused,
-			&config->border_colors.unfocused);
-	update_title_texture(container, &container->title_urgent,
-			&config->border_colors.urgent);
+	// The entries are kept until they are rasterized again, so that an
+	// unchanged title doesn't lose its atlas entry
+	container->title_textures_dirty = ~0u;
 	container_damage_whole(container);
 }
 
+struct sway_text_atlas_entry *container_get_title_texture(
+		struct sway_container *container, struct border_colors *class) {
+	int index = border_class_index(class);
+	if (index == -1 || (container->title_textures_dirty & (1u << index))) {
+		return NULL;
+	}
+	return *get_title_texture_slot(container, index);
+}
+
+struct sway_text_atlas_entry *container_get_marks_texture(
+		struct sway_container *container, struct border_colors *class) {
+	int index = border_class_index(class);
+	if (index == -1 || (container->marks_textures_dirty & (1u << index))) {
+		return NULL;
+	}
+	return *get_marks_texture_slot(container, index);
+}
+
 void container_calculate_title_height(struct sway_container *container) {
 	if (!container->formatted_title) {
 		container->title_height = 0;
@@ -1258,6 +1272,7 @@ void container_insert_child(struct sway_container *parent,
 	child->parent = parent;
 	child->workspace = parent->workspace;
 	container_for_each_child(child, set_workspace, NULL);
+	input_manager_invalidate_focus_index(&parent->node);
 	container_handle_fullscreen_reparent(child);
 	container_update_representation(parent);
 }
@@ -1273,6 +1288,7 @@ void container_add_sibling(struct sway_container *fixed,
 	active->parent = fixed->parent;
 	active->workspace = fixed->workspace;
 	container_for_each_child(active, set_workspace, NULL);
+	input_manager_invalidate_focus_index(node_get_parent(&active->node));
 	container_handle_fullscreen_reparent(active);
 	container_update_representation(active);
 }
@@ -1286,6 +1302,7 @@ void container_add_child(struct sway_container *parent,
 	child->parent = parent;
 	child->workspace = parent->workspace;
 	container_for_each_child(child, set_workspace, NULL);
+	input_manager_invalidate_focus_index(&parent->node);
 	bool fullscreen = child->fullscreen_mode != FULLSCREEN_NONE ||
 		parent->fullscreen_mode != FULLSCREEN_NONE;
 	set_fullscreen_iterator(child, &fullscreen);
@@ -1318,9 +1335,11 @@ void container_detach(struct sway_container *child) {
 	container_for_each_child(child, set_workspace, NULL);
 
 	if (old_parent) {
+		input_manager_invalidate_focus_index(&old_parent->node);
 		container_update_representation(old_parent);
 		node_set_dirty(&old_parent->node);
 	} else if (old_workspace) {
+		input_manager_invalidate_focus_index(&old_workspace->node);
 		workspace_update_representation(old_workspace);
 		node_set_dirty(&old_workspace->node);
 	}
@@ -1400,18 +1419,12 @@ bool container_is_transient_for(struct sway_container *child,
 		view_is_transient_for(child->view, ancestor->view);
 }
 
-static bool find_by_mark_iterator(struct sway_container *con, void *data) {
-	char *mark = data;
-	return container_has_mark(con, mark);
-}
-
 struct sway_container *container_find_mark(char *mark) {
-	return root_find_container(find_by_mark_iterator, mark);
+	return hash_table_get(root->marks, mark);
 }
 
 bool container_find_and_unmark(char *mark) {
-	struct sway_container *con = root_find_container(
-		find_by_mark_iterator, mark);
+	struct sway_container *con = container_find_mark(mark);
 	if (!con) {
 		return false;
 	}
@@ -1419,6 +1432,7 @@ bool container_find_and_unmark(char *mark) {
 	for (int i = 0; i < con->marks->length; ++i) {
 		char *con_mark = con->marks->items[i];
 		if (strcmp(con_mark, mark) == 0) {
+			unindex_mark(con, con_mark);
 			free(con_mark);
 			list_del(con->marks, i);
 			container_update_marks_textures(con);
@@ -1431,6 +1445,7 @@ bool container_find_and_unmark(char *mark) {
 
 void container_clear_marks(struct sway_container *con) {
 	for (int i = 0; i < con->marks->length; ++i) {
+		unindex_mark(con, con->marks->items[i]);
 		free(con->marks->items[i]);
 	}
 	con->marks->length = 0;
@@ -1449,20 +1464,20 @@ bool container_has_mark(struct sway_container *con, char *mark) {
 
 void container_add_mark(struct sway_container *con, char *mark) {
 	list_add(con->marks, strdup(mark));
+	hash_table_set(root->marks, mark, con);
 	ipc_event_window(con, "mark");
 }
 
 static void update_marks_texture(struct sway_container *con,
-		struct wlr_texture **texture, struct border_colors *class) {
+		struct sway_text_atlas_entry **texture, struct border_colors *class) {
 	struct sway_output *output = container_get_effective_output(con);
 	if (!output) {
 		return;
 	}
-	if (*texture) {
-		wlr_texture_destroy(*texture);
-		*texture = NULL;
-	}
+	struct sway_text_atlas_entry *old = *texture;
+	*texture = NULL;
 	if (!con->marks->length) {
+		text_atlas_release(old);
 		return;
 	}
 
@@ -1478,6 +1493,7 @@ static void update_marks_texture(struct sway_container *con,
 
 	if (!sway_assert(buffer && part, "Unable to allocate memory")) {
 		free(buffer);
+		text_atlas_release(old);
 		return;
 	}
 
@@ -1491,56 +1507,55 @@ static void update_marks_texture(struct sway_container *con,
 	free(part);
 
 	double scale = output->wlr_output->scale;
-	int width = 0;
-	int height = con->title_height * scale;
-
-	cairo_t *c = cairo_create(NULL);
-	get_text_size(c, config->font, &width, NULL, NULL, scale, false,
-			"%s", buffer);
-	cairo_destroy(c);
-
-	cairo_surface_t *surface = cairo_image_surface_create(
-			CAIRO_FORMAT_ARGB32, width, height);
-	cairo_t *cairo = cairo_create(surface);
-	cairo_set_source_rgba(cairo, class->background[0], class->background[1],
-			class->background[2], class->background[3]);
-	cairo_paint(cairo);
-	PangoContext *pango = pango_cairo_create_context(cairo);
-	cairo_set_antialias(cairo, CAIRO_ANTIALIAS_BEST);
-	cairo_set_source_rgba(cairo, class->text[0], class->text[1],
-			class->text[2], class->text[3]);
-	cairo_move_to(cairo, 0, 0);
-
-	pango_printf(cairo, config->font, scale, false, "%s", buffer);
-
-	cairo_surface_flush(surface);
-	unsigned char *data = cairo_image_surface_get_data(surface);
-	int stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, width);
+	struct text_atlas_params params = {
+		.text = buffer,
+		.font = config->font,
+		.markup = false,
+		.scale = scale,
+		.height = con->title_height * scale,
+		.subpixel = output->wlr_output->subpixel,
+		.background = class->background,
+		.foreground = class->text,
+	};
 	struct wlr_renderer *renderer = wlr_backend_get_renderer(
 			output->wlr_output->backend);
-	*texture = wlr_texture_from_pixels(
-			renderer, WL_SHM_FORMAT_ARGB8888, stride, width, height, data);
-	cairo_surface_destroy(surface);
-	g_object_unref(pango);
-	cairo_destroy(cairo);
+	*texture = text_atlas_acquire(renderer, &params);
 	free(buffer);
+	text_atlas_release(old);
 }
 
 void container_update_marks_textures(struct sway_container *con) {
 	if (!config->show_marks) {
 		return;
 	}
-	update_marks_texture(con, &con->marks_focused,
-			&config->border_colors.focused);
-	update_marks_texture(con, &con->marks_focused_inactive,
-			&config->border_colors.focused_inactive);
-	update_marks_texture(con, &con->marks_unfocused,
-			&config->border_colors.unfocused);
-	update_marks_texture(con, &con->marks_urgent,
-			&config->border_colors.urgent);
+	con->marks_textures_dirty = ~0u;
 	container_damage_whole(con);
 }
 
+void container_prepare_titlebar_textures(struct sway_container *container,
+		struct border_colors *class) {
+	int index = border_class_index(class);
+	if (index == -1 || !container_get_effective_output(container)) {
+		return;
+	}
+	uint32_t bit = 1u << index;
+	if (container->title_textures_dirty & bit) {
+		update_title_texture(container,
+				get_title_texture_slot(container, index), class);
+		container->title_textures_dirty &= ~bit;
+	}
+	if (config->show_marks && (container->marks_textures_dirty & bit)) {
+		update_marks_texture(container,
+				get_marks_texture_slot(container, index), class);
+		container->marks_textures_dirty &= ~bit;
+	}
+}
+
+void container_release_titlebar_textures(struct sway_container *container) {
+	release_title_textures(container);
+	release_marks_textures(container);
+}
+
 void container_raise_floating(struct sway_container *con) {
 	// Bring container to front by putting it at the end of the floating list.
 	struct sway_container *floater = container_toplevel_ancestor(con);
@@ -0,0 +1,336 @@
+#define _POSIX_C_SOURCE 200809L
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sway/output.h"
+#include "sway/tree/container.h"
+#include "sway/tree/hit_index.h"
+#include "sway/tree/root.h"
+#include "sway/tree/view.h"
+#include "sway/tree/workspace.h"
+#include "list.h"
+#include "log.h"
+
+// The grid never has more than this many cells in each direction
+#define HIT_GRID_MAX_CELLS 64
+#define HIT_CELL_MIN_SIZE 64
+
+static uint64_t hit_index_generation = 1;
+
+void hit_index_invalidate(void) {
+	++hit_index_generation;
+}
+
+void hit_index_destroy(struct sway_hit_index *index) {
+	if (!index) {
+		return;
+	}
+	free(index->entries);
+	free(index->cell_start);
+	free(index->cell_entries);
+	free(index);
+}
+
+static struct sway_hit_index *hit_index_create(void) {
+	struct sway_hit_index *index = calloc(1, sizeof(struct sway_hit_index));
+	if (!sway_assert(index, "Unable to allocate hit index")) {
+		return NULL;
+	}
+	index->last_hit = -1;
+	return index;
+}
+
+static bool ensure_capacity(void **data, int *capacity, int needed,
+		size_t size) {
+	if (needed <= *capacity) {
+		return true;
+	}
+	int new_capacity = *capacity ? *capacity : 16;
+	while (new_capacity < needed) {
+		new_capacity *= 2;
+	}
+	void *new_data = realloc(*data, new_capacity * size);
+	if (!new_data) {
+		return false;
+	}
+	*data = new_data;
+	*capacity = new_capacity;
+	return true;
+}
+
+static void add_entry(struct sway_hit_index *index, struct sway_node *node,
+		bool is_view) {
+	if (!ensure_capacity((void **)&index->entries, &index->capacity,
+				index->length + 1, sizeof(struct sway_hit_entry))) {
+		return;
+	}
+	struct sway_hit_entry *entry = &index->entries[index->length++];
+	entry->node = node;
+	entry->is_view = is_view;
+	entry->overlaps_earlier = false;
+	if (is_view) {
+		struct sway_container *con = node->sway_container;
+		entry->box.x = con->x;
+		entry->box.y = con->y;
+		entry->box.width = con->width;
+		entry->box.height = con->height;
+	} else {
+		node_get_box(node, &entry->box);
+	}
+}
+
+/**
+ * Mirrors tiling_container_at(): linear layouts return the first child which
+ * contains the point, so their children are flattened in order. Tabbed and
+ * stacked containers are kept as a single entry.
+ */
+static void add_tiling_node(struct sway_hit_index *index,
+		struct sway_node *node) {
+	if (node_is_view(node)) {
+		add_entry(index, node, true);
+		return;
+	}
+	list_t *children = node_get_children(node);
+	if (!children) {
+		return;
+	}
+	switch (node_get_layout(node)) {
+	case L_HORIZ:
+	case L_VERT:
+		for (int i = 0; i < children->length; ++i) {
+			struct sway_container *child = children->items[i];
+			add_tiling_node(index, &child->node);
+		}
+		break;
+	case L_TABBED:
+	case L_STACKED:
+		add_entry(index, node, false);
+		break;
+	case L_NONE:
+		break;
+	}
+}
+
+static int cell_coord(struct sway_hit_index *index, double value, int origin,
+		int max) {
+	int cell = floor((value - origin) / index->cell_size);
+	return cell < 0 ? 0 : (cell >= max ? max - 1 : cell);
+}
+
+/**
+ * Whether the interiors of the boxes intersect. Boxes which only share an
+ * edge, such as neighbouring tiled views, don't overlap.
+ */
+static bool boxes_overlap(struct wlr_box *a, struct wlr_box *b) {
+	return a->x < b->x + b->width && b->x < a->x + a->width &&
+		a->y < b->y + b->height && b->y < a->y + a->height;
+}
+
+static void build_grid(struct sway_hit_index *index) {
+	index->cols = index->rows = 0;
+	if (!index->length) {
+		return;
+	}
+	int x1 = INT32_MAX, y1 = INT32_MAX, x2 = INT32_MIN, y2 = INT32_MIN;
+	for (int i = 0; i < index->length; ++i) {
+		struct wlr_box *box = &index->entries[i].box;
+		x1 = box->x < x1 ? box->x : x1;
+		y1 = box->y < y1 ? box->y : y1;
+		x2 = box->x + box->width > x2 ? box->x + box->width : x2;
+		y2 = box->y + box->height > y2 ? box->y + box->height : y2;
+	}
+	// Boxes are inclusive, so the grid has to cover x2 and y2 as well
+	int width = x2 - x1 + 1, height = y2 - y1 + 1;
+	int size = width > height ? width : height;
+	index->cell_size = (size + HIT_GRID_MAX_CELLS - 1) / HIT_GRID_MAX_CELLS;
+	if (index->cell_size < HIT_CELL_MIN_SIZE) {
+		index->cell_size = HIT_CELL_MIN_SIZE;
+	}
+	index->x = x1;
+	index->y = y1;
+	index->cols = (width + index->cell_size - 1) / index->cell_size;
+	index->rows = (height + index->cell_size - 1) / index->cell_size;
+	int ncells = index->cols * index->rows;
+
+	if (!ensure_capacity((void **)&index->cell_start,
+				&index->cell_start_capacity, ncells + 1, sizeof(int))) {
+		index->cols = index->rows = 0;
+		return;
+	}
+	memset(index->cell_start, 0, (ncells + 1) * sizeof(int));
+
+	// Count the entries per cell, then fill them in, in entry order
+	for (int pass = 0; pass < 2; ++pass) {
+		for (int i = 0; i < index->length; ++i) {
+			struct wlr_box *box = &index->entries[i].box;
+			int cx1 = cell_coord(index, box->x, index->x, index->cols);
+			int cx2 = cell_coord(index, box->x + box->width,
+					index->x, index->cols);
+			int cy1 = cell_coord(index, box->y, index->y, index->rows);
+			int cy2 = cell_coord(index, box->y + box->height,
+					index->y, index->rows);
+			for (int cy = cy1; cy <= cy2; ++cy) {
+				for (int cx = cx1; cx <= cx2; ++cx) {
+					int cell = cy * index->cols + cx;
+					if (pass == 0) {
+						++index->cell_start[cell + 1];
+					} else {
+						index->cell_entries[index->cell_start[cell]++] = i;
+					}
+				}
+			}
+		}
+		if (pass == 0) {
+			for (int cell = 0; cell < ncells; ++cell) {
+				index->cell_start[cell + 1] += index->cell_start[cell];
+			}
+			if (!ensure_capacity((void **)&index->cell_entries,
+						&index->cell_entries_capacity,
+						index->cell_start[ncells], sizeof(int))) {
+				index->cols = index->rows = 0;
+				return;
+			}
+		}
+	}
+	// Filling advanced each cell's start to its end, which is the start of
+	// the next cell
+	for (int cell = ncells; cell > 0; --cell) {
+		index->cell_start[cell] = index->cell_start[cell - 1];
+	}
+	index->cell_start[0] = 0;
+
+	// Entries which overlap share a cell
+	for (int cell = 0; cell < ncells; ++cell) {
+		int first = index->cell_start[cell], end = index->cell_start[cell + 1];
+		for (int i = first + 1; i < end; ++i) {
+			struct sway_hit_entry *entry =
+				&index->entries[index->cell_entries[i]];
+			for (int j = first; j < i && !entry->overlaps_earlier; ++j) {
+				struct sway_hit_entry *earlier =
+					&index->entries[index->cell_entries[j]];
+				if (boxes_overlap(&earlier->box, &entry->box)) {
+					entry->overlaps_earlier = true;
+				}
+			}
+		}
+	}
+}
+
+static struct sway_container *entry_at(struct sway_hit_entry *entry,
+		double lx, double ly,
+		struct wlr_surface **surface, double *sx, double *sy) {
+	if (entry->is_view) {
+		return view_container_at(entry->node, lx, ly, surface, sx, sy);
+	}
+	return tiling_container_at(entry->node, lx, ly, surface, sx, sy);
+}
+
+static bool entry_contains(struct sway_hit_entry *entry, double lx, double ly) {
+	struct wlr_box *box = &entry->box;
+	return lx >= box->x && lx <= box->x + box->width &&
+		ly >= box->y && ly <= box->y + box->height;
+}
+
+/**
+ * Whether the point lies strictly inside the entry. Points on an edge may be
+ * contained by a neighbouring entry as well, which takes precedence if it
+ * comes first.
+ */
+static bool entry_interior_contains(struct sway_hit_entry *entry,
+		double lx, double ly) {
+	struct wlr_box *box = &entry->box;
+	return lx > box->x && lx < box->x + box->width &&
+		ly > box->y && ly < box->y + box->height;
+}
+
+static struct sway_container *hit_index_at(struct sway_hit_index *index,
+		double lx, double ly,
+		struct wlr_surface **surface, double *sx, double *sy) {
+	struct sway_container *con;
+	// Fast path: the pointer usually stays within the previous hit, which
+	// can be evaluated directly unless an earlier entry overlaps it
+	if (index->last_hit >= 0 && index->last_hit < index->length) {
+		struct sway_hit_entry *entry = &index->entries[index->last_hit];
+		if (!entry->overlaps_earlier &&
+				entry_interior_contains(entry, lx, ly) &&
+				(con = entry_at(entry, lx, ly, surface, sx, sy))) {
+			return con;
+		}
+	}
+
+	if (!index->cols || lx < index->x || ly < index->y) {
+		return NULL;
+	}
+	int cx = (lx - index->x) / index->cell_size;
+	int cy = (ly - index->y) / index->cell_size;
+	if (cx >= index->cols || cy >= index->rows) {
+		return NULL;
+	}
+	int cell = cy * index->cols + cx;
+	for (int i = index->cell_start[cell]; i < index->cell_start[cell + 1]; ++i) {
+		int entry = index->cell_entries[i];
+		if (!entry_contains(&index->entries[entry], lx, ly)) {
+			continue;
+		}
+		if ((con = entry_at(&index->entries[entry], lx, ly, surface, sx, sy))) {
+			index->last_hit = entry;
+			return con;
+		}
+	}
+	return NULL;
+}
+
+static bool hit_index_prepare(struct sway_hit_index **index) {
+	if (!*index && !(*index = hit_index_create())) {
+		return false;
+	}
+	if ((*index)->generation == hit_index_generation) {
+		return false;
+	}
+	(*index)->generation = hit_index_generation;
+	(*index)->length = 0;
+	(*index)->last_hit = -1;
+	return true;
+}
+
+struct sway_container *hit_index_tiling_at(struct sway_workspace *ws,
+		double lx, double ly,
+		struct wlr_surface **surface, double *sx, double *sy) {
+	if (hit_index_prepare(&ws->hit_index)) {
+		add_tiling_node(ws->hit_index, &ws->node);
+		build_grid(ws->hit_index);
+	}
+	if (!ws->hit_index) {
+		return tiling_container_at(&ws->node, lx, ly, surface, sx, sy);
+	}
+	return hit_index_at(ws->hit_index, lx, ly, surface, sx, sy);
+}
+
+struct sway_container *hit_index_floating_at(double lx, double ly,
+		struct wlr_surface **surface, double *sx, double *sy) {
+	if (hit_index_prepare(&root->floating_hit_index)) {
+		struct sway_hit_index *index = root->floating_hit_index;
+		// For outputs with floating containers that overhang the output
+		// bounds, those at the end of the output list appear on top of
+		// floating containers from other outputs, so add them first.
+		for (int i = root->outputs->length - 1; i >= 0; --i) {
+			struct sway_output *output = root->outputs->items[i];
+			for (int j = 0; j < output->workspaces->length; ++j) {
+				struct sway_workspace *ws = output->workspaces->items[j];
+				if (!workspace_is_visible(ws)) {
+					continue;
+				}
+				// Items at the end of the list are on top
+				for (int k = ws->floating->length - 1; k >= 0; --k) {
+					struct sway_container *floater = ws->floating->items[k];
+					add_tiling_node(index, &floater->node);
+				}
+			}
+		}
+		build_grid(index);
+	}
+	if (!root->floating_hit_index) {
+		return NULL;
+	}
+	return hit_index_at(root->floating_hit_index, lx, ly, surface, sx, sy);
+}
@@ -2,16 +2,31 @@
 #include "sway/output.h"
 #include "sway/server.h"
 #include "sway/tree/container.h"
+#include "sway/tree/hit_index.h"
 #include "sway/tree/node.h"
 #include "sway/tree/root.h"
 #include "sway/tree/workspace.h"
 #include "log.h"
 
+#define NODE_REMOVAL_LOG_SIZE 1024
+
+static uint64_t current_generation = 0;
+
+static struct {
+	size_t id;
+	uint64_t generation;
+} removal_log[NODE_REMOVAL_LOG_SIZE];
+static size_t removal_log_head = 0, removal_log_length = 0;
+// The newest generation which has been pushed out of the removal log
+static uint64_t removal_log_evicted = 0;
+
 void node_init(struct sway_node *node, enum sway_node_type type, void *thing) {
 	static size_t next_id = 1;
 	node->id = next_id++;
 	node->type = type;
 	node->sway_root = thing;
+	node->generation = ++current_generation;
+	wl_list_init(&node->seat_nodes);
 	wl_signal_init(&node->events.destroy);
 }
 
@@ -30,6 +45,8 @@ const char *node_type_to_str(enum sway_node_type type) {
 }
 
 void node_set_dirty(struct sway_node *node) {
+	node_bump_generation(node);
+	hit_index_invalidate();
 	if (node->dirty) {
 		return;
 	}
@@ -37,6 +54,41 @@ void node_set_dirty(struct sway_node *node) {
 	list_add(server.dirty_nodes, node);
 }
 
+void node_bump_generation(struct sway_node *node) {
+	node->generation = ++current_generation;
+}
+
+uint64_t node_get_current_generation(void) {
+	return current_generation;
+}
+
+void node_record_removal(struct sway_node *node) {
+	if (removal_log_length == NODE_REMOVAL_LOG_SIZE) {
+		removal_log_evicted = removal_log[removal_log_head].generation;
+	} else {
+		++removal_log_length;
+	}
+	removal_log[removal_log_head].id = node->id;
+	removal_log[removal_log_head].generation = ++current_generation;
+	removal_log_head = (removal_log_head + 1) % NODE_REMOVAL_LOG_SIZE;
+}
+
+bool node_for_each_removal_since(uint64_t generation,
+		void (*f)(size_t id, void *data), void *data) {
+	if (generation < removal_log_evicted) {
+		return false;
+	}
+	size_t start = (removal_log_head + NODE_REMOVAL_LOG_SIZE
+			- removal_log_length) % NODE_REMOVAL_LOG_SIZE;
+	for (size_t i = 0; i < removal_log_length; ++i) {
+		size_t index = (start + i) % NODE_REMOVAL_LOG_SIZE;
+		if (removal_log[index].generation > generation) {
+			f(removal_log[index].id, data);
+		}
+	}
+	return true;
+}
+
 bool node_is_view(struct sway_node *node) {
 	return node->type == N_CONTAINER && node->sway_container->view;
 }
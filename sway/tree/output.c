@@ -4,6 +4,8 @@
 #include <string.h>
 #include <strings.h>
 #include <wlr/types/wlr_output_damage.h>
+#include "sway/desktop/transaction.h"
+#include "sway/input/cursor.h"
 #include "sway/ipc-server.h"
 #include "sway/layers.h"
 #include "sway/output.h"
@@ -110,6 +112,21 @@ struct sway_output *output_create(struct wlr_output *wlr_output) {
 	return output;
 }
 
+/**
+ * Rebuild root->outputs_by_name. Outputs are added in reverse so that when
+ * several share a name or identifier, the first one in root->outputs wins.
+ */
+static void update_output_index(void) {
+	hash_table_clear(root->outputs_by_name);
+	for (int i = root->outputs->length - 1; i >= 0; --i) {
+		struct sway_output *output = root->outputs->items[i];
+		char identifier[128];
+		output_get_identifier(identifier, sizeof(identifier), output);
+		hash_table_set(root->outputs_by_name, identifier, output);
+		hash_table_set(root->outputs_by_name, output->wlr_output->name, output);
+	}
+}
+
 void output_configure(struct sway_output *output) {
 	if (!sway_assert(!output->configured, "output is already configured")) {
 		return;
@@ -117,6 +134,7 @@ void output_configure(struct sway_output *output) {
 	struct wlr_output *wlr_output = output->wlr_output;
 	output->configured = true;
 	list_add(root->outputs, output);
+	update_output_index();
 
 	restore_workspaces(output);
 
@@ -233,6 +251,7 @@ void output_destroy(struct sway_output *output) {
 				"which is still referenced by transactions")) {
 		return;
 	}
+	transaction_remove_output(output);
 	list_free(output->workspaces);
 	list_free(output->current.workspaces);
 	wl_event_source_remove(output->repaint_timer);
@@ -260,6 +279,8 @@ void output_disable(struct sway_output *output) {
 
 	int index = list_find(root->outputs, output);
 	list_del(root->outputs, index);
+	update_output_index();
+	node_record_removal(&output->node);
 
 	output->enabled = false;
 	output->configured = false;
@@ -271,6 +292,8 @@ void output_disable(struct sway_output *output) {
 	// an output that goes offline should stop sending events as long as the
 	// output remains offline.
 	input_manager_configure_all_inputs();
+
+	cursor_reschedule_motion_all();
 }
 
 void output_begin_destroy(struct sway_output *output) {
@@ -9,6 +9,7 @@
 #include "sway/output.h"
 #include "sway/tree/arrange.h"
 #include "sway/tree/container.h"
+#include "sway/tree/hit_index.h"
 #include "sway/tree/root.h"
 #include "sway/tree/workspace.h"
 #include "list.h"
@@ -39,6 +40,10 @@ struct sway_root *root_create(void) {
 	wl_signal_init(&root->events.new_node);
 	root->outputs = create_list();
 	root->scratchpad = create_list();
+	root->workspaces_by_name = create_hash_table_ignore_case();
+	root->workspaces_by_number = create_hash_table();
+	root->outputs_by_name = create_hash_table_ignore_case();
+	root->marks = create_hash_table();
 
 	root->output_layout_change.notify = output_layout_handle_change;
 	wl_signal_add(&root->output_layout->events.change,
@@ -46,10 +51,21 @@ struct sway_root *root_create(void) {
 	return root;
 }
 
+static void free_workspace_list(const char *key, void *value, void *data) {
+	list_free(value);
+}
+
 void root_destroy(struct sway_root *root) {
 	wl_list_remove(&root->output_layout_change.link);
 	list_free(root->scratchpad);
 	list_free(root->outputs);
+	hash_table_for_each(root->workspaces_by_name, free_workspace_list, NULL);
+	hash_table_free(root->workspaces_by_name);
+	hash_table_for_each(root->workspaces_by_number, free_workspace_list, NULL);
+	hash_table_free(root->workspaces_by_number);
+	hash_table_free(root->outputs_by_name);
+	hash_table_free(root->marks);
+	hit_index_destroy(root->floating_hit_index);
 	wlr_output_layout_destroy(root->output_layout);
 	free(root);
 }
@@ -1,5 +1,6 @@
 #define _POSIX_C_SOURCE 200809L
 #include <stdlib.h>
+#include <string.h>
 #include <strings.h>
 #include <wayland-server-core.h>
 #include <wlr/render/wlr_renderer.h>
@@ -37,6 +38,7 @@ void view_init(struct sway_view *view, enum sway_view_type type,
 	view->impl = impl;
 	view->executed_criteria = create_list();
 	wl_list_init(&view->saved_buffers);
+	wl_list_init(&view->snapshot_cache);
 	view->allow_request_urgent = true;
 	view->shortcuts_inhibit = SHORTCUTS_INHIBIT_DEFAULT;
 	wl_signal_init(&view->events.unmap);
@@ -58,7 +60,9 @@ void view_destroy(struct sway_view *view) {
 	if (!wl_list_empty(&view->saved_buffers)) {
 		view_remove_saved_buffer(view);
 	}
+	view_bump_commit_seq(view);
 	list_free(view->executed_criteria);
+	free(view->criteria_cache.results);
 
 	free(view->title_format);
 
@@ -455,6 +459,13 @@ static bool view_has_executed_criteria(struct sway_view *view,
 	return false;
 }
 
+void view_invalidate_criteria_cache(struct sway_view *view) {
+	struct sway_view_criteria_cache *cache = &view->criteria_cache;
+	if (cache->results) {
+		memset(cache->results, CRITERIA_CACHE_UNKNOWN, cache->length);
+	}
+}
+
 void view_execute_criteria(struct sway_view *view) {
 	list_t *criterias = criteria_for_view(view, CT_COMMAND);
 	for (int i = 0; i < criterias->length; i++) {
@@ -467,8 +478,13 @@ void view_execute_criteria(struct sway_view *view) {
 		sway_log(SWAY_DEBUG, "for_window '%s' matches view %p, cmd: '%s'",
 				criteria->raw, view, criteria->cmdlist);
 		list_add(view->executed_criteria, criteria);
-		list_t *res_list = execute_command(
-				criteria->cmdlist, NULL, view->container);
+		struct command_program *program =
+			command_program_cache(&criteria->program, criteria->cmdlist);
+		list_t *res_list = program ?
+			command_program_execute(program, NULL, view->container) : NULL;
+		if (!res_list) {
+			continue;
+		}
 		while (res_list->length) {
 			struct cmd_results *res = res_list->items[0];
 			free_cmd_results(res);
@@ -597,6 +613,8 @@ void view_map(struct sway_view *view, struct wlr_surface *wlr_surface,
 	}
 	view->surface = wlr_surface;
 	view_populate_pid(view);
+	// The title and app_id may have changed while the view was unmapped
+	view_invalidate_criteria_cache(view);
 	view->container = container_create(view);
 
 	// If there is a request to be opened fullscreen on a specific output, try
@@ -683,6 +701,7 @@ void view_map(struct sway_view *view, struct wlr_surface *wlr_surface,
 
 void view_unmap(struct sway_view *view) {
 	wl_signal_emit(&view->events.unmap, view);
+	view_bump_commit_seq(view);
 
 	wl_list_remove(&view->surface_new_subsurface.link);
 
@@ -848,6 +867,9 @@ static void view_child_handle_surface_commit(struct wl_listener *listener,
 		void *data) {
 	struct sway_view_child *child =
 		wl_container_of(listener, child, surface_commit);
+	if (child->view) {
+		view_bump_commit_seq(child->view);
+	}
 	view_child_damage(child, false);
 }
 
@@ -936,6 +958,9 @@ void view_child_destroy(struct sway_view_child *child) {
 	if (child->mapped && child->view->container != NULL) {
 		view_child_damage(child, true);
 	}
+	if (child->view) {
+		view_bump_commit_seq(child->view);
+	}
 
 	if (child->parent != NULL) {
 		wl_list_remove(&child->link);
@@ -1074,6 +1099,8 @@ void view_update_title(struct sway_view *view, bool force) {
 		}
 	}
 
+	view_invalidate_criteria_cache(view);
+
 	free(view->container->title);
 	free(view->container->formatted_title);
 	if (title) {
@@ -1170,6 +1197,11 @@ void view_set_urgent(struct sway_view *view, bool enable) {
 	}
 	container_damage_whole(view->container);
 
+	// Ancestors report whether they have an urgent child
+	for (struct sway_container *con = view->container->parent; con;
+			con = con->parent) {
+		node_bump_generation(&con->node);
+	}
 	ipc_event_window(view->container, "urgent");
 
 	if (!container_is_scratchpad_hidden(view->container)) {
@@ -1181,18 +1213,41 @@ bool view_is_urgent(struct sway_view *view) {
 	return view->urgent.tv_sec || view->urgent.tv_nsec;
 }
 
-void view_remove_saved_buffer(struct sway_view *view) {
-	if (!sway_assert(!wl_list_empty(&view->saved_buffers), "Expected a saved buffer")) {
-		return;
-	}
+static void free_saved_buffers(struct wl_list *saved_buffers) {
 	struct sway_saved_buffer *saved_buf, *tmp;
-	wl_list_for_each_safe(saved_buf, tmp, &view->saved_buffers, link) {
+	wl_list_for_each_safe(saved_buf, tmp, saved_buffers, link) {
 		wlr_buffer_unlock(&saved_buf->buffer->base);
 		wl_list_remove(&saved_buf->link);
 		free(saved_buf);
 	}
 }
 
+void view_remove_saved_buffer(struct sway_view *view) {
+	if (!sway_assert(!wl_list_empty(&view->saved_buffers), "Expected a saved buffer")) {
+		return;
+	}
+	free_saved_buffers(&view->saved_buffers);
+}
+
+void view_release_saved_buffer(struct sway_view *view) {
+	if (!sway_assert(!wl_list_empty(&view->saved_buffers), "Expected a saved buffer")) {
+		return;
+	}
+	if (!view->surface || view->snapshot_seq != view->commit_seq) {
+		free_saved_buffers(&view->saved_buffers);
+		return;
+	}
+	free_saved_buffers(&view->snapshot_cache);
+	wl_list_insert_list(&view->snapshot_cache, &view->saved_buffers);
+	wl_list_init(&view->saved_buffers);
+}
+
+void view_bump_commit_seq(struct sway_view *view) {
+	++view->commit_seq;
+	// The cached buffers are outdated now, don't keep them locked
+	free_saved_buffers(&view->snapshot_cache);
+}
+
 static void view_save_buffer_iterator(struct wlr_surface *surface,
 		int sx, int sy, void *data) {
 	struct sway_view *view = data;
@@ -1215,7 +1270,15 @@ void view_save_buffer(struct sway_view *view) {
 	if (!sway_assert(wl_list_empty(&view->saved_buffers), "Didn't expect saved buffer")) {
 		view_remove_saved_buffer(view);
 	}
+	if (!wl_list_empty(&view->snapshot_cache) &&
+			view->snapshot_seq == view->commit_seq) {
+		wl_list_insert_list(&view->saved_buffers, &view->snapshot_cache);
+		wl_list_init(&view->snapshot_cache);
+		return;
+	}
+	free_saved_buffers(&view->snapshot_cache);
 	view_for_each_surface(view, view_save_buffer_iterator, view);
+	view->snapshot_seq = view->commit_seq;
 }
 
 bool view_is_transient_for(struct sway_view *child,
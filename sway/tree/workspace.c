@@ -13,6 +13,7 @@
 #include "sway/output.h"
 #include "sway/tree/arrange.h"
 #include "sway/tree/container.h"
+#include "sway/tree/hit_index.h"
 #include "sway/tree/node.h"
 #include "sway/tree/view.h"
 #include "sway/tree/workspace.h"
@@ -21,13 +22,77 @@
 #include "util.h"
 
 struct workspace_config *workspace_find_config(const char *ws_name) {
-	for (int i = 0; i < config->workspace_configs->length; ++i) {
-		struct workspace_config *wsc = config->workspace_configs->items[i];
-		if (strcmp(wsc->workspace, ws_name) == 0) {
-			return wsc;
-		}
+	return hash_table_get(config->workspace_configs_by_name, ws_name);
+}
+
+static char *workspace_number(const char *name) {
+	size_t len = 0;
+	while (isdigit(name[len])) {
+		++len;
+	}
+	return len ? strndup(name, len) : NULL;
+}
+
+static void index_add(hash_table_t *index, const char *key,
+		struct sway_workspace *ws) {
+	list_t *workspaces = hash_table_get(index, key);
+	if (!workspaces) {
+		workspaces = create_list();
+		hash_table_set(index, key, workspaces);
+	}
+	list_add(workspaces, ws);
+}
+
+static void index_remove(hash_table_t *index, const char *key,
+		struct sway_workspace *ws) {
+	list_t *workspaces = hash_table_get(index, key);
+	if (!workspaces) {
+		return;
+	}
+	int i = list_find(workspaces, ws);
+	if (i != -1) {
+		list_del(workspaces, i);
+	}
+	if (!workspaces->length) {
+		hash_table_remove(index, key);
+		list_free(workspaces);
+	}
+}
+
+/**
+ * Workspaces are indexed by name and by the number their name starts with.
+ * Names can be shared with workspaces on the noop output, and numbers by
+ * any number of workspaces, so each key maps to a list.
+ */
+static void workspace_index_add(struct sway_workspace *ws) {
+	if (!ws->name) {
+		return;
+	}
+	index_add(root->workspaces_by_name, ws->name, ws);
+	char *number = workspace_number(ws->name);
+	if (number) {
+		index_add(root->workspaces_by_number, number, ws);
+		free(number);
 	}
-	return NULL;
+}
+
+static void workspace_index_remove(struct sway_workspace *ws) {
+	if (!ws->name) {
+		return;
+	}
+	index_remove(root->workspaces_by_name, ws->name, ws);
+	char *number = workspace_number(ws->name);
+	if (number) {
+		index_remove(root->workspaces_by_number, number, ws);
+		free(number);
+	}
+}
+
+void workspace_set_name(struct sway_workspace *ws, char *name) {
+	workspace_index_remove(ws);
+	free(ws->name);
+	ws->name = name;
+	workspace_index_add(ws);
 }
 
 struct sway_output *workspace_get_initial_output(const char *name) {
@@ -70,6 +135,7 @@ struct sway_workspace *workspace_create(struct sway_output *output,
 	}
 	node_init(&ws->node, N_WORKSPACE, ws);
 	ws->name = name ? strdup(name) : NULL;
+	workspace_index_add(ws);
 	ws->prev_split_layout = L_NONE;
 	ws->layout = output_get_default_layout(output);
 	ws->floating = create_list();
@@ -131,11 +197,13 @@ void workspace_destroy(struct sway_workspace *workspace) {
 
 	free(workspace->name);
 	free(workspace->representation);
+	free(workspace->node.json_cache);
 	list_free_items_and_destroy(workspace->output_priority);
 	list_free(workspace->floating);
 	list_free(workspace->tiling);
 	list_free(workspace->current.floating);
 	list_free(workspace->current.tiling);
+	hit_index_destroy(workspace->hit_index);
 	free(workspace);
 }
 
@@ -147,8 +215,10 @@ void workspace_begin_destroy(struct sway_workspace *workspace) {
 	if (workspace->output) {
 		workspace_detach(workspace);
 	}
+	workspace_index_remove(workspace);
 	workspace->node.destroying = true;
 	node_set_dirty(&workspace->node);
+	node_record_removal(&workspace->node);
 }
 
 void workspace_consider_destroy(struct sway_workspace *ws) {
@@ -348,14 +418,53 @@ static bool _workspace_by_number(struct sway_workspace *ws, void *data) {
 	return !isdigit(*ws_name);
 }
 
+/**
+ * Look up the workspaces with the key in the index, and return the one which
+ * root_find_workspace() would find. That is only ambiguous when several of
+ * them are on enabled outputs, which is left to the linear search.
+ */
+static struct sway_workspace *find_indexed_workspace(hash_table_t *index,
+		const char *key, bool (*test)(struct sway_workspace *ws, void *data),
+		void *data) {
+	list_t *workspaces = hash_table_get(index, key);
+	if (!workspaces) {
+		return NULL;
+	}
+	struct sway_workspace *result = NULL;
+	for (int i = 0; i < workspaces->length; ++i) {
+		struct sway_workspace *ws = workspaces->items[i];
+		if (!ws->output || list_find(root->outputs, ws->output) == -1) {
+			continue;
+		}
+		if (result) {
+			return root_find_workspace(test, data);
+		}
+		result = ws;
+	}
+	return result;
+}
+
 struct sway_workspace *workspace_by_number(const char* name) {
-	return root_find_workspace(_workspace_by_number, (void *) name);
+	char *number = workspace_number(name);
+	if (!number) {
+		return root_find_workspace(_workspace_by_number, (void *) name);
+	}
+	struct sway_workspace *ws = find_indexed_workspace(
+			root->workspaces_by_number, number, _workspace_by_number,
+			(void *) name);
+	free(number);
+	return ws;
 }
 
 static bool _workspace_by_name(struct sway_workspace *ws, void *data) {
 	return strcasecmp(ws->name, data) == 0;
 }
 
+static struct sway_workspace *find_workspace_by_name(const char *name) {
+	return find_indexed_workspace(root->workspaces_by_name, name,
+			_workspace_by_name, (void *) name);
+}
+
 struct sway_workspace *workspace_by_name(const char *name) {
 	struct sway_seat *seat = input_manager_current_seat();
 	struct sway_workspace *current = seat_get_focused_workspace(seat);
@@ -375,10 +484,9 @@ struct sway_workspace *workspace_by_name(const char *name) {
 		if (!seat->prev_workspace_name) {
 			return NULL;
 		}
-		return root_find_workspace(_workspace_by_name,
-				(void*)seat->prev_workspace_name);
+		return find_workspace_by_name(seat->prev_workspace_name);
 	} else {
-		return root_find_workspace(_workspace_by_name, (void*)name);
+		return find_workspace_by_name(name);
 	}
 }
 
@@ -665,6 +773,7 @@ void workspace_add_tiling(struct sway_workspace *workspace,
 	list_add(workspace->tiling, con);
 	con->workspace = workspace;
 	container_for_each_child(con, set_workspace, NULL);
+	input_manager_invalidate_focus_index(&workspace->node);
 	container_handle_fullscreen_reparent(con);
 	workspace_update_representation(workspace);
 	node_set_dirty(&workspace->node);
@@ -679,6 +788,7 @@ void workspace_add_floating(struct sway_workspace *workspace,
 	list_add(workspace->floating, con);
 	con->workspace = workspace;
 	container_for_each_child(con, set_workspace, NULL);
+	input_manager_invalidate_focus_index(&workspace->node);
 	container_handle_fullscreen_reparent(con);
 	node_set_dirty(&workspace->node);
 	node_set_dirty(&con->node);
@@ -695,6 +805,7 @@ void workspace_insert_tiling(struct sway_workspace *workspace,
 	list_insert(workspace->tiling, index, con);
 	con->workspace = workspace;
 	container_for_each_child(con, set_workspace, NULL);
+	input_manager_invalidate_focus_index(&workspace->node);
 	container_handle_fullscreen_reparent(con);
 	workspace_update_representation(workspace);
 	node_set_dirty(&workspace->node);
@@ -781,6 +892,7 @@ void workspace_update_representation(struct sway_workspace *ws) {
 		return;
 	}
 	container_build_representation(ws->layout, ws->tiling, ws->representation);
+	node_bump_generation(&ws->node);
 }
 
 void workspace_get_box(struct sway_workspace *workspace, struct wlr_box *box) {
@@ -0,0 +1,229 @@
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "sway/worker_pool.h"
+#include "log.h"
+#include "util.h"
+
+#define WORKER_POOL_MAX_THREADS 4
+
+enum worker_job_state {
+	WORKER_JOB_QUEUED,
+	WORKER_JOB_RUNNING,
+	WORKER_JOB_FINISHED,
+};
+
+struct sway_worker_job {
+	worker_job_func_t run, done;
+	void *data;
+	enum worker_job_state state;
+	struct wl_list link; // worker_pool::queue or worker_pool::finished
+};
+
+static struct {
+	bool running;
+	pthread_t threads[WORKER_POOL_MAX_THREADS];
+	int nthreads;
+
+	pthread_mutex_t lock;
+	pthread_cond_t job_queued;
+	pthread_cond_t job_finished;
+	struct wl_list queue;
+	struct wl_list finished;
+	bool stopping;
+
+	// Written to by workers to wake up the main thread
+	int notify_fds[2];
+	struct wl_event_source *notify_source;
+} pool;
+
+static void *worker_main(void *data) {
+	pthread_mutex_lock(&pool.lock);
+	while (true) {
+		while (!pool.stopping && wl_list_empty(&pool.queue)) {
+			pthread_cond_wait(&pool.job_queued, &pool.lock);
+		}
+		if (wl_list_empty(&pool.queue)) {
+			break;
+		}
+		struct sway_worker_job *job =
+			wl_container_of(pool.queue.next, job, link);
+		wl_list_remove(&job->link);
+		job->state = WORKER_JOB_RUNNING;
+		pthread_mutex_unlock(&pool.lock);
+
+		job->run(job->data);
+
+		pthread_mutex_lock(&pool.lock);
+		job->state = WORKER_JOB_FINISHED;
+		wl_list_insert(pool.finished.prev, &job->link);
+		pthread_cond_broadcast(&pool.job_finished);
+		char byte = 0;
+		if (write(pool.notify_fds[1], &byte, 1) < 0 && errno != EAGAIN) {
+			sway_log_errno(SWAY_ERROR, "Unable to notify the main thread");
+		}
+	}
+	pthread_mutex_unlock(&pool.lock);
+	return NULL;
+}
+
+static void complete_job(struct sway_worker_job *job) {
+	if (job->done) {
+		job->done(job->data);
+	}
+	free(job);
+}
+
+static void complete_finished_jobs(void) {
+	// Done functions may wait for other jobs, so the list can't be iterated
+	while (true) {
+		pthread_mutex_lock(&pool.lock);
+		if (wl_list_empty(&pool.finished)) {
+			pthread_mutex_unlock(&pool.lock);
+			break;
+		}
+		struct sway_worker_job *job =
+			wl_container_of(pool.finished.next, job, link);
+		wl_list_remove(&job->link);
+		pthread_mutex_unlock(&pool.lock);
+		complete_job(job);
+	}
+}
+
+static int handle_notify(int fd, uint32_t mask, void *data) {
+	char buf[64];
+	while (read(fd, buf, sizeof(buf)) > 0) {
+		// Drain
+	}
+	complete_finished_jobs();
+	return 0;
+}
+
+static bool set_nonblock(int fd) {
+	int flags = fcntl(fd, F_GETFL);
+	return flags != -1 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+}
+
+bool worker_pool_init(struct wl_event_loop *loop) {
+	long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	int nthreads = ncpus < 1 ? 1 :
+		(ncpus > WORKER_POOL_MAX_THREADS ? WORKER_POOL_MAX_THREADS : ncpus);
+
+	if (pipe(pool.notify_fds) != 0) {
+		sway_log_errno(SWAY_ERROR, "Unable to create worker pool pipe");
+		return false;
+	}
+	for (int i = 0; i < 2; ++i) {
+		if (!sway_set_cloexec(pool.notify_fds[i], true) ||
+				!set_nonblock(pool.notify_fds[i])) {
+			goto error_pipe;
+		}
+	}
+	pool.notify_source = wl_event_loop_add_fd(loop, pool.notify_fds[0],
+			WL_EVENT_READABLE, handle_notify, NULL);
+	if (!pool.notify_source) {
+		goto error_pipe;
+	}
+
+	pthread_mutex_init(&pool.lock, NULL);
+	pthread_cond_init(&pool.job_queued, NULL);
+	pthread_cond_init(&pool.job_finished, NULL);
+	wl_list_init(&pool.queue);
+	wl_list_init(&pool.finished);
+	pool.stopping = false;
+
+	// Signals are handled by the main thread
+	sigset_t set, old_set;
+	sigfillset(&set);
+	pthread_sigmask(SIG_SETMASK, &set, &old_set);
+	for (pool.nthreads = 0; pool.nthreads < nthreads; ++pool.nthreads) {
+		if (pthread_create(&pool.threads[pool.nthreads], NULL,
+					worker_main, NULL) != 0) {
+			sway_log(SWAY_ERROR, "Unable to create worker thread");
+			break;
+		}
+	}
+	pthread_sigmask(SIG_SETMASK, &old_set, NULL);
+
+	if (pool.nthreads == 0) {
+		wl_event_source_remove(pool.notify_source);
+		goto error_pipe;
+	}
+	sway_log(SWAY_DEBUG, "Started %d worker threads", pool.nthreads);
+	pool.running = true;
+	return true;
+
+error_pipe:
+	close(pool.notify_fds[0]);
+	close(pool.notify_fds[1]);
+	return false;
+}
+
+void worker_pool_finish(void) {
+	if (!pool.running) {
+		return;
+	}
+	pthread_mutex_lock(&pool.lock);
+	pool.stopping = true;
+	pthread_cond_broadcast(&pool.job_queued);
+	pthread_mutex_unlock(&pool.lock);
+	for (int i = 0; i < pool.nthreads; ++i) {
+		pthread_join(pool.threads[i], NULL);
+	}
+	pool.running = false;
+	complete_finished_jobs();
+
+	wl_event_source_remove(pool.notify_source);
+	close(pool.notify_fds[0]);
+	close(pool.notify_fds[1]);
+	pthread_cond_destroy(&pool.job_finished);
+	pthread_cond_destroy(&pool.job_queued);
+	pthread_mutex_destroy(&pool.lock);
+}
+
+struct sway_worker_job *worker_pool_submit(worker_job_func_t run,
+		worker_job_func_t done, void *data) {
+	struct sway_worker_job *job = NULL;
+	if (pool.running) {
+		job = calloc(1, sizeof(struct sway_worker_job));
+	}
+	if (!job) {
+		run(data);
+		if (done) {
+			done(data);
+		}
+		return NULL;
+	}
+	job->run = run;
+	job->done = done;
+	job->data = data;
+	job->state = WORKER_JOB_QUEUED;
+
+	pthread_mutex_lock(&pool.lock);
+	wl_list_insert(pool.queue.prev, &job->link);
+	pthread_cond_signal(&pool.job_queued);
+	pthread_mutex_unlock(&pool.lock);
+	return job;
+}
+
+void worker_job_wait(struct sway_worker_job *job) {
+	pthread_mutex_lock(&pool.lock);
+	if (job->state == WORKER_JOB_QUEUED) {
+		// Cheaper than waiting for a worker to pick it up
+		wl_list_remove(&job->link);
+		pthread_mutex_unlock(&pool.lock);
+		job->run(job->data);
+		complete_job(job);
+		return;
+	}
+	while (job->state != WORKER_JOB_FINISHED) {
+		pthread_cond_wait(&pool.job_finished, &pool.lock);
+	}
+	wl_list_remove(&job->link);
+	pthread_mutex_unlock(&pool.lock);
+	complete_job(job);
+}
@@ -11,6 +11,7 @@
 #if HAVE_TRAY
 #include "swaybar/tray/tray.h"
 #endif
+#include "cbor.h"
 #include "config.h"
 #include "ipc-client.h"
 #include "list.h"
@@ -94,15 +95,31 @@ static void ipc_parse_colors(
 	}
 }
 
+/**
+ * Parses a reply or event payload. A successfully parsed null is stored as a
+ * NULL object, so failure is reported through the return value instead.
+ */
+static bool ipc_parse_payload(struct swaybar *bar,
+		const char *payload, uint32_t len, json_object **obj) {
+	*obj = NULL;
+	if (!payload) {
+		return false;
+	}
+	if (!bar->ipc_cbor) {
+		enum json_tokener_error error;
+		*obj = json_tokener_parse_verbose(payload, &error);
+		return error == json_tokener_success;
+	}
+	return cbor_decode_json(payload, len, obj);
+}
+
 static bool ipc_parse_config(
-		struct swaybar_config *config, const char *payload) {
-	json_object *bar_config = json_tokener_parse(payload);
+		struct swaybar_config *config, json_object *bar_config) {
 	json_object *success;
 	if (json_object_object_get_ex(bar_config, "success", &success)
 			&& !json_object_get_boolean(success)) {
 		sway_log(SWAY_ERROR, "No bar with that ID. Use 'swaymsg -t "
 				"get_bar_config' to get the available bar configs.");
-		json_object_put(bar_config);
 		return false;
 	}
 
@@ -325,7 +342,6 @@ static bool ipc_parse_config(
 	}
 #endif
 
-	json_object_put(bar_config);
 	return true;
 }
 
@@ -338,8 +354,10 @@ bool ipc_get_workspaces(struct swaybar *bar) {
 	uint32_t len = 0;
 	char *res = ipc_single_command(bar->ipc_socketfd,
 			IPC_GET_WORKSPACES, NULL, &len);
-	json_object *results = json_tokener_parse(res);
-	if (!results) {
+	json_object *results;
+	if (!ipc_parse_payload(bar, res, len, &results) ||
+			!json_object_is_type(results, json_type_array)) {
+		json_object_put(results);
 		free(res);
 		return false;
 	}
@@ -408,15 +426,55 @@ void ipc_execute_binding(struct swaybar *bar, struct swaybar_binding *bind) {
 			IPC_COMMAND, bind->command, &len));
 }
 
+static bool ipc_set_encoding(int socketfd, const char *encoding) {
+	// Older versions of sway don't reply to unknown message types, so a
+	// GET_VERSION is sent along. If it is answered first, SET_ENCODING isn't
+	// supported, otherwise its reply follows the one to SET_ENCODING.
+	ipc_send_command(socketfd, IPC_SET_ENCODING, encoding, strlen(encoding));
+	ipc_send_command(socketfd, IPC_GET_VERSION, "", 0);
+
+	struct ipc_response *resp = ipc_recv_response(socketfd);
+	if (!resp) {
+		return false;
+	}
+	if (resp->type != IPC_SET_ENCODING) {
+		free_ipc_response(resp);
+		return false;
+	}
+	json_object *reply = json_tokener_parse(resp->payload);
+	json_object *success;
+	bool ret = json_object_object_get_ex(reply, "success", &success)
+		&& json_object_get_boolean(success);
+	json_object_put(reply);
+	free_ipc_response(resp);
+
+	// The reply to GET_VERSION
+	if ((resp = ipc_recv_response(socketfd))) {
+		free_ipc_response(resp);
+	}
+	return ret;
+}
+
 bool ipc_initialize(struct swaybar *bar) {
+	// Workspaces are fetched on every workspace event, skip the JSON round
+	// trip for them
+	bar->ipc_cbor = ipc_set_encoding(bar->ipc_socketfd, "cbor") &&
+		ipc_set_encoding(bar->ipc_event_socketfd, "cbor");
+	if (!bar->ipc_cbor) {
+		sway_log(SWAY_DEBUG, "Falling back to the JSON encoding");
+	}
+
 	uint32_t len = strlen(bar->id);
 	char *res = ipc_single_command(bar->ipc_socketfd,
 			IPC_GET_BAR_CONFIG, bar->id, &len);
-	if (!ipc_parse_config(bar->config, res)) {
-		free(res);
+	json_object *bar_config;
+	bool parsed = ipc_parse_payload(bar, res, len, &bar_config);
+	free(res);
+	if (!parsed || !ipc_parse_config(bar->config, bar_config)) {
+		json_object_put(bar_config);
 		return false;
 	}
-	free(res);
+	json_object_put(bar_config);
 
 	struct swaybar_config *config = bar->config;
 	char subscribe[128]; // suitably large buffer
@@ -450,7 +508,7 @@ static bool handle_bar_state_update(struct swaybar *bar, json_object *event) {
 	return determine_bar_visibility(bar, false);
 }
 
-static bool handle_barconfig_update(struct swaybar *bar, const char *payload,
+static bool handle_barconfig_update(struct swaybar *bar,
 		json_object *json_config) {
 	json_object *json_id = json_object_object_get(json_config, "id");
 	const char *id = json_object_get_string(json_id);
@@ -459,7 +517,7 @@ static bool handle_barconfig_update(struct swaybar *bar, const char *payload,
 	}
 
 	struct swaybar_config *newcfg = init_config();
-	ipc_parse_config(newcfg, payload);
+	ipc_parse_config(newcfg, json_config);
 
 	struct swaybar_config *oldcfg = bar->config;
 	bar->config = newcfg;
@@ -541,9 +599,9 @@ bool handle_ipc_readable(struct swaybar *bar) {
 		return false;
 	}
 
-	json_object *result = json_tokener_parse(resp->payload);
-	if (!result) {
-		sway_log(SWAY_ERROR, "failed to parse payload as json");
+	json_object *result;
+	if (!ipc_parse_payload(bar, resp->payload, resp->size, &result)) {
+		sway_log(SWAY_ERROR, "failed to parse ipc payload");
 		free_ipc_response(resp);
 		return false;
 	}
@@ -573,7 +631,7 @@ bool handle_ipc_readable(struct swaybar *bar) {
 		break;
 	}
 	case IPC_EVENT_BARCONFIG_UPDATE:
-		bar_is_dirty = handle_barconfig_update(bar, resp->payload, result);
+		bar_is_dirty = handle_barconfig_update(bar, result);
 		break;
 	case IPC_EVENT_BAR_STATE_UPDATE:
 		bar_is_dirty = handle_bar_state_update(bar, result);
@@ -11,6 +11,7 @@
 #include <ctype.h>
 #include <unistd.h>
 #include <json.h>
+#include "cbor.h"
 #include "stringop.h"
 #include "ipc-client.h"
 #include "log.h"
@@ -287,6 +288,15 @@ static void pretty_print_config(json_object *c) {
 }
 
 static void pretty_print(int type, json_object *resp) {
+	if (!json_object_is_type(resp, json_type_array) &&
+			type != IPC_GET_VERSION && type != IPC_GET_CONFIG &&
+			type != IPC_SEND_TICK) {
+		// Anything but an array of results is printed as is
+		printf("%s\n", json_object_to_json_string_ext(resp,
+			JSON_C_TO_STRING_PRETTY | JSON_C_TO_STRING_SPACED));
+		return;
+	}
+
 	if (type != IPC_COMMAND && type != IPC_GET_WORKSPACES &&
 			type != IPC_GET_INPUTS && type != IPC_GET_OUTPUTS &&
 			type != IPC_GET_VERSION && type != IPC_GET_SEATS &&
@@ -334,16 +344,46 @@ static void pretty_print(int type, json_object *resp) {
 	}
 }
 
+/**
+ * Parses a reply or event payload. A successfully parsed null is stored as a
+ * NULL object, so failure is reported through the return value instead.
+ */
+static bool parse_payload(const char *payload, uint32_t len, bool cbor,
+		json_object **obj) {
+	*obj = NULL;
+	if (!payload) {
+		return false;
+	}
+	if (!cbor) {
+		enum json_tokener_error error;
+		*obj = json_tokener_parse_verbose(payload, &error);
+		return error == json_tokener_success;
+	}
+	return cbor_decode_json(payload, len, obj);
+}
+
+static bool set_encoding(int socketfd, const char *encoding) {
+	uint32_t len = strlen(encoding);
+	char *resp = ipc_single_command(socketfd, IPC_SET_ENCODING, encoding, &len);
+	json_object *obj = json_tokener_parse(resp);
+	bool ret = obj != NULL && success(obj, false);
+	json_object_put(obj);
+	free(resp);
+	return ret;
+}
+
 int main(int argc, char **argv) {
 	static bool quiet = false;
 	static bool raw = false;
 	static bool monitor = false;
+	static bool cbor = false;
 	char *socket_path = NULL;
 	char *cmdtype = NULL;
 
 	sway_log_init(SWAY_INFO, NULL);
 
 	static struct option long_options[] = {
+		{"cbor", no_argument, NULL, 'c'},
 		{"help", no_argument, NULL, 'h'},
 		{"monitor", no_argument, NULL, 'm'},
 		{"pretty", no_argument, NULL, 'p'},
@@ -358,6 +398,7 @@ int main(int argc, char **argv) {
 	const char *usage =
 		"Usage: swaymsg [options] [message]\n"
 		"\n"
+		"  -c, --cbor             Use the CBOR encoding to talk to sway.\n"
 		"  -h, --help             Show help message and quit.\n"
 		"  -m, --monitor          Monitor until killed (-t SUBSCRIBE only)\n"
 		"  -p, --pretty           Use pretty output even when not using a tty\n"
@@ -372,11 +413,14 @@ int main(int argc, char **argv) {
 	int c;
 	while (1) {
 		int option_index = 0;
-		c = getopt_long(argc, argv, "hmpqrs:t:v", long_options, &option_index);
+		c = getopt_long(argc, argv, "chmpqrs:t:v", long_options, &option_index);
 		if (c == -1) {
 			break;
 		}
 		switch (c) {
+		case 'c': // CBOR
+			cbor = true;
+			break;
 		case 'm': // Monitor
 			monitor = true;
 			break;
@@ -426,6 +470,10 @@ int main(int argc, char **argv) {
 		type = IPC_GET_WORKSPACES;
 	} else if (strcasecmp(cmdtype, "get_seats") == 0) {
 		type = IPC_GET_SEATS;
+	} else if (strcasecmp(cmdtype, "get_frame_timings") == 0) {
+		type = IPC_GET_FRAME_TIMINGS;
+	} else if (strcasecmp(cmdtype, "get_startup_profile") == 0) {
+		type = IPC_GET_STARTUP_PROFILE;
 	} else if (strcasecmp(cmdtype, "get_inputs") == 0) {
 		type = IPC_GET_INPUTS;
 	} else if (strcasecmp(cmdtype, "get_outputs") == 0) {
@@ -476,16 +524,27 @@ int main(int argc, char **argv) {
 	int socketfd = ipc_open_socket(socket_path);
 	struct timeval timeout = {.tv_sec = 3, .tv_usec = 0};
 	ipc_set_recv_timeout(socketfd, timeout);
+	if (cbor && !set_encoding(socketfd, "cbor")) {
+		if (!quiet) {
+			sway_log(SWAY_ERROR, "Unable to switch to the CBOR encoding");
+		}
+		close(socketfd);
+		free(command);
+		free(socket_path);
+		return 1;
+	}
 	uint32_t len = strlen(command);
 	char *resp = ipc_single_command(socketfd, type, command, &len);
 
 	// pretty print the json
-	json_object *obj = json_tokener_parse(resp);
-	if (obj == NULL) {
+	json_object *obj;
+	if (!parse_payload(resp, len, cbor, &obj)) {
 		if (!quiet) {
-			fprintf(stderr, "ERROR: Could not parse json response from ipc. "
-					"This is a bug in sway.");
-			printf("%s\n", resp);
+			fprintf(stderr, "ERROR: Could not parse %s response from ipc. "
+					"This is a bug in sway.", cbor ? "cbor" : "json");
+			if (!cbor) {
+				printf("%s\n", resp);
+			}
 		}
 		ret = 1;
 	} else {
@@ -517,11 +576,11 @@ int main(int argc, char **argv) {
 				break;
 			}
 
-			json_object *obj = json_tokener_parse(reply->payload);
-			if (obj == NULL) {
+			json_object *obj;
+			if (!parse_payload(reply->payload, reply->size, cbor, &obj)) {
 				if (!quiet) {
-					fprintf(stderr, "ERROR: Could not parse json response from"
-							" ipc. This is a bug in sway.");
+					fprintf(stderr, "ERROR: Could not parse %s response from"
+							" ipc. This is a bug in sway.", cbor ? "cbor" : "json");
 					ret = 1;
 				}
 				break;